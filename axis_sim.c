@@ -19,6 +19,16 @@ void axs_init(struct axis_t* axs, enum axsID_t axsID, double max_pos, double min
         axs->max_pos = max_pos;
         axs->max_vel = max_vel;
         axs->min_vel = min_vel;
+
+        //limits and start position are whole units, the conversion is exact
+        axs->fxp = false;
+        axs->nano.cur_pos = (int64_t) (start_pos*1e9)*(1LL << FXP_STSHIFT);
+        axs->nano.cur_vel = 0;
+        axs->nano.set_vel = 0;
+        axs->nano.last_vel = 0;
+        axs->nano.max_pos = (int64_t) (max_pos*1e9);
+        axs->nano.max_vel = (int64_t) (max_vel*1e9);
+        axs->nano.min_vel = (int64_t) (min_vel*1e9);
 }
 
 int axes_initreq(struct axis_t* axes[], uint8_t no_axs, enum axsID_t strt_ID)
@@ -94,6 +104,88 @@ void axs_fineclcpstn(struct axis_t* axs, double tmstp, uint32_t iters)
         }
 }
 
+void axes_setfxp(struct axis_t* axes[], uint8_t num_axs)
+{
+        for (int i = 0; i < num_axs; i++)
+                axes[i]->fxp = true;
+}
+
+/* division rounded to nearest, halves away from zero, identical on every machine */
+static int64_t rnddiv(__int128 num, __int128 den)
+{
+        if (num < 0)
+                return (int64_t) -((-num + den/2)/den);
+        return (int64_t) ((num + den/2)/den);
+}
+
+/* coefficients of the PT2 filter for a timestep with FXP_SHIFT fractional bits */
+struct pt2coef_t {
+        int64_t set;
+        int64_t cur;
+        int64_t last;
+};
+
+static void clcpt2coef(struct pt2coef_t *coef, int64_t tmstp_ns)
+{
+        __int128 tmstp_sq;
+        __int128 div;
+
+        tmstp_sq = (__int128) tmstp_ns*tmstp_ns;
+        div = tmstp_sq + (__int128) d_T2_NS*tmstp_ns + (__int128) T_NS*T_NS;
+        coef->set = rnddiv(tmstp_sq*K_FXP,div);
+        coef->cur = rnddiv(((__int128) d_T2_NS*tmstp_ns + 2*tmstp_sq) << FXP_SHIFT,div);
+        coef->last = rnddiv(tmstp_sq << FXP_SHIFT,div);
+}
+
+/* one timestep of axs_clcpstn with prepared coefficients */
+static void fxpclcpstn(struct axis_t* axs, const struct pt2coef_t *coef, int64_t tmstp_ns)
+{
+        struct axisnano_t *nano = &(axs->nano);
+        __int128 acc;
+        int64_t new_pos;
+        int64_t new_vel;
+
+        if (axs->enbl != true)
+                return;
+        //calculate PT2 for velocity, round to nearest (halves up)
+        acc = ((__int128) coef->set*nano->set_vel << FXP_STSHIFT) + (__int128) coef->cur*nano->cur_vel - (__int128) coef->last*nano->last_vel;
+        new_vel = (int64_t) ((acc + ((__int128) 1 << (FXP_SHIFT - 1))) >> FXP_SHIFT);
+        if (new_vel > nano->max_vel*(1LL << FXP_STSHIFT))
+                new_vel = nano->max_vel*(1LL << FXP_STSHIFT);
+        if (new_vel < nano->min_vel*(1LL << FXP_STSHIFT))
+                new_vel = nano->min_vel*(1LL << FXP_STSHIFT);
+
+        //update position with the mean velocity of the timestep (position: nm; vel nm/s; timestep: ns)
+        new_pos = nano->cur_pos + rnddiv((__int128) (nano->cur_vel + new_vel)*tmstp_ns,2000000000);
+        if (new_pos > nano->max_pos*(1LL << FXP_STSHIFT))
+                new_pos = nano->max_pos*(1LL << FXP_STSHIFT);
+        if (new_pos < -nano->max_pos*(1LL << FXP_STSHIFT))
+                new_pos = -nano->max_pos*(1LL << FXP_STSHIFT);
+
+        nano->cur_pos = new_pos;
+        nano->last_vel = nano->cur_vel;
+        nano->cur_vel = new_vel;
+}
+
+void axs_fxpclcpstn(struct axis_t* axs, int64_t tmstp_ns)
+{
+        struct pt2coef_t coef;
+        clcpt2coef(&coef,tmstp_ns);
+        fxpclcpstn(axs,&coef,tmstp_ns);
+}
+
+void axs_fxpfineclcpstn(struct axis_t* axs, int64_t tmstp_ns, uint32_t iters)
+{
+        struct pt2coef_t coef;
+        int64_t finetmstp_ns;
+        //the coefficients are the same for all fine timesteps
+        finetmstp_ns = tmstp_ns/iters;
+        clcpt2coef(&coef,finetmstp_ns);
+        for (uint32_t i = 0; i < iters; i++){
+                fxpclcpstn(axs,&coef,finetmstp_ns);
+        }
+}
+
 void axs_enbl(struct axis_t* axs)
 {
         axs_clrflt(axs);
@@ -105,6 +197,12 @@ void axs_dsbl(struct axis_t* axs)
         axs->enbl = false;
         axs->flt = false;
         axs->set_vel = 0;
+        if (axs->fxp) {
+                axs->nano.set_vel = 0;
+                axs_fxpclcpstn(axs,1000000000);
+                axs->nano.cur_vel = 0;
+                return;
+        }
         axs_clcpstn(axs,1);
         axs->cur_vel = 0;
 }
@@ -135,7 +233,10 @@ int axes_updt_setvel(struct axis_t* axes[], uint8_t num_axs, const struct cntrln
                 default:
                         return 1;       //fail
                 }
-                axes[i]->set_vel = set_axsnfo->cntrlvl;
+                if (axes[i]->fxp)
+                        axes[i]->nano.set_vel = set_axsnfo->ncntrlvl;
+                else
+                        axes[i]->set_vel = set_axsnfo->cntrlvl;
         }
         return 0;
 }
@@ -167,7 +268,9 @@ int axes_updt_enbl(struct axis_t* axes[], uint8_t num_axs, const struct cntrlnfo
                 } else {
                         axs_dsbl(axes[i]);
                 }
-                if(set_axsnfo->cntrlsw < 0) {
+                if((set_axsnfo->cntrlsw < 0) && axes[i]->fxp) {
+                        axs_fxpststrtup(axes[i],set_axsnfo->ncntrlvl);
+                } else if(set_axsnfo->cntrlsw < 0) {
                         axs_ststrtup(axes[i],set_axsnfo->cntrlvl);
                 }
         }
@@ -185,3 +288,20 @@ void axs_ststrtup(struct axis_t* axs, double start_pos)
                 strtpos = -axs->max_pos;
         axs->cur_pos = strtpos;
 }
+
+/* set startup position of axis in nano units (fixed-point mode) */
+void axs_fxpststrtup(struct axis_t* axs, int64_t start_pos)
+{
+        int64_t strtpos;
+        strtpos = start_pos;
+        if (start_pos > axs->nano.max_pos)
+                strtpos = axs->nano.max_pos;
+        if (start_pos < -axs->nano.max_pos)
+                strtpos = -axs->nano.max_pos;
+        axs->nano.cur_pos = strtpos*(1LL << FXP_STSHIFT);
+}
+
+int64_t axs_fxpgetpstn(const struct axis_t* axs)
+{
+        return rnddiv(axs->nano.cur_pos,1LL << FXP_STSHIFT);
+}
@@ -36,6 +36,25 @@
 #define TSQUARE (T*T)
 #define d_T2 (d*T*2)
 
+/* fixed-point mode: positions and velocities in nano units (int64), times in ns */
+#define FXP_SHIFT 32                                    //fractional bits of the filter coefficients
+#define FXP_STSHIFT 16                                  //fractional bits of position and velocities of the state
+#define K_FXP ((int64_t) (K*(1LL << FXP_SHIFT)))        //K-Factor with FXP_SHIFT fractional bits
+#define T_NS ((int64_t) (T*1e9 + 0.5))                  //Timefactor in ns
+#define d_T2_NS ((int64_t) (d_T2*1e9 + 0.5))            //2*Damping*Timefactor in ns
+
+/* state of an axis in the fixed-point mode, all values in nano units (nm, nm/s);
+ * the state keeps FXP_STSHIFT fractional bits so rounding does not accumulate */
+struct axisnano_t {
+        int64_t max_pos;
+        int64_t min_vel;
+        int64_t max_vel;
+        int64_t set_vel;
+        int64_t cur_pos;        //with FXP_STSHIFT fractional bits
+        int64_t cur_vel;        //with FXP_STSHIFT fractional bits
+        int64_t last_vel;       //with FXP_STSHIFT fractional bits
+};
+
 struct axis_t {
         enum axsID_t axs;
         double max_pos;
@@ -47,6 +66,8 @@ struct axis_t {
         double last_vel;
         bool enbl;
         bool flt;
+        bool fxp;                       //axis is calculated in the fixed-point mode
+        struct axisnano_t nano;         //state of the fixed-point mode
 };
 
 /* initialization of axis */
@@ -61,6 +82,16 @@ void axs_clcpstn(struct axis_t* axs, double tmstp);
 /* calculate new position, multi_small timesteps */
 void axs_fineclcpstn(struct axis_t* axs, double tmstp, uint32_t iters);
 
+/* switch requested axes to the fixed-point mode, set points and start
+ * positions are then taken from ncntrlvl */
+void axes_setfxp(struct axis_t* axes[], uint8_t num_axs);
+
+/* calculate new position in the fixed-point mode, one timestep in ns */
+void axs_fxpclcpstn(struct axis_t* axs, int64_t tmstp_ns);
+
+/* calculate new position in the fixed-point mode, multi small timesteps */
+void axs_fxpfineclcpstn(struct axis_t* axs, int64_t tmstp_ns, uint32_t iters);
+
 /* enable axis and clears fault if necessary/and possible*/
 void axs_enbl(struct axis_t* axs);
 
@@ -79,5 +110,11 @@ int axes_updt_enbl(struct axis_t* axes[], uint8_t num_axs, const struct cntrlnfo
 /* set startup position of axis */
 void axs_ststrtup(struct axis_t* axs, double start_pos);
 
+/* position of axis in nano units (fixed-point mode), rounded to nearest */
+int64_t axs_fxpgetpstn(const struct axis_t* axs);
+
+/* set startup position of axis in nano units (fixed-point mode) */
+void axs_fxpststrtup(struct axis_t* axs, int64_t start_pos);
+
 
 #endif /* _AXIS_SIM_H_ */
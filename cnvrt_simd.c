@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/* Vector kernels of the batch conversion (packet_handler.c/dbls2nbe64 and
+ * nbe642dbls). This file is always built with -O2, unoptimized intrinsics are
+ * slower than the scalar code. */
+
+#include <string.h>
+#include <endian.h>
+#include "packet_handler.h"
+#include "cnvrt_simd.h"
+
+#ifdef CNVRT_X86
+#include <immintrin.h>
+
+/* Doubles with |val*1e9| < 2^51 are converted exactly by adding and subtracting
+ * 1.5*2^52 (the integer ends up in the mantissa), this needs no 64 bit integer
+ * conversion instruction, which is missing before AVX-512. Values outside of
+ * this range (or NaN) are converted by the scalar functions. */
+#define CNVRT_FASTLIM 2251799813685248.0        //2^51
+#define CNVRT_MAGIC 6755399441055744.0          //1.5*2^52
+
+#define CNVRT_KERNEL(isa) __attribute__((target(isa)))
+
+/* converts the lanes of a vector which are not in the exact range (and the last value) with the scalar functions */
+static int dbls2nbe64_fixup(const double vals[], char *res, int lanes, int inrng)
+{
+        int64_t tmp;
+        int ok = 0;
+        for (int j = 0; j < lanes; j++) {
+                if (inrng & (1 << j))
+                        continue;
+                tmp = 0;
+                ok |= dbl2nint64(vals[j],&tmp);
+                tmp = htobe64(tmp);
+                memcpy(res + j*sizeof(int64_t),&tmp,sizeof(int64_t));
+        }
+        return ok;
+}
+
+static void nbe642dbls_fixup(const char *vals, double res[], int lanes, int inrng)
+{
+        int64_t tmp;
+        for (int j = 0; j < lanes; j++) {
+                if (inrng & (1 << j))
+                        continue;
+                memcpy(&tmp,vals + j*sizeof(int64_t),sizeof(int64_t));
+                res[j] = nint642dbl(be64toh(tmp));
+        }
+}
+
+/* converts two values, inlined into the AVX2 functions for the rest of the values */
+static inline CNVRT_KERNEL("sse4.1") __attribute__((always_inline)) int dbl2nbe64x2(const double vals[], char *res)
+{
+        const __m128d magic = _mm_set1_pd(CNVRT_MAGIC);
+        const __m128i bswp = _mm_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8);
+        __m128d x;
+        __m128i n;
+        int inrng;
+        x = _mm_mul_pd(_mm_loadu_pd(vals),_mm_set1_pd(1e9));
+        inrng = _mm_movemask_pd(_mm_cmplt_pd(_mm_and_pd(x,_mm_castsi128_pd(_mm_set1_epi64x(INT64_MAX))),_mm_set1_pd(CNVRT_FASTLIM)));
+        x = _mm_round_pd(x,_MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+        n = _mm_sub_epi64(_mm_castpd_si128(_mm_add_pd(x,magic)),_mm_castpd_si128(magic));
+        _mm_storeu_si128((__m128i *) res,_mm_shuffle_epi8(n,bswp));
+        if (inrng != 0x3)
+                return dbls2nbe64_fixup(vals,res,2,inrng);
+        return 0;
+}
+
+static inline CNVRT_KERNEL("sse4.1") __attribute__((always_inline)) void nbe642dblx2(const char *vals, double res[])
+{
+        const __m128d magic = _mm_set1_pd(CNVRT_MAGIC);
+        const __m128i bswp = _mm_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8);
+        __m128i n;
+        __m128d x;
+        int inrng;
+        n = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) vals),bswp);
+        //-2^51 <= n < 2^51, if (n + 2^51) has no bits above bit 51
+        inrng = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(_mm_srli_epi64(_mm_add_epi64(n,_mm_set1_epi64x(1LL << 51)),52),_mm_setzero_si128())));
+        x = _mm_sub_pd(_mm_castsi128_pd(_mm_add_epi64(n,_mm_castpd_si128(magic))),magic);
+        _mm_storeu_pd(res,_mm_mul_pd(x,_mm_set1_pd(1e-9)));
+        if (inrng != 0x3)
+                nbe642dbls_fixup(vals,res,2,inrng);
+}
+
+CNVRT_KERNEL("sse4.1")
+int dbls2nbe64_sse41(const double vals[], char *res, int cnt)
+{
+        int ok = 0;
+        int i;
+        for (i = 0; i + 2 <= cnt; i += 2)
+                ok |= dbl2nbe64x2(&(vals[i]),res + i*sizeof(int64_t));
+        if (i < cnt)
+                ok |= dbls2nbe64_fixup(&(vals[i]),res + i*sizeof(int64_t),1,0);
+        return ok;
+}
+
+CNVRT_KERNEL("sse4.1")
+void nbe642dbls_sse41(const char *vals, double res[], int cnt)
+{
+        int i;
+        for (i = 0; i + 2 <= cnt; i += 2)
+                nbe642dblx2(vals + i*sizeof(int64_t),&(res[i]));
+        if (i < cnt)
+                nbe642dbls_fixup(vals + i*sizeof(int64_t),&(res[i]),1,0);
+}
+
+CNVRT_KERNEL("avx2")
+int dbls2nbe64_avx2(const double vals[], char *res, int cnt)
+{
+        const __m256d scl = _mm256_set1_pd(1e9);
+        const __m256d lim = _mm256_set1_pd(CNVRT_FASTLIM);
+        const __m256d magic = _mm256_set1_pd(CNVRT_MAGIC);
+        const __m256d absmsk = _mm256_castsi256_pd(_mm256_set1_epi64x(INT64_MAX));
+        const __m256i bswp = _mm256_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8,
+                                              7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8);
+        __m256d x;
+        __m256i n;
+        int inrng;
+        int ok = 0;
+        int i;
+        for (i = 0; i + 4 <= cnt; i += 4) {
+                x = _mm256_mul_pd(_mm256_loadu_pd(&(vals[i])),scl);
+                inrng = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_and_pd(x,absmsk),lim,_CMP_LT_OQ));
+                x = _mm256_round_pd(x,_MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+                n = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(x,magic)),_mm256_castpd_si256(magic));
+                _mm256_storeu_si256((__m256i *) (res + i*sizeof(int64_t)),_mm256_shuffle_epi8(n,bswp));
+                if (inrng != 0xF)
+                        ok |= dbls2nbe64_fixup(&(vals[i]),res + i*sizeof(int64_t),4,inrng);
+        }
+        //the compiler only adds this when optimizing, without it all following SSE code is slowed down
+        _mm256_zeroupper();
+        if (i + 2 <= cnt) {
+                ok |= dbl2nbe64x2(&(vals[i]),res + i*sizeof(int64_t));
+                i += 2;
+        }
+        if (i < cnt)
+                ok |= dbls2nbe64_fixup(&(vals[i]),res + i*sizeof(int64_t),1,0);
+        return ok;
+}
+
+CNVRT_KERNEL("avx2")
+void nbe642dbls_avx2(const char *vals, double res[], int cnt)
+{
+        const __m256d scl = _mm256_set1_pd(1e-9);
+        const __m256d magic = _mm256_set1_pd(CNVRT_MAGIC);
+        const __m256i lim = _mm256_set1_epi64x(1LL << 51);
+        const __m256i bswp = _mm256_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8,
+                                              7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8);
+        __m256i n;
+        __m256d x;
+        int inrng;
+        int i;
+        for (i = 0; i + 4 <= cnt; i += 4) {
+                n = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *) (vals + i*sizeof(int64_t))),bswp);
+                inrng = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_srli_epi64(_mm256_add_epi64(n,lim),52),_mm256_setzero_si256())));
+                x = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(n,_mm256_castpd_si256(magic))),magic);
+                _mm256_storeu_pd(&(res[i]),_mm256_mul_pd(x,scl));
+                if (inrng != 0xF)
+                        nbe642dbls_fixup(vals + i*sizeof(int64_t),&(res[i]),4,inrng);
+        }
+        _mm256_zeroupper();
+        if (i + 2 <= cnt) {
+                nbe642dblx2(vals + i*sizeof(int64_t),&(res[i]));
+                i += 2;
+        }
+        if (i < cnt)
+                nbe642dbls_fixup(vals + i*sizeof(int64_t),&(res[i]),1,0);
+}
+#endif /* CNVRT_X86 */
@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Vector kernels of the batch conversion, selected at runtime by
+ * packet_handler.c/dbls2nbe64 and nbe642dbls. Each kernel is compiled for its
+ * instruction set and may only be called if the cpu supports it.
+ */
+
+#ifndef _CNVRTSIMD_H_
+#define _CNVRTSIMD_H_
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CNVRT_X86
+
+/* converts cnt doubles to big endian int64 in nano units with SSE4.1, returns 1 if a value was out of range */
+int dbls2nbe64_sse41(const double vals[], char *res, int cnt);
+
+/* converts cnt big endian int64 in nano units to doubles with SSE4.1 */
+void nbe642dbls_sse41(const char *vals, double res[], int cnt);
+
+/* converts cnt doubles to big endian int64 in nano units with AVX2, returns 1 if a value was out of range */
+int dbls2nbe64_avx2(const double vals[], char *res, int cnt);
+
+/* converts cnt big endian int64 in nano units to doubles with AVX2 */
+void nbe642dbls_avx2(const char *vals, double res[], int cnt);
+
+#endif
+
+#endif /* _CNVRTSIMD_H_ */
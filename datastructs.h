@@ -25,6 +25,7 @@ enum axsID_t {
 /* struct for the information per axis, this can be either set point or current value */
 struct axsnfo_t {
         double cntrlvl;
+        int64_t ncntrlvl;       //cntrlvl in nano units, used instead of cntrlvl in the fixed-point mode
         double posset;
         double poscur;
         int8_t cntrlsw;
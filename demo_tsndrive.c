@@ -25,6 +25,12 @@
 #include <poll.h>
 #include <linux/net_tstamp.h>
 #include "packet_handler.h"
+#include "xsk_handler.h"
+#include "rt_stats.h"
+#include "pmc_handler.h"
+#include "rt_log.h"
+#include "flt_recorder.h"
+#include "pcap_tap.h"
 #include "axis_sim.h"
 
 //parameters which are fixed at compile time, all values in nano seconds; values should be estimated using cyclictest
@@ -33,6 +39,24 @@
 #define APPSENDWAKEUP 200000            //Duration between wakeup of the thread and the packet being read to send
 #define APPRECVWAKEUP 200000            //Duration between wakeup of the thread and it being ready to receive
 #define MAXWAKEUPJITTER 50000           //worst case Jitter between planned and actual wakeup of thread
+#define HYBWAKEUPJITTER 5000            //worst case Jitter with the hybrid wakeup, the latency of the sleep is covered by spinning
+#define HYBMAXGUARD 100000              //longest guard of the hybrid wakeup, bounds the spinning per cycle
+#define RCVSPIN 50000                   //time spun before the end of the receive window by the hybrid receive wait
+
+#define PMC_RPRTINTRVL 10               //interval in seconds in which the performance counters are reported
+
+//budgets of the profiled stages of the real-time thread, derived from the durations above
+#define STGBDGT_RCV (APPRECVWAKEUP/4)   //getting the frame from the socket
+#define STGBDGT_DCD (APPRECVWAKEUP/4)   //decoding and tracking the sequence number
+#define STGBDGT_SIM (APPSENDWAKEUP/2)   //simulation of all axes
+#define STGBDGT_ENC (APPSENDWAKEUP/4)   //filling the frames
+#define STGBDGT_SND (APPSENDWAKEUP/4)   //handing the frames to the stack
+
+//profiled stages of the real-time thread
+enum rtstg_t {STG_WAIT = 0, STG_RCV, STG_DCD, STG_SIM, STG_ENC, STG_SND, STG_CNT};
+
+//owners of packets from the packetstore
+#define PKTOWNR_RX 0                    //receive path of real-time thread
 
 
 uint8_t run = 1;
@@ -51,16 +75,52 @@ struct cnfg_optns_t{
         enum axsID_t frst_axs;
         uint16_t pubid;
         int prrty;
+        bool rxring;
+        bool cmbnaxs;           //all simulated axes are sent as DataSetMessages of one frame
+        bool fxp;               //axes are simulated in fixed-point, wire values are used unchanged
+        bool drpold;            //drop frames older than an already received one (duplicates, late and stale frames)
+        bool tmstmp;            //RX and TX timestamps of the frames are taken to measure the stack latencies
+        bool prf;               //the durations of the stages of the real-time thread are profiled
+        bool pmc;               //performance counters of the real-time thread are read each cycle
+        int xskmode;            //mode of the AF_XDP socket, -1 if AF_PACKET sockets are used
+        char * fltpath;         //prefix of the dump files of the flight recorder, NULL if disabled
+        char * cappath;         //pcapng file of the captured frames, NULL if disabled
+        enum ovrnplcy_t ovrnplcy;       //handling of the cycles missed by an overrun of the real-time thread
+        bool hybwkup;           //the real-time thread sleeps till a guard before its wakeup and spins the rest
+        enum rcvwtmd_t rcvwtmd;         //strategy of the real-time thread to wait for frames
+        uint32_t wkupjttr;      //wakeup jitter of the real-time thread the timing is planned with
 };
 
 struct tsndrive_t {
         struct cnfg_optns_t cnfg_optns;
         int rxsckt;
         int txsckt;
+        struct rxring_t rxring;
+        struct xsksckt_t xsk;
         struct pktstore_t pkts;
+        struct seqtrck_t seqtrck;
+        struct tmstmpr_t tmstmp;
+        struct ltncystats_t txltncy;    //handing frame to the stack till TX timestamp
+        struct ltncystats_t txdvtn;     //TX timestamp minus planned TxTime
+        struct ltncystats_t rxltncy;    //RX timestamp till handling in the application
+        uint64_t cycl;                  //index of the current cycle
+        struct hybwkup_t wkup;          //sleeping and spinning of the real-time thread
+        struct ltncyhst_t wkuphst;      //wakeup latency of the real-time thread
+        struct rcvwt_t rxwt;            //waiting for the control frames
+        struct ovrntrck_t ovrn;         //overruns of the real-time thread
+        struct stgprf_t prf;            //durations of the stages of the real-time thread
+        struct pmcthrd_t pmc;           //performance counters of the real-time thread
+        struct rtlog_t log;             //messages of the real-time threads
+        struct fltrcrdr_t fltrcrdr;     //last cycles of the real-time thread, dumped on anomalies
+        uint64_t etfdrps;               //frames dropped by the ETF qdisc
+        struct captap_t cap;            //capture of all sent and received frames
+        struct frmtmplt_t axstmplts[4];
         struct axis_t * axes[4];
         pthread_attr_t rtthrd_attr;
         pthread_t rt_thrd;
+        bool rtthrdrun;
+        pthread_t pmc_thrd;
+        bool pmcthrdrun;
 };
 
 /* signal handler */
@@ -95,7 +155,25 @@ static void usage(char *appname)
                 " -i [name]            Name of the Networkinterface to use.\n"
                 " -p                   PublisherID e.g. TalkerID, Default: 0xAC0A\n"
                 " -y                   Priority of sending socket (can be 1-7), Default: 6\n"
+                " -m                   Receive through a memory mapped receive ring.\n"
+                " -x [mode]            Send and receive through an AF_XDP socket on queue 0. XDP mode: 0 generic, 1 native, 2 native zero-copy.\n"
                 " -n [value < 5]       Number of simulated axes. Default 4.\n"
+                " -c                   Send the axis messages of all simulated axes combined in one frame.\n"
+                " -T                   Take RX and TX timestamps of the frames and report the measured stack latencies.\n"
+                " -P                   Profile the durations of the stages of the real-time thread and check them against their budgets.\n"
+                " -C                   Count cycles, instructions, cache and branch misses, context switches and page faults per cycle.\n"
+                " -R [prefix]          Record the last cycles and dump them to prefix_real-time_<n>.bin on a late wake up,\n"
+                "                      sequence gap, ETF drop or overrun.\n"
+                " -k [file]            Capture all sent and received frames to a pcapng file, written by a thread with normal priority.\n"
+                " -O [policy]          Handling of cycles whose TxTime passed before they started (overrun of the real-time thread):\n"
+                "                      0 skip them (default), 1 run them back to back without sending their frames,\n"
+                "                      2 go to the safe state (received values ignored, all axes disabled) and skip them.\n"
+                " -S                   Wake up the real-time thread precisely: sleep till a guard before the wakeup time, which adapts to the\n"
+                "                      measured latency of the sleep, and spin the rest. The wakeup jitter is planned with 5 us instead of 50 us.\n"
+                " -W [strategy]        Waiting for the control frame till the end of the receive window: 0 ppoll (default),\n"
+                "                      1 busy polling of the socket, 2 ppoll and busy polling of the last 50 us.\n"
+                " -d                   Drop received frames which are older than an already received frame.\n"
+                " -f                   Simulate the axes in fixed-point nano units (deterministic, no floating point in the cycle).\n"
                 " -a [index < 4]       Index of the first simulated axis. x = 0, y = 1, z = 2, spindle = 3. Default 0.\n"
                 " -h                   Prints this help message and exits\n"
                 "\n",
@@ -114,10 +192,12 @@ void evalCLI(int argc, char* argv[0],struct tsndrive_t * drivesim)
         drivesim->cnfg_optns.intrvl_ns = 1000000;
         drivesim->cnfg_optns.pubid = 0xAC0A;
         drivesim->cnfg_optns.prrty = 6;
+        drivesim->cnfg_optns.wkupjttr = MAXWAKEUPJITTER;
+        drivesim->cnfg_optns.xskmode = -1;
 
         char* appname = strrchr(argv[0], '/');
         appname = appname ? 1 + appname : argv[0];
-        while (EOF != (c = getopt(argc,argv,"ht:b:o:r:w:s:i:n:a:p:y:"))) {
+        while (EOF != (c = getopt(argc,argv,"ht:b:o:r:w:s:i:n:a:p:y:mx:cfdTPCR:k:O:SW:"))) {
                 switch(c) {
                 case 'b':
                         cnvrt_dbl2tmspc(atof(optarg), &(drivesim->cnfg_optns.basetm));
@@ -153,6 +233,46 @@ void evalCLI(int argc, char* argv[0],struct tsndrive_t * drivesim)
                 case 'y':
                         drivesim->cnfg_optns.prrty = atoi(optarg);
                         break;
+                case 'm':
+                        drivesim->cnfg_optns.rxring = true;
+                        break;
+                case 'x':
+                        drivesim->cnfg_optns.xskmode = atoi(optarg);
+                        break;
+                case 'c':
+                        drivesim->cnfg_optns.cmbnaxs = true;
+                        break;
+                case 'f':
+                        drivesim->cnfg_optns.fxp = true;
+                        break;
+                case 'd':
+                        drivesim->cnfg_optns.drpold = true;
+                        break;
+                case 'T':
+                        drivesim->cnfg_optns.tmstmp = true;
+                        break;
+                case 'P':
+                        drivesim->cnfg_optns.prf = true;
+                        break;
+                case 'C':
+                        drivesim->cnfg_optns.pmc = true;
+                        break;
+                case 'R':
+                        drivesim->cnfg_optns.fltpath = optarg;
+                        break;
+                case 'k':
+                        drivesim->cnfg_optns.cappath = optarg;
+                        break;
+                case 'O':
+                        drivesim->cnfg_optns.ovrnplcy = atoi(optarg);
+                        break;
+                case 'W':
+                        drivesim->cnfg_optns.rcvwtmd = atoi(optarg);
+                        break;
+                case 'S':
+                        drivesim->cnfg_optns.hybwkup = true;
+                        drivesim->cnfg_optns.wkupjttr = HYBWAKEUPJITTER;
+                        break;
                 case 'h':
                 default:
                         usage(appname);
@@ -176,10 +296,18 @@ void evalCLI(int argc, char* argv[0],struct tsndrive_t * drivesim)
                 printf("Specified socket priority is out of rage. Must be between 1 and 7.\n");
                 exit(0);
         }
+        if ((drivesim->cnfg_optns.ovrnplcy < OVRN_SKIP) || (drivesim->cnfg_optns.ovrnplcy > OVRN_SAFE)) {
+                printf("Specified overrun policy is out of range. Must be between 0 and 2.\n");
+                exit(0);
+        }
+        if ((drivesim->cnfg_optns.rcvwtmd < RCVWT_PPOLL) || (drivesim->cnfg_optns.rcvwtmd > RCVWT_HYBRID)) {
+                printf("Specified receive wait is out of range. Must be between 0 and 2.\n");
+                exit(0);
+        }
 }
 
-// open tx socket
-int opntxsckt(int prrty)
+// open tx socket, frames dropped by the qdisc are reported in the error queue if requested
+int opntxsckt(int prrty, bool rprterrs)
 {
         int ok;
         struct sock_txtime soctxtm;
@@ -187,7 +315,7 @@ int opntxsckt(int prrty)
         if (sckt < 0)
                 return sckt;      //fail
         soctxtm.clockid = CLOCK_TAI;
-        soctxtm.flags = 0;
+        soctxtm.flags = rprterrs ? SOF_TXTIME_REPORT_ERRORS : 0;
         ok = setsockopt(sckt,SOL_SOCKET,SO_TXTIME,&soctxtm,sizeof(soctxtm));
         if (ok != 0)
                 printf("Warning: Setting of Socketoption TXTIME failed (TX). Error: %d \n",errno);
@@ -204,6 +332,13 @@ int init(struct tsndrive_t *drivesim)
         int ok = 0;
         struct sched_param param;
         unsigned char mac[ETH_ALEN];
+        struct sockaddr_ll snd_addr;
+
+        //messages of the real-time threads are printed by the log thread, first so cleanup can always stop it
+        initrtlog(&(drivesim->log),stdout);
+        //capture file, also first so cleanup can always close it
+        if (initcaptap(&(drivesim->cap),drivesim->cnfg_optns.cappath,drivesim->cnfg_optns.ifname) != 0)
+                return 1;
 
         //set standard addresses
         memset(&mac,0,sizeof(char)*ETH_ALEN);
@@ -232,13 +367,29 @@ int init(struct tsndrive_t *drivesim)
         memcpy(drivesim->cnfg_optns.snd_macs[3],mac,ETH_ALEN);
         
         //open send socket
-        drivesim->txsckt = opntxsckt(drivesim->cnfg_optns.prrty);
+        drivesim->txsckt = opntxsckt(drivesim->cnfg_optns.prrty, drivesim->cnfg_optns.fltpath != NULL);
         if (drivesim->txsckt < 0) {
                 printf("TX Socket open failed. \n");
                 drivesim->txsckt = 0;
                 return 1;
         }
 
+        //prepare one frame template for each simulated axis, sending addresses are static
+        //combined: one frame template with a DataSetMessage for each simulated axis, sent to the address of the first axis
+        for (int i = 0; i < drivesim->cnfg_optns.num_axs;i++) {
+                ok = fillethaddr(&snd_addr, drivesim->cnfg_optns.snd_macs[drivesim->cnfg_optns.frst_axs + i], ETHERTYPE, drivesim->txsckt, drivesim->cnfg_optns.ifname);
+                if (drivesim->cnfg_optns.cmbnaxs)
+                        ok += inittmplt(&(drivesim->axstmplts[i]),drivesim->cnfg_optns.num_axs,AXS,drivesim->cnfg_optns.pubid,&snd_addr);
+                else
+                        ok += inittmplt(&(drivesim->axstmplts[i]),1,AXS,drivesim->cnfg_optns.pubid,&snd_addr);
+                if (ok != 0) {
+                        printf("Preparing of frame templates failed. \n");
+                        return 1;
+                }
+                if (drivesim->cnfg_optns.cmbnaxs)
+                        break;
+        }
+
         //open recv socket
         drivesim->rxsckt = opnrxsckt(drivesim->cnfg_optns.ifname,drivesim->cnfg_optns.rcvaddr,1);
         if (drivesim->rxsckt < 0) {
@@ -246,9 +397,44 @@ int init(struct tsndrive_t *drivesim)
                 drivesim->rxsckt = 0;
                 return 1;
         }
+        if (drivesim->cnfg_optns.rxring && (opnrxring(&(drivesim->rxring),drivesim->rxsckt) != 0)) {
+                printf("RX ring setup failed. \n");
+                return 1;
+        }
+        //the AF_XDP socket replaces both sockets in the real-time path, the RX socket still subscribes the multicast addresses
+        drivesim->xsk.fd = -1;
+        if ((drivesim->cnfg_optns.xskmode >= 0) && (opnxsk(&(drivesim->xsk),drivesim->cnfg_optns.ifname,0,drivesim->cnfg_optns.xskmode) != 0)) {
+                printf("AF_XDP socket setup failed. \n");
+                return 1;
+        }
+        if (initrcvwt(&(drivesim->rxwt),drivesim->cnfg_optns.rcvwtmd,(drivesim->cnfg_optns.xskmode >= 0) ? drivesim->xsk.fd : drivesim->rxsckt,RCVSPIN) != 0) {
+                printf("Setting up the receive wait failed. \n");
+                return 1;
+        }
         
+        //timestamps are taken by the sockets, not available with the AF_XDP socket
+        if (drivesim->cnfg_optns.tmstmp && (drivesim->cnfg_optns.xskmode >= 0)) {
+                printf("Warning: Timestamping is not supported with the AF_XDP socket. \n");
+                drivesim->cnfg_optns.tmstmp = false;
+        }
+        if (drivesim->cnfg_optns.tmstmp) {
+                if ((enbltmstmp(&(drivesim->tmstmp),drivesim->txsckt,drivesim->cnfg_optns.ifname,TMSTMP_TX) != 0) ||
+                    (enbltmstmp(&(drivesim->tmstmp),drivesim->rxsckt,drivesim->cnfg_optns.ifname,TMSTMP_RX) != 0)) {
+                        printf("Enabling of timestamps failed. \n");
+                        return 1;
+                }
+                printf("Using %s timestamps. \n", drivesim->tmstmp.hw ? "hardware" : "software");
+        }
+
         //allocate memory for packets
         ok += initpktstrg(&(drivesim->pkts),6);
+        initseqtrck(&(drivesim->seqtrck));
+
+        //flight recorder, allocated before the memory is locked
+        if (initfltrcrdr(&(drivesim->fltrcrdr),"real-time",drivesim->cnfg_optns.fltpath,drivesim->cnfg_optns.wkupjttr) != 0) {
+                printf("Allocating the flight recorder failed. \n");
+                return 1;
+        }
 
         //create correct no of axis
         for  (int i = 0; i < drivesim->cnfg_optns.num_axs;i++) {
@@ -260,6 +446,8 @@ int init(struct tsndrive_t *drivesim)
                 drivesim->axes[i] = NULL;
         }
         ok = axes_initreq(drivesim->axes, drivesim->cnfg_optns.num_axs, drivesim->cnfg_optns.frst_axs);
+        if (drivesim->cnfg_optns.fxp)
+                axes_setfxp(drivesim->axes, drivesim->cnfg_optns.num_axs);
 
         //prefault stack/heap --> done by mlocking APIs
 
@@ -301,15 +489,43 @@ int init(struct tsndrive_t *drivesim)
                 printf("pthread setinheritsched failed\n");
                 return 1;
         }
-        //detach thread since returnvalue does not matter
-        ok = pthread_attr_setdetachstate(&(drivesim->rtthrd_attr),PTHREAD_CREATE_DETACHED);
+        //joinable, the thread must have ended before its resources are freed
+        ok = pthread_attr_setdetachstate(&(drivesim->rtthrd_attr),PTHREAD_CREATE_JOINABLE);
         if (ok) {
-                printf("pthread setdetached failed\n");
+                printf("pthread setjoinable failed\n");
                 return 1;
         }
 
-        //OPTIONAL: setup pmc-thread (optional)
+        //wakeup latencies are checked against the assumed worst case jitter
+        inithst(&(drivesim->wkuphst),drivesim->cnfg_optns.wkupjttr);
+        initovrn(&(drivesim->ovrn),drivesim->cnfg_optns.ovrnplcy);
+        inithybwkup(&(drivesim->wkup),drivesim->cnfg_optns.hybwkup ? MAXWAKEUPJITTER : 0,HYBMAXGUARD);
+
+        //stage profile, waiting for the frame may take the whole receive window
+        if (drivesim->cnfg_optns.prf) {
+                const char *stgnms[STG_CNT] = {"wait", "receive", "decode", "simulate", "encode", "send"};
+                const int64_t stgbdgts[STG_CNT] = {APPRECVWAKEUP + drivesim->cnfg_optns.wkupjttr + drivesim->cnfg_optns.rcvwndw,
+                                                   STGBDGT_RCV, STGBDGT_DCD, STGBDGT_SIM, STGBDGT_ENC, STGBDGT_SND};
+                ok = initstgprf(&(drivesim->prf),stgnms,stgbdgts,STG_CNT);
+                if (ok)
+                        return 1;
+        }
 
+        //performance counters, opened by the pmc-thread when the real-time thread runs
+        initpmcthrd(&(drivesim->pmc),"real-time");
+
+        return ok;
+}
+
+//stop the real-time thread and wait till it has ended, it uses the recorder, counters, capture and sockets till then
+int stprtthrd(struct tsndrive_t *drivesim)
+{
+        int ok = 0;
+        if (!drivesim->rtthrdrun)
+                return 0;       //not started or already stopped
+        ok = pthread_cancel(drivesim->rt_thrd);
+        ok += pthread_join(drivesim->rt_thrd,NULL);
+        drivesim->rtthrdrun = false;
         return ok;
 }
 
@@ -318,10 +534,22 @@ int cleanup(struct tsndrive_t *drivesim)
 {
         int ok = 0;
         //stop threads
-        ok = pthread_cancel(drivesim->rt_thrd);
-        //maybe need to wait until thread has ended?
+        ok = stprtthrd(drivesim);
+        if (drivesim->pmcthrdrun) {
+                pthread_cancel(drivesim->pmc_thrd);
+                pthread_join(drivesim->pmc_thrd,NULL);
+                drivesim->pmcthrdrun = false;
+        }
+        clspmcthrd(&(drivesim->pmc));
+
+        stprtlog(&(drivesim->log));
+        stpcaptap(&(drivesim->cap));
+        clsfltrcrdr(&(drivesim->fltrcrdr));
 
         //close rx socket
+        clsrxring(&(drivesim->rxring));
+        if (drivesim->cnfg_optns.xskmode >= 0)
+                clsxsk(&(drivesim->xsk));
         ok += close(drivesim->rxsckt);
         
         //close tx socket
@@ -329,6 +557,8 @@ int cleanup(struct tsndrive_t *drivesim)
 
         //free allocated memory for packets
         ok += destroypktstrg(&(drivesim->pkts));
+        for (int i = 0;i<4;i++)
+                destroytmplt(&(drivesim->axstmplts[i]));
 
         free(drivesim->cnfg_optns.rcvaddr[0]);
         for (int i = 0;i<4;i++){
@@ -345,123 +575,231 @@ int cleanup(struct tsndrive_t *drivesim)
 }
 
 //receive and parse and ... a packet with a control message
-int rcv_cntrlmsg(struct tsndrive_t* drivesim,struct cntrlnfo_t * cntrlnfo)
+//give a received packet back to the packet store or the frame back to the receive ring
+void rls_rcvdpkt(struct tsndrive_t* drivesim, struct rt_pkt_t **rcvd_pkt)
+{
+        if (drivesim->cnfg_optns.xskmode >= 0)
+                rlsxskpkts(&(drivesim->xsk));
+        else if (drivesim->cnfg_optns.rxring)
+                rlsringpkts(&(drivesim->rxring));
+        else
+                retusedpkt(&(drivesim->pkts),rcvd_pkt);
+}
+
+int rcv_cntrlmsg(struct tsndrive_t* drivesim,struct cntrlnfo_t * cntrlnfo, const struct timespec *rcvdln)
 {
         int ok = 0;
         struct rt_pkt_t *rcvd_pkt;
+        struct rt_pkt_t ring_pkt;
         struct msghdr rcvd_msghdr;
-        enum msgtyp_t msg_typ;
-        int poll_tmout;
-        if (drivesim->cnfg_optns.rcvwndw >= 1000000) {
-                poll_tmout = drivesim->cnfg_optns.rcvwndw/1000000;
-        } else {
-                poll_tmout = 0;
-        }
-
-
-        struct pollfd fds[1] = {};
-        fds[0].fd = drivesim->rxsckt;
-        fds[0].events = POLLIN;
+        uint16_t pubid;
+        uint16_t seqno;
+        enum seqrslt_t seqrslt;
+        struct timespec curtm;
 
-        union dtstmsg_t *dtstmsgs[1] = {NULL};
-        int dtstmsgcnt;
+        enum dcderr_t dcderr;
 
-        //check for RX-packet
-        ok = poll(fds,1,poll_tmout);
+        //wait for RX-packet till the end of the receive window
+        ok = rcvwt(&(drivesim->rxwt),rcvdln);
         if (ok <= 0)
                 return -1;      //continue
+        endstg(&(drivesim->prf),STG_WAIT);
        
-        //receive paket
-        ok = getfreepkt(&(drivesim->pkts),&rcvd_pkt);
-        if (ok == 1) {
-                printf("Could not get free packet for receiving. \n");
-                return 1;       //hardfail
-        }
-        ok = rcvpkt(drivesim->rxsckt, rcvd_pkt, &rcvd_msghdr);
-        if (ok == 1) {
-                printf("Receive failed. \n");
-                retusedpkt(&(drivesim->pkts),&rcvd_pkt);
-                return 1;       //hardfail
-        }
-
-        // check ETH-header
-        ok = chckethhdr(rcvd_pkt, drivesim->cnfg_optns.rcvaddr, 1);
-        if (ok == -1) {
-                printf("Check ETH-Header failed. \n");
-                retusedpkt(&(drivesim->pkts),&rcvd_pkt);
-                return -1;       //continue
+        if (drivesim->cnfg_optns.xskmode >= 0) {
+                //parse frame in place from the UMEM of the AF_XDP socket
+                rcvd_pkt = &ring_pkt;
+                if (rcvxskpkt(&(drivesim->xsk), rcvd_pkt) != 0)
+                        return -1;      //continue
+        } else if (drivesim->cnfg_optns.rxring) {
+                //parse frame in place from the receive ring
+                rcvd_pkt = &ring_pkt;
+                if (rcvringpkt(&(drivesim->rxring), rcvd_pkt, NULL) != 0)
+                        return -1;      //continue
+        } else {
+                //receive paket
+                ok = getfreepkt(&(drivesim->pkts),&rcvd_pkt,PKTOWNR_RX);
+                if (ok == 1) {
+                        rtlog(LOG_NOFREEPKT,NULL,0,0,0);
+                        return 1;       //hardfail
+                }
+                ok = rcvpkt(drivesim->rxsckt, rcvd_pkt, &rcvd_msghdr);
+                if (ok == 1) {
+                        rtlog(LOG_RCVERR,NULL,0,0,0);
+                        retusedpkt(&(drivesim->pkts),&rcvd_pkt);
+                        return 1;       //hardfail
+                }
         }
-        //parse RX-packet
-        ok = prspkt(rcvd_pkt, &msg_typ);
-        if ((ok == -1) || (msg_typ != CNTRL)) {
-                printf("Parsing of received packet failed, or packet not a CNTRL-packet. type %d; ok: %d\n", msg_typ, ok);
-                retusedpkt(&(drivesim->pkts),&rcvd_pkt);
+
+        endstg(&(drivesim->prf),STG_RCV);
+
+        //check and decode RX-packet in a single pass
+        if (drivesim->cnfg_optns.fxp)
+                dcderr = dcdcntrlfrmfxp(rcvd_pkt, drivesim->cnfg_optns.rcvaddr, 1, cntrlnfo);
+        else
+                dcderr = dcdcntrlfrm(rcvd_pkt, drivesim->cnfg_optns.rcvaddr, 1, cntrlnfo);
+        drivesim->fltrcrdr.rcrd->rets[STG_DCD] = dcderr;
+        if (dcderr != DCD_OK) {
+                rtlog(LOG_DCDFAIL,dcderrstr(dcderr),0,0,0);
+                rls_rcvdpkt(drivesim,&rcvd_pkt);
                 return -1;       //continue
         }
-        ok = chckpkthdrs(rcvd_pkt);
-        if (ok == 1) {
-                printf("Check Packet-Headers failed. \n");
-                retusedpkt(&(drivesim->pkts),&rcvd_pkt);
-                return -1;       //continue
+        //latency from receiving the frame at the NIC till handling it
+        if (drivesim->cnfg_optns.tmstmp && (rcvd_pkt->rxtmstmp != 0)) {
+                clock_gettime(CLOCK_TAI,&curtm);
+                updtltncy(&(drivesim->rxltncy), (int64_t) (cnvrt_tmspc2int64(&curtm) - tmstmp2tai(&(drivesim->tmstmp),rcvd_pkt->rxtmstmp,rcvd_pkt->rxhw)));
         }
-
-        //OPTIONAL: might want to check sequence number
-        ok = prsdtstmsg(rcvd_pkt, msg_typ, dtstmsgs, &dtstmsgcnt);
-
-        // expected to have only one datasetmessage
-        ok = prscntrlmsg(dtstmsgs[0],cntrlnfo);
-        retusedpkt(&(drivesim->pkts),&rcvd_pkt);
+        //track sequence number, older frames would set values back
+        dcdseqhdr(rcvd_pkt, &pubid, &seqno);
+        seqrslt = trckseq(&(drivesim->seqtrck), pubid, WRITERID_CNTRL, seqno);
+        drivesim->fltrcrdr.rcrd->rxseq = seqno;
+        if (seqrslt == SEQ_GAP)
+                trgfltrcrdr(&(drivesim->fltrcrdr),FLTTRG_SEQGAP);
+        rls_rcvdpkt(drivesim,&rcvd_pkt);
+        endstg(&(drivesim->prf),STG_DCD);
+        if (drivesim->cnfg_optns.drpold && seqisold(seqrslt))
+                return -1;       //continue
         return 0;       //success
 
 }
 
-int snd_axsmsg(struct tsndrive_t* drivesim, struct sockaddr_ll *snd_addr, struct axsnfo_t* axsnfo, struct timespec * txtm, uint16_t * seqno)
+//fill and send one packet with the axis messages of all simulated axes at the TxTime of the first simulated axis
+//time of handing the frames to the stack for the TX latency, 0 without timestamps
+static uint64_t sndtmstmp(struct tsndrive_t* drivesim)
 {
-        int ok = 0;
-        struct rt_pkt_t *snd_pkt;
-        struct msghdr snd_msghdr;
-        struct timespec axs_txtime;
+        struct timespec curtm;
+        if (!drivesim->cnfg_optns.tmstmp)
+                return 0;
+        clock_gettime(CLOCK_TAI,&curtm);
+        return cnvrt_tmspc2int64(&curtm);
+}
 
-        axs_txtime.tv_nsec = 0;
-        axs_txtime.tv_sec = 0;
-        tmspc_add(&axs_txtime,&axs_txtime, txtm);
+//collect the TX timestamps of the frames sent so far and update the latencies
+static void clct_txtmstmps(struct tsndrive_t* drivesim)
+{
+        struct txtmstmp_t txtss[8];
+        int cnt;
+        do {
+                cnt = rcvtxtmstmps(&(drivesim->tmstmp),txtss,8);
+                for (int i = 0; i < cnt; i++) {
+                        updtltncy(&(drivesim->txltncy), (int64_t) (txtss[i].tmstmp - txtss[i].sndtm));
+                        updtltncy(&(drivesim->txdvtn), (int64_t) (txtss[i].tmstmp - txtss[i].txtime));
+                }
+        } while (cnt == 8);
+}
 
-        switch(axsnfo->axsID){
-        case x:
-                break;
-        case y:
-                inc_tm(&axs_txtime,drivesim->cnfg_optns.sndwndw);
-                break;
-        case z: 
-                inc_tm(&axs_txtime,drivesim->cnfg_optns.sndwndw*2);
-                break;
-        case s:
-                inc_tm(&axs_txtime,drivesim->cnfg_optns.sndwndw*3);
-                break;
-        default:
-                return 1;       //fail
-                break;
+//check for frames of the last cycles dropped by the ETF qdisc, they trigger the flight recorder
+static void chk_etfdrps(struct tsndrive_t* drivesim)
+{
+        int drps;
+        if ((drivesim->cnfg_optns.fltpath == NULL) || (drivesim->cnfg_optns.xskmode >= 0))
+                return;
+        if (drivesim->cnfg_optns.tmstmp)
+                drps = drivesim->tmstmp.etfdrps - drivesim->etfdrps;     //error queue is read with the TX timestamps
+        else
+                drps = rcvetfdrps(drivesim->txsckt);
+        if (drps > 0) {
+                drivesim->etfdrps += drps;
+                trgfltrcrdr(&(drivesim->fltrcrdr),FLTTRG_ETFDRP);
         }
+}
 
-        //get and fill TX-Packet
-        ok = getfreepkt(&(drivesim->pkts),&snd_pkt);
-        if (ok == 1){
-                printf("Could not get free packet for sending. \n");
+//value in nano units for the flight recorder
+static int64_t rcrdval(double val)
+{
+        int64_t res = 0;
+        dbl2nint64(val,&res);
+        return res;
+}
+
+//set-points of the received control message for the flight recorder
+static void rcrdsetpnts(struct tsndrive_t* drivesim, struct fltrcrd_t *fltrcrd, struct cntrlnfo_t *cntrlnfo)
+{
+        struct axsnfo_t *sets[4] = {&(cntrlnfo->x_set), &(cntrlnfo->y_set), &(cntrlnfo->z_set), &(cntrlnfo->s_set)};
+        if (drivesim->cnfg_optns.fltpath == NULL)
+                return;
+        for (int i = 0; i < 4; i++)
+                fltrcrd->vals[i] = drivesim->cnfg_optns.fxp ? sets[i]->ncntrlvl : rcrdval(sets[i]->cntrlvl);
+}
+
+int snd_cmbndaxsmsgs(struct tsndrive_t* drivesim, struct axsnfo_t axsnfos[], uint64_t frst_txtime, uint16_t seqnos[])
+{
+        int ok = 0;
+        struct frmtmplt_t *tmplts[1];
+        uint64_t txtime;
+        uint64_t sndtm;
+        int err;
+
+        if ((axsnfos[0].axsID < x) || (axsnfos[0].axsID > s))
                 return 1;       //fail
-        }
-        ok += setpkt(snd_pkt,1,AXS,drivesim->cnfg_optns.pubid);
-        ok += fillaxspkt(snd_pkt,axsnfo,*seqno);
+        txtime = frst_txtime + (uint64_t) drivesim->cnfg_optns.sndwndw*axsnfos[0].axsID;
+        tmplts[0] = &(drivesim->axstmplts[0]);
+        if (drivesim->cnfg_optns.fxp)
+                ok = fillaxspktsfxp(tmplts[0]->pkt,axsnfos,drivesim->cnfg_optns.num_axs,seqnos[0]);
+        else
+                ok = fillaxspkts(tmplts[0]->pkt,axsnfos,drivesim->cnfg_optns.num_axs,seqnos[0]);
         if (ok != 0){
-                printf("Error in filling sending packet or corresponding headers.\n");
+                rtlog(LOG_FILLFAIL,NULL,0,0,0);
                 return 1;       //fail
         }
-        //send TX-Packet
-        ok += sendpkt(drivesim->txsckt,snd_pkt->sktbf,snd_pkt->len,snd_addr,cnvrt_tmspc2int64(&axs_txtime),CLOCK_TAI);
-        if (0 == ok)
-                *seqno++;    //sending packet succeded
+        endstg(&(drivesim->prf),STG_ENC);
+        sndtm = sndtmstmp(drivesim);
+        if (drivesim->cnfg_optns.xskmode >= 0)
+                sndxsktmplts(&(drivesim->xsk),tmplts,&txtime,1,&err);
+        else
+                sendtmplts(drivesim->txsckt,tmplts,&txtime,1,&err);
+        endstg(&(drivesim->prf),STG_SND);
+        if (err != 0)
+                return 1;       //fail
+        rgsttx(&(drivesim->tmstmp),sndtm,txtime,drivesim->cycl);
+        seqnos[0]++;
+        return 0;       //succeded
+}
+
+//fill and send the packets with the axis messages of all simulated axes
+int snd_axsmsgs(struct tsndrive_t* drivesim, struct axsnfo_t axsnfos[], uint64_t frst_txtime, uint16_t seqnos[])
+{
+        int ok = 0;
+        struct frmtmplt_t *tmplts[4];
+        uint64_t txtimes[4];
+        int errs[4];
+        uint64_t sndtm;
+
+        if (drivesim->cnfg_optns.cmbnaxs)
+                return snd_cmbndaxsmsgs(drivesim, axsnfos, frst_txtime, seqnos);
+        for (int i = 0; i < drivesim->cnfg_optns.num_axs; i++) {
+                //TxTime of an axis is offset by one send window per axis from the TxTime of the x-axis
+                if ((axsnfos[i].axsID < x) || (axsnfos[i].axsID > s))
+                        return 1;       //fail
+                txtimes[i] = frst_txtime + (uint64_t) drivesim->cnfg_optns.sndwndw*axsnfos[i].axsID;
 
-        //return packet to store
-        ok += retusedpkt(&(drivesim->pkts),&snd_pkt);
+                //fill TX-Packet of the prepared frame template
+                tmplts[i] = &(drivesim->axstmplts[i]);
+                if (drivesim->cnfg_optns.fxp)
+                        ok = fillaxspktsfxp(tmplts[i]->pkt,&(axsnfos[i]),1,seqnos[i]);
+                else
+                        ok = fillaxspkt(tmplts[i]->pkt,&(axsnfos[i]),seqnos[i]);
+                if (ok != 0){
+                        rtlog(LOG_FILLFAIL,NULL,0,0,0);
+                        return 1;       //fail
+                }
+        }
+        endstg(&(drivesim->prf),STG_ENC);
+
+        //send TX-Packets of all axes with a single system call
+        sndtm = sndtmstmp(drivesim);
+        if (drivesim->cnfg_optns.xskmode >= 0)
+                sndxsktmplts(&(drivesim->xsk),tmplts,txtimes,drivesim->cnfg_optns.num_axs,errs);
+        else
+                sendtmplts(drivesim->txsckt,tmplts,txtimes,drivesim->cnfg_optns.num_axs,errs);
+        endstg(&(drivesim->prf),STG_SND);
+        for (int i = 0; i < drivesim->cnfg_optns.num_axs; i++) {
+                if (errs[i] == 0) {
+                        seqnos[i]++;    //sending packet succeded
+                        rgsttx(&(drivesim->tmstmp),sndtm,txtimes[i],drivesim->cycl);
+                } else {
+                        ok = 1;
+                }
+        }
         return ok;
 }
 
@@ -471,36 +809,36 @@ void *rt_thrd(void *tsndrivesim)
 	int ok = 0;
         int rcv_ok = 0;
         struct tsndrive_t *drivesim = (struct tsndrive_t *) tsndrivesim;
-        struct timespec est;
+        struct cycltmln_t tmln;
+        int64_t wkupoffs;
+        int64_t txoffs;                 //offset of the txtime of x-axis, reagrdless if simulated
         struct timespec wkuprcvtm;
-        struct timespec txtime;
+        struct timespec rcvdln;         //end of the receive window
         
-
-        struct sockaddr_ll snd_addrs[4];
         uint16_t snd_seqno[4] = {0,0,0,0};
         
-        struct timespec frst_txtime;    //txtime of x-axis, reagrdless if simulated
+        uint64_t frst_txtime;           //txtime of x-axis, reagrdless if simulated
 
         struct cntrlnfo_t rcv_cntrlnfo;
-        struct axsnfo_t snd_axsnfo;
+        struct axsnfo_t snd_axsnfo[4];
+        struct fltrcrd_t *fltrcrd;
+        uint64_t mssd;
         double tmstp;
         tmstp = (double) drivesim->cnfg_optns.intrvl_ns/1000000000;
 
-        //init sending address since it will be static
-        for (int i = 0; i < drivesim->cnfg_optns.num_axs;i++) {
-                ok = fillethaddr(&(snd_addrs[i]), drivesim->cnfg_optns.snd_macs[drivesim->cnfg_optns.frst_axs + i], ETHERTYPE, drivesim->txsckt, drivesim->cnfg_optns.ifname);
-        }
-        
+        //counters of this thread can be opened from now on
+        rgstpmcthrd(&(drivesim->pmc));
+
         /*sleep this (basetime minus one period) is reached
         or (basetime plus multiple periods) */
         clock_gettime(CLOCK_TAI,&wkuprcvtm);
-        clc_est(&wkuprcvtm,&(drivesim->cnfg_optns.basetm), drivesim->cnfg_optns.intrvl_ns, &est);
-        frst_txtime = clc_txtm(&est,drivesim->cnfg_optns.sndoffst,SENDINGSTACK_DURATION);
-        wkuprcvtm = clc_rcvwkuptm(&est,drivesim->cnfg_optns.rcvoffst,RECEIVINGSTACK_DURATION,APPRECVWAKEUP,MAXWAKEUPJITTER);
+        inittmln(&tmln,cnvrt_tmspc2int64(&(drivesim->cnfg_optns.basetm)),drivesim->cnfg_optns.intrvl_ns,cnvrt_tmspc2int64(&wkuprcvtm));
+        txoffs = clc_txoffs(drivesim->cnfg_optns.sndoffst,SENDINGSTACK_DURATION);
+        wkupoffs = clc_rcvwkupoffs(drivesim->cnfg_optns.rcvoffst,RECEIVINGSTACK_DURATION,APPRECVWAKEUP,drivesim->cnfg_optns.wkupjttr);
 
         ok = 0;
-        while (cmptmspc_Ab4rB(&frst_txtime, &wkuprcvtm)) {
-                inc_tm(&frst_txtime,drivesim->cnfg_optns.intrvl_ns);
+        while (txoffs < wkupoffs) {
+                txoffs += drivesim->cnfg_optns.intrvl_ns;
                 ok++;
         }
         if (ok > 0)
@@ -509,38 +847,74 @@ void *rt_thrd(void *tsndrivesim)
                        "         To fix this, adjust network schedule and/or reduce stack calculation time.\n", ok);
 
         //sleep till first wakeup time
-        clock_nanosleep(CLOCK_TAI, TIMER_ABSTIME, &wkuprcvtm, NULL);
+        frst_txtime = tmln_tm(&tmln,drivesim->cycl,txoffs);
+        cnvrt_int642tmspc(tmln_tm(&tmln,drivesim->cycl,wkupoffs),&wkuprcvtm);
+        cnvrt_int642tmspc(tmln_tm(&tmln,drivesim->cycl,wkupoffs + drivesim->cnfg_optns.rcvwndw),&rcvdln);
+        if (hybwkup(&(drivesim->wkup),&wkuprcvtm) == 0)
+                updtwkuphst(&(drivesim->wkuphst),&wkuprcvtm);
+        fltrcrd = strtfltcycl(&(drivesim->fltrcrdr),drivesim->cycl,&wkuprcvtm);
+        smplpmc(&(drivesim->pmc));
+        strtstg(&(drivesim->prf));
         
         ok = 0;
         //while loop
         while(true){
                                 
                 //receive control message
-                rcv_ok = rcv_cntrlmsg(drivesim,&rcv_cntrlnfo);      //limitation: only one controlmsg per timeframe is processed
+                rcv_ok = rcv_cntrlmsg(drivesim,&rcv_cntrlnfo,&rcvdln);      //limitation: only one controlmsg per timeframe is processed
+                fltrcrd->rets[STG_RCV] = rcv_ok;
                 if (rcv_ok > 0){
-                        printf("fatal error during receive\n");
+                        rtlog(LOG_FATAL,"receive",0,0,0);
                         return NULL; //fail
                 }
+                //safe state after an overrun: received values are ignored and all axes disabled
+                if (drivesim->ovrn.safe) {
+                        memset(&rcv_cntrlnfo,0,sizeof(struct cntrlnfo_t));
+                        rcv_ok = 0;
+                }
 
+                strtstg(&(drivesim->prf));
                 if (rcv_ok == 0) {
                         //update enable values
                         ok = axes_updt_enbl(drivesim->axes,drivesim->cnfg_optns.num_axs,&rcv_cntrlnfo);
+                        fltrcrd->rets[STG_SIM] = ok;
+                        rcrdsetpnts(drivesim,fltrcrd,&rcv_cntrlnfo);
                 }
                 
-                // calc new new position values and send current positions
+                // calc new new position values
                 for(int i= 0; i < drivesim->cnfg_optns.num_axs;i++) {
                         //calc new positions and fill sending axs_nfo
-                        axs_fineclcpstn(drivesim->axes[i],tmstp,FINEITERATIONS);
-                
-                        snd_axsnfo.axsID = drivesim->axes[i]->axs;
-                        snd_axsnfo.cntrlvl = drivesim->axes[i]->cur_pos;
-                        snd_axsnfo.cntrlsw = drivesim->axes[i]->flt;
-                        //generate and send packet
-                        ok = snd_axsmsg(drivesim, &(snd_addrs[i]), &snd_axsnfo, &frst_txtime, &(snd_seqno[i]));
-                        if (ok != 0){
-                                printf("fatal error during send\n");
-                                return NULL; //fail
+                        snd_axsnfo[i].axsID = drivesim->axes[i]->axs;
+                        if (drivesim->cnfg_optns.fxp) {
+                                axs_fxpfineclcpstn(drivesim->axes[i],drivesim->cnfg_optns.intrvl_ns,FINEITERATIONS);
+                                snd_axsnfo[i].ncntrlvl = axs_fxpgetpstn(drivesim->axes[i]);
+                                fltrcrd->vals[4 + snd_axsnfo[i].axsID] = snd_axsnfo[i].ncntrlvl;
+                        } else {
+                                axs_fineclcpstn(drivesim->axes[i],tmstp,FINEITERATIONS);
+                                snd_axsnfo[i].cntrlvl = drivesim->axes[i]->cur_pos;
+                                fltrcrd->vals[4 + snd_axsnfo[i].axsID] = rcrdval(snd_axsnfo[i].cntrlvl);
                         }
+                        snd_axsnfo[i].cntrlsw = drivesim->axes[i]->flt;
+                }
+                endstg(&(drivesim->prf),STG_SIM);
+                //collect TX timestamps of the frames of the last cycles
+                if (drivesim->cnfg_optns.tmstmp) {
+                        clct_txtmstmps(drivesim);
+                        strtstg(&(drivesim->prf));
+                }
+                chk_etfdrps(drivesim);
+                //generate and send packets of all axes, the TxTime of a cycle which is caught up after an overrun already passed
+                if (drivesim->ovrn.lt) {
+                        fltrcrd->txtm = 0;
+                        ok = 0;
+                } else {
+                        fltrcrd->txtm = frst_txtime;
+                        ok = snd_axsmsgs(drivesim, snd_axsnfo, frst_txtime, snd_seqno);
+                }
+                fltrcrd->rets[STG_SND] = ok;
+                if (ok != 0){
+                        rtlog(LOG_FATAL,"send",0,0,0);
+                        return NULL; //fail
                 }
 
                 if (rcv_ok == 0) {
@@ -548,21 +922,60 @@ void *rt_thrd(void *tsndrivesim)
                         ok = axes_updt_setvel(drivesim->axes, drivesim->cnfg_optns.num_axs, &rcv_cntrlnfo);
                 }
 
-                //update time
-                inc_tm(&wkuprcvtm,drivesim->cnfg_optns.intrvl_ns);
-                inc_tm(&frst_txtime,drivesim->cnfg_optns.intrvl_ns);
+                //check that all packets of this cycle were returned to the store
+                if (cntownpkts(&(drivesim->pkts),PKTOWNR_RX) != 0)
+                        rtlog(LOG_PKTLEAK,"real-time",rclmownpkts(&(drivesim->pkts),PKTOWNR_RX),0,0);
 
-                //sleep until the next cycle
-                clock_nanosleep(CLOCK_TAI, TIMER_ABSTIME, &wkuprcvtm, NULL);
+                drivesim->cycl++;
+
+                //sleep until the next cycle, cycles whose TxTime passed before they started are handled by the overrun policy
+                mssd = 0;
+                do {
+                        //update time from the index of the cycle
+                        cnvrt_int642tmspc(tmln_tm(&tmln,drivesim->cycl,wkupoffs),&wkuprcvtm);
+                        cnvrt_int642tmspc(tmln_tm(&tmln,drivesim->cycl,wkupoffs + drivesim->cnfg_optns.rcvwndw),&rcvdln);
+                        frst_txtime = tmln_tm(&tmln,drivesim->cycl,txoffs);
+                        if (hybwkup(&(drivesim->wkup),&wkuprcvtm) == 0)
+                                updtwkuphst(&(drivesim->wkuphst),&wkuprcvtm);
+                        mssd += chckovrn(&(drivesim->ovrn),&tmln,&(drivesim->cycl),txoffs);
+                } while (drivesim->ovrn.lt && (drivesim->ovrn.plcy != OVRN_CATCHUP));
+                fltrcrd = strtfltcycl(&(drivesim->fltrcrdr),drivesim->cycl,&wkuprcvtm);
+                if (mssd > 0) {
+                        trgfltrcrdr(&(drivesim->fltrcrdr),FLTTRG_OVERRUN);
+                        rtlog(LOG_OVERRUN,"real-time",mssd,drivesim->cycl,0);
+                }
+                //counts of the last cycle, read before the profile starts
+                smplpmc(&(drivesim->pmc));
+                strtstg(&(drivesim->prf));
         }
 
         return NULL;
 }
 
+//monitoring thread of the performance counters, not real-time
+void *pmc_thrd(void *tsndrivesim)
+{
+        struct tsndrive_t *drivesim = (struct tsndrive_t *) tsndrivesim;
+        int ok;
+
+        //wait till the real-time thread registered itself
+        while ((ok = opnpmcthrd(&(drivesim->pmc))) == -1)
+                usleep(1000);
+        if (ok != 0)
+                return NULL;    //fail
+        while (true) {
+                sleep(PMC_RPRTINTRVL);
+                prtpmc(&(drivesim->pmc));
+        }
+        return NULL;
+}
+
 int main(int argc, char* argv[])
 {
         struct tsndrive_t drivesim;
+        struct ltncyhst_t hstsnpst;
         int ok;
+        memset(&drivesim,0,sizeof(struct tsndrive_t));
 
         //parse CLI arguments
         evalCLI(argc,argv,&drivesim);
@@ -580,10 +993,20 @@ int main(int argc, char* argv[])
         signal(SIGTERM, sigfunc);
         signal(SIGINT, sigfunc);
 
+        //start log thread with default (not real-time) attributes
+        if (strtrtlog(&(drivesim.log)))
+                printf("messages of the real-time threads are printed directly\n");
+        //start dump thread of the flight recorder with default (not real-time) attributes
+        if (strtfltrcrdr(&(drivesim.fltrcrdr)))
+                printf("flight recorder is not dumped\n");
+        //start writer thread of the capture with default (not real-time) attributes
+        if (strtcaptap(&(drivesim.cap)))
+                printf("frames are not captured\n");
+
         //start rt-thread   
         /* Create a pthread with specified attributes */
         ok = pthread_create(&(drivesim.rt_thrd), &(drivesim.rtthrd_attr), (void*) rt_thrd, (void*)&drivesim);
-        
+        drivesim.rtthrdrun = (ok == 0);
         if (ok) {
                 printf("create pthread failed\n");
                 //cleanup
@@ -598,11 +1021,45 @@ int main(int argc, char* argv[])
         //        printf("join pthread failed: %d\n",ret);
         
 
-        //OPTIONAL: start pmc-thread
+        //start pmc-thread with default (not real-time) attributes
+        if (drivesim.cnfg_optns.pmc) {
+                if (pthread_create(&(drivesim.pmc_thrd), NULL, pmc_thrd, (void*)&drivesim) == 0)
+                        drivesim.pmcthrdrun = true;
+                else
+                        printf("create pmc-thread failed\n");
+        }
 
         while(run){
                 sleep(1);
         }
+        stprtthrd(&drivesim);
+        stprtlog(&(drivesim.log));
+        stpcaptap(&(drivesim.cap));
+
+        snpsthst(&(drivesim.wkuphst),&hstsnpst);
+        prthst("Wakeup latency of real-time thread",&hstsnpst);
+        prthybwkup("Hybrid wakeup of real-time thread",&(drivesim.wkup));
+        prtrcvwt("Receive wait of real-time thread",&(drivesim.rxwt));
+        prtovrn("Overruns of real-time thread",&(drivesim.ovrn));
+        prtstgprf("Stage profile of real-time thread",&(drivesim.prf));
+        if (drivesim.pmcthrdrun) {
+                pthread_cancel(drivesim.pmc_thrd);
+                pthread_join(drivesim.pmc_thrd,NULL);
+                drivesim.pmcthrdrun = false;
+                prtpmc(&(drivesim.pmc));
+        }
+        prtseqcntrs(&(drivesim.seqtrck));
+        if (drivesim.cnfg_optns.fltpath != NULL) {
+                prtfltrcrdr(&(drivesim.fltrcrdr));
+                printf("%llu frames dropped by the ETF qdisc\n", (unsigned long long) drivesim.etfdrps);
+        }
+        if (drivesim.cnfg_optns.tmstmp) {
+                prtltncy("TX stack latency (to TX timestamp)",&(drivesim.txltncy));
+                prtltncy("TX timestamp - TxTime",&(drivesim.txdvtn));
+                prtltncy("RX stack latency (from RX timestamp)",&(drivesim.rxltncy));
+                printf("%llu TX timestamps without sent frame, %llu other reports of the error queue\n",
+                       (unsigned long long) drivesim.tmstmp.unmtchd, (unsigned long long) drivesim.tmstmp.txerrs);
+        }
 
         // cleanup
         ok = cleanup(&drivesim);
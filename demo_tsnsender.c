@@ -22,9 +22,17 @@
 #include <fcntl.h>
 #include <time.h>
 #include <poll.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 #include <linux/net_tstamp.h>
 #include "packet_handler.h"
+#include "xsk_handler.h"
 #include "axisshm_handler.h"
+#include "rt_stats.h"
+#include "pmc_handler.h"
+#include "rt_log.h"
+#include "flt_recorder.h"
+#include "pcap_tap.h"
 
 
 //parameters which are fixed at compile time, all values in nano seconds; values should be estimated using cyclictest
@@ -33,6 +41,25 @@
 #define APPSENDWAKEUP 200000            //Duration between wakeup of the thread and the packet being read to send
 #define APPRECVWAKEUP 200000            //Duration between wakeup of the thread and it being ready to receive
 #define MAXWAKEUPJITTER 50000           //worst case Jitter between planned and actual wakeup of thread
+#define HYBWAKEUPJITTER 5000            //worst case Jitter with the hybrid wakeup, the latency of the sleep is covered by spinning
+#define HYBMAXGUARD 100000              //longest guard of the hybrid wakeup, bounds the spinning per cycle
+#define RCVSPIN 50000                   //time spun before the end of the receive window by the hybrid receive wait
+
+#define PMC_RPRTINTRVL 10               //interval in seconds in which the performance counters are reported
+
+//budgets of the profiled stages of the send thread, derived from the durations above
+#define STGBDGT_SHMRD (APPSENDWAKEUP/2) //reading the shared memory, also the timeout of the read
+#define STGBDGT_ENC (APPSENDWAKEUP/4)   //filling the frame
+#define STGBDGT_SND (APPSENDWAKEUP/4)   //handing the frame to the stack
+
+//profiled stages of the send thread
+enum rtstg_t {STG_SHMRD = 0, STG_ENC, STG_SND, STG_CNT};
+
+//return codes of the receive thread in the flight recorder
+enum rxret_t {RXRET_DCD = 0, RXRET_SHMWRT};
+
+//owners of packets from the packetstore
+#define PKTOWNR_RX 0                    //receive thread
 
 uint8_t run = 1;
 
@@ -48,12 +75,36 @@ struct cnfg_optns_t{
         uint8_t num_rcvmacs;
         uint16_t pubid;
         int prrty;
+        bool rxring;
+        int xskmode;            //mode of the AF_XDP socket, -1 if AF_PACKET sockets are used
+        bool drpold;            //drop axis messages older than an already received one (duplicates, late and stale)
+        bool tmstmp;            //RX and TX timestamps of the frames are taken to measure the stack latencies
+        bool prf;               //the durations of the stages of the send thread are profiled
+        bool pmc;               //performance counters of both real-time threads are read each cycle
+        char * fltpath;         //prefix of the dump files of the flight recorders, NULL if disabled
+        char * cappath;         //pcapng file of the captured frames, NULL if disabled
+        enum ovrnplcy_t ovrnplcy;       //handling of the cycles missed by an overrun of the send thread
+        bool hybwkup;           //the send thread sleeps till a guard before its wakeup and spins the rest
+        enum rcvwtmd_t rcvwtmd;         //strategy of the receive thread to wait for frames
+        uint32_t wkupjttr;      //wakeup jitter of the send thread the timing is planned with
+        bool rctr;              //one real-time thread sends and receives, woken by timerfds and the socket through epoll
+};
+
+/* file descriptors of the reactor thread */
+struct rctr_t {
+        int epfd;               //epoll instance
+        int txtfd;              //timerfd of the wakeup of the send cycle
+        int rxtfd;              //timerfd of the wakeup and the end of the window of the receive cycle
+        int rxfd;               //socket the axis frames are received on
+        int64_t taioffs;        //CLOCK_TAI minus CLOCK_REALTIME of the timerfds in whole seconds
 };
 
 struct tsnsender_t {
         struct cnfg_optns_t cnfg_optns;
         int rxsckt;
         int txsckt;
+        struct rxring_t rxring;
+        struct xsksckt_t xsk;
         struct mk_mainoutput *txshm;
         struct mk_maininput *rxshm;
         struct mk_additionaloutput *atxshm;
@@ -61,10 +112,34 @@ struct tsnsender_t {
         sem_t* rxshm_sem;
         sem_t* atxshm_sem;
         struct pktstore_t pkts;
+        struct seqtrck_t seqtrck;
+        struct tmstmpr_t tmstmp;
+        struct ltncystats_t txltncy;    //handing frame to the stack till TX timestamp
+        struct ltncystats_t txdvtn;     //TX timestamp minus planned TxTime
+        struct ltncystats_t rxltncy;    //RX timestamp till handling in the application
+        struct frmtmplt_t cntrltmplt;
+        struct hybwkup_t txwkup;        //sleeping and spinning of the send thread
+        struct ltncyhst_t txwkuphst;    //wakeup latency of the real-time thread
+        struct ltncyhst_t rxwkuphst;    //wakeup latency of the receive thread
+        struct rcvwt_t rxwt;            //waiting of the receive thread for the axis frames
+        struct ovrntrck_t txovrn;       //overruns of the send thread
+        struct stgprf_t prf;            //durations of the stages of the send thread
+        struct pmcthrd_t txpmc;         //performance counters of the send thread
+        struct pmcthrd_t rxpmc;         //performance counters of the receive thread
+        struct rtlog_t log;             //messages of the real-time threads
+        struct fltrcrdr_t txfltrcrdr;   //last cycles of the send thread, dumped on anomalies
+        struct fltrcrdr_t rxfltrcrdr;   //last cycles of the receive thread, dumped on anomalies
+        uint64_t etfdrps;               //frames dropped by the ETF qdisc
+        struct captap_t cap;            //capture of all sent and received frames
+        struct rctr_t rctr;             //epoll instance and timerfds of the reactor mode
         pthread_attr_t rtthrd_attr;
         pthread_t rt_thrd;
+        bool rtthrdrun;
         pthread_attr_t rxthrd_attr;
         pthread_t rx_thrd;
+        bool rxthrdrun;
+        pthread_t pmc_thrd;
+        bool pmcthrdrun;
 };
 
 /* signal handler */
@@ -98,6 +173,24 @@ static void usage(char *appname)
                 " -i                   Name of the Networkinterface to use.\n"
                 " -p                   PublisherID e.g. TalkerID, Default: 0xAC00\n"
                 " -y                   Priority of sending socket (can be 1-7), Default: 6\n"
+                " -m                   Receive through a memory mapped receive ring.\n"
+                " -x [mode]            Send and receive through an AF_XDP socket on queue 0. XDP mode: 0 generic, 1 native, 2 native zero-copy.\n"
+                " -T                   Take RX and TX timestamps of the frames and report the measured stack latencies.\n"
+                " -P                   Profile the durations of the stages of the send thread and check them against their budgets.\n"
+                " -C                   Count cycles, instructions, cache and branch misses, context switches and page faults per cycle.\n"
+                " -R [prefix]          Record the last cycles of both threads and dump them to prefix_<thread>_<n>.bin on a late wake up,\n"
+                "                      sequence gap, shared memory timeout, ETF drop or overrun.\n"
+                " -k [file]            Capture all sent and received frames to a pcapng file, written by a thread with normal priority.\n"
+                " -O [policy]          Handling of cycles whose TxTime passed before they started (overrun of the send thread):\n"
+                "                      0 skip them (default), 1 run them back to back without sending their frames,\n"
+                "                      2 go to the safe state (machine off, all axes disabled) and skip them.\n"
+                " -S                   Wake up the send thread precisely: sleep till a guard before the wakeup time, which adapts to the\n"
+                "                      measured latency of the sleep, and spin the rest. The wakeup jitter is planned with 5 us instead of 50 us.\n"
+                " -W [strategy]        Waiting of the receive thread for the axis frames till the end of the receive window:\n"
+                "                      0 ppoll (default), 1 busy polling of the socket, 2 ppoll and busy polling of the last 50 us.\n"
+                " -E                   Reactor mode: send and receive in one real-time thread, woken by timerfds at the wakeup times and the end\n"
+                "                      of the receive window and by the socket through epoll. Needs only one isolated core, excludes -S and -W.\n"
+                " -d                   Drop received axis messages which are older than an already received message of the axis.\n"
                 " -h                   Prints this help message and exits\n"
                 "\n",
                 appname);
@@ -112,10 +205,12 @@ void evalCLI(int argc, char* argv[0],struct tsnsender_t * sender)
         sender->cnfg_optns.intrvl_ns = 1000000;
         sender->cnfg_optns.pubid = 0xAC00;
         sender->cnfg_optns.prrty = 6;
+        sender->cnfg_optns.wkupjttr = MAXWAKEUPJITTER;
+        sender->cnfg_optns.xskmode = -1;
 
         char* appname = strrchr(argv[0], '/');
         appname = appname ? 1 + appname : argv[0];
-        while (EOF != (c = getopt(argc,argv,"ht:b:o:r:w:i:p:y:"))) {
+        while (EOF != (c = getopt(argc,argv,"ht:b:o:r:w:i:p:y:mx:dTPCR:k:O:SW:E"))) {
                 switch(c) {
                 case 'b':
                         cnvrt_dbl2tmspc(atof(optarg), &(sender->cnfg_optns.basetm));
@@ -142,6 +237,43 @@ void evalCLI(int argc, char* argv[0],struct tsnsender_t * sender)
                 case 'y':
                         sender->cnfg_optns.prrty = atoi(optarg);
                         break;
+                case 'm':
+                        sender->cnfg_optns.rxring = true;
+                        break;
+                case 'x':
+                        sender->cnfg_optns.xskmode = atoi(optarg);
+                        break;
+                case 'd':
+                        sender->cnfg_optns.drpold = true;
+                        break;
+                case 'T':
+                        sender->cnfg_optns.tmstmp = true;
+                        break;
+                case 'P':
+                        sender->cnfg_optns.prf = true;
+                        break;
+                case 'C':
+                        sender->cnfg_optns.pmc = true;
+                        break;
+                case 'R':
+                        sender->cnfg_optns.fltpath = optarg;
+                        break;
+                case 'k':
+                        sender->cnfg_optns.cappath = optarg;
+                        break;
+                case 'O':
+                        sender->cnfg_optns.ovrnplcy = atoi(optarg);
+                        break;
+                case 'W':
+                        sender->cnfg_optns.rcvwtmd = atoi(optarg);
+                        break;
+                case 'S':
+                        sender->cnfg_optns.hybwkup = true;
+                        sender->cnfg_optns.wkupjttr = HYBWAKEUPJITTER;
+                        break;
+                case 'E':
+                        sender->cnfg_optns.rctr = true;
+                        break;
                 case 'h':
                 default:
                         usage(appname);
@@ -153,10 +285,25 @@ void evalCLI(int argc, char* argv[0],struct tsnsender_t * sender)
                 printf("Specified socket priority is out of rage. Must be between 1 and 7.\n");
                 exit(0);
         }
+        if ((sender->cnfg_optns.ovrnplcy < OVRN_SKIP) || (sender->cnfg_optns.ovrnplcy > OVRN_SAFE)) {
+                printf("Specified overrun policy is out of range. Must be between 0 and 2.\n");
+                exit(0);
+        }
+        if ((sender->cnfg_optns.rcvwtmd < RCVWT_PPOLL) || (sender->cnfg_optns.rcvwtmd > RCVWT_HYBRID)) {
+                printf("Specified receive wait is out of range. Must be between 0 and 2.\n");
+                exit(0);
+        }
+        //the reactor sleeps in epoll_wait for the timers and the socket alike
+        if (sender->cnfg_optns.rctr && (sender->cnfg_optns.hybwkup || (sender->cnfg_optns.rcvwtmd != RCVWT_PPOLL))) {
+                printf("Warning: Hybrid wakeup and receive wait are not used in the reactor mode. \n");
+                sender->cnfg_optns.hybwkup = false;
+                sender->cnfg_optns.wkupjttr = MAXWAKEUPJITTER;
+                sender->cnfg_optns.rcvwtmd = RCVWT_PPOLL;
+        }
 }
 
-// open tx socket
-int opntxsckt(int prrty)
+// open tx socket, frames dropped by the qdisc are reported in the error queue if requested
+int opntxsckt(int prrty, bool rprterrs)
 {       
         int ok;
         struct sock_txtime soctxtm;
@@ -164,7 +311,7 @@ int opntxsckt(int prrty)
         if (sckt < 0)
                 return sckt;      //fail
         soctxtm.clockid = CLOCK_TAI;
-        soctxtm.flags = 0;
+        soctxtm.flags = rprterrs ? SOF_TXTIME_REPORT_ERRORS : 0;
         ok = setsockopt(sckt,SOL_SOCKET,SO_TXTIME,&soctxtm,sizeof(soctxtm));
         if (ok != 0)
                 printf("Warning: Setting of Socketoption TXTIME failed (TX). Error: %d \n",errno);
@@ -176,20 +323,82 @@ int opntxsckt(int prrty)
         return sckt;
 }
 
+// open epoll instance and timerfds of the reactor, the timers and the socket are added
+int opnrctr(struct rctr_t *rctr, int rxfd)
+{
+        struct epoll_event ev;
+        struct timespec rltm;
+        struct timespec taitm;
+        int fds[3];
+
+        //timerfds do not support CLOCK_TAI, its offset to CLOCK_REALTIME changes only with leap seconds
+        clock_gettime(CLOCK_REALTIME,&rltm);
+        clock_gettime(CLOCK_TAI,&taitm);
+        rctr->taioffs = (((int64_t) cnvrt_tmspc2int64(&taitm) - (int64_t) cnvrt_tmspc2int64(&rltm) + NSEC_IN_SEC/2)/NSEC_IN_SEC)*NSEC_IN_SEC;
+        rctr->rxfd = rxfd;
+        rctr->epfd = epoll_create1(0);
+        rctr->txtfd = timerfd_create(CLOCK_REALTIME,TFD_NONBLOCK);
+        rctr->rxtfd = timerfd_create(CLOCK_REALTIME,TFD_NONBLOCK);
+        if ((rctr->epfd < 0) || (rctr->txtfd < 0) || (rctr->rxtfd < 0))
+                return 1;       //fail
+        fds[0] = rctr->txtfd;
+        fds[1] = rctr->rxtfd;
+        fds[2] = rctr->rxfd;
+        for (int i = 0; i < 3; i++) {
+                ev.events = EPOLLIN;
+                ev.data.fd = fds[i];
+                if (epoll_ctl(rctr->epfd,EPOLL_CTL_ADD,fds[i],&ev) != 0)
+                        return 1;       //fail
+        }
+        return 0;       //succeded
+}
+
+// close epoll instance and timerfds of the reactor
+void clsrctr(struct rctr_t *rctr)
+{
+        if (rctr->epfd >= 0)
+                close(rctr->epfd);
+        if (rctr->txtfd >= 0)
+                close(rctr->txtfd);
+        if (rctr->rxtfd >= 0)
+                close(rctr->rxtfd);
+        rctr->epfd = -1;
+        rctr->txtfd = -1;
+        rctr->rxtfd = -1;
+}
+
 //initialization
 int init(struct tsnsender_t *sender)
 {
         int ok = 0;
         struct sched_param param;
+        struct sockaddr_ll snd_addr;
+
+        //messages of the real-time threads are printed by the log thread, first so cleanup can always stop it
+        initrtlog(&(sender->log),stdout);
+        //capture file, also first so cleanup can always close it
+        if (initcaptap(&(sender->cap),sender->cnfg_optns.cappath,sender->cnfg_optns.ifname) != 0)
+                return 1;
+        sender->rctr.epfd = -1;
+        sender->rctr.txtfd = -1;
+        sender->rctr.rxtfd = -1;
 
         //open send socket
-        sender->txsckt = opntxsckt(sender->cnfg_optns.prrty);
+        sender->txsckt = opntxsckt(sender->cnfg_optns.prrty, sender->cnfg_optns.fltpath != NULL);
         if (sender->txsckt < 0) {
                 printf("TX Socket open failed. \n");
                 sender->txsckt = 0;
                 return 1;
         }
 
+        //prepare frame template for sending, sending address is static
+        ok = fillethaddr(&snd_addr, sender->cnfg_optns.dstaddr, ETHERTYPE, sender->txsckt, sender->cnfg_optns.ifname);
+        ok += inittmplt(&(sender->cntrltmplt),1,CNTRL,sender->cnfg_optns.pubid,&snd_addr);
+        if (ok != 0) {
+                printf("Preparing of frame template failed. \n");
+                return 1;
+        }
+
         //open recv socket
         sender->rxsckt = opnrxsckt(sender->cnfg_optns.ifname,sender->cnfg_optns.rcv_macs,sender->cnfg_optns.num_rcvmacs);
         if (sender->rxsckt < 0) {
@@ -197,6 +406,37 @@ int init(struct tsnsender_t *sender)
                 sender->rxsckt = 0;
                 return 1;
         }
+        if (sender->cnfg_optns.rxring && (opnrxring(&(sender->rxring),sender->rxsckt) != 0)) {
+                printf("RX ring setup failed. \n");
+                return 1;
+        }
+        //the AF_XDP socket replaces both sockets in the real-time path, the RX socket still subscribes the multicast addresses
+        sender->xsk.fd = -1;
+        if ((sender->cnfg_optns.xskmode >= 0) && (opnxsk(&(sender->xsk),sender->cnfg_optns.ifname,0,sender->cnfg_optns.xskmode) != 0)) {
+                printf("AF_XDP socket setup failed. \n");
+                return 1;
+        }
+        if (initrcvwt(&(sender->rxwt),sender->cnfg_optns.rcvwtmd,(sender->cnfg_optns.xskmode >= 0) ? sender->xsk.fd : sender->rxsckt,RCVSPIN) != 0) {
+                printf("Setting up the receive wait failed. \n");
+                return 1;
+        }
+        if (sender->cnfg_optns.rctr && (opnrctr(&(sender->rctr),(sender->cnfg_optns.xskmode >= 0) ? sender->xsk.fd : sender->rxsckt) != 0)) {
+                printf("Reactor setup failed. Error: %d \n",errno);
+                return 1;
+        }
+        //timestamps are taken by the sockets, not available with the AF_XDP socket
+        if (sender->cnfg_optns.tmstmp && (sender->cnfg_optns.xskmode >= 0)) {
+                printf("Warning: Timestamping is not supported with the AF_XDP socket. \n");
+                sender->cnfg_optns.tmstmp = false;
+        }
+        if (sender->cnfg_optns.tmstmp) {
+                if ((enbltmstmp(&(sender->tmstmp),sender->txsckt,sender->cnfg_optns.ifname,TMSTMP_TX) != 0) ||
+                    (enbltmstmp(&(sender->tmstmp),sender->rxsckt,sender->cnfg_optns.ifname,TMSTMP_RX) != 0)) {
+                        printf("Enabling of timestamps failed. \n");
+                        return 1;
+                }
+                printf("Using %s timestamps. \n", sender->tmstmp.hw ? "hardware" : "software");
+        }
 
         //open shared memory
         sender->txshm = opnShM_cntrlnfo(&sender->txshm_sem);
@@ -216,7 +456,15 @@ int init(struct tsnsender_t *sender)
         };
 
         //allocate memory for packets
-        ok += initpktstrg(&(sender->pkts),5);
+        ok += initpktstrg(&(sender->pkts),MAXRCVBATCH+1);
+        initseqtrck(&(sender->seqtrck));
+
+        //flight recorders, allocated before the memory is locked
+        if ((initfltrcrdr(&(sender->txfltrcrdr),"send",sender->cnfg_optns.fltpath,sender->cnfg_optns.wkupjttr) != 0) ||
+            (initfltrcrdr(&(sender->rxfltrcrdr),"receive",sender->cnfg_optns.fltpath,MAXWAKEUPJITTER) != 0)) {
+                printf("Allocating the flight recorders failed. \n");
+                return 1;
+        }
 
         //prefault stack/heap --> done by mlocking APIs
 
@@ -258,10 +506,10 @@ int init(struct tsnsender_t *sender)
                 printf("pthread setinheritsched failed\n");
                 return 1;
         }
-        //detach thread since returnvalue does not matter
-        ok = pthread_attr_setdetachstate(&(sender->rtthrd_attr),PTHREAD_CREATE_DETACHED);
+        //joinable, the thread must have ended before its resources are freed
+        ok = pthread_attr_setdetachstate(&(sender->rtthrd_attr),PTHREAD_CREATE_JOINABLE);
         if (ok) {
-                printf("pthread setdetached failed\n");
+                printf("pthread setjoinable failed\n");
                 return 1;
         }
 
@@ -298,27 +546,76 @@ int init(struct tsnsender_t *sender)
                 printf("pthread setinheritsched failed\n");
                 return 1;
         }
-        //detach thread since returnvalue does not matter
-        ok = pthread_attr_setdetachstate(&(sender->rxthrd_attr),PTHREAD_CREATE_DETACHED);
+        //joinable, the thread must have ended before its resources are freed
+        ok = pthread_attr_setdetachstate(&(sender->rxthrd_attr),PTHREAD_CREATE_JOINABLE);
         if (ok) {
-                printf("pthread setdetached failed\n");
+                printf("pthread setjoinable failed\n");
                 return 1;
         }
 
-        //OPTIONAL: setup pmc-thread (optional)
+        //wakeup latencies are checked against the assumed worst case jitter
+        inithst(&(sender->txwkuphst),sender->cnfg_optns.wkupjttr);
+        inithst(&(sender->rxwkuphst),MAXWAKEUPJITTER);
+        initovrn(&(sender->txovrn),sender->cnfg_optns.ovrnplcy);
+        inithybwkup(&(sender->txwkup),sender->cnfg_optns.hybwkup ? MAXWAKEUPJITTER : 0,HYBMAXGUARD);
+
+        //stage profile of the send thread
+        if (sender->cnfg_optns.prf) {
+                const char *stgnms[STG_CNT] = {"shm read", "encode", "send"};
+                const int64_t stgbdgts[STG_CNT] = {STGBDGT_SHMRD, STGBDGT_ENC, STGBDGT_SND};
+                ok = initstgprf(&(sender->prf),stgnms,stgbdgts,STG_CNT);
+                if (ok)
+                        return 1;
+        }
+
+        //performance counters, opened by the pmc-thread when the real-time threads run
+        initpmcthrd(&(sender->txpmc),"send");
+        initpmcthrd(&(sender->rxpmc),"receive");
 
         return ok;
 }
 
+//stop the real-time threads and wait till they have ended, they use the recorders, counters, capture, timerfds and sockets till then
+int stprtthrds(struct tsnsender_t *sender)
+{
+        int ok = 0;
+        if (sender->rtthrdrun) {
+                ok += pthread_cancel(sender->rt_thrd);
+                ok += pthread_join(sender->rt_thrd,NULL);
+                sender->rtthrdrun = false;
+        }
+        if (sender->rxthrdrun) {
+                ok += pthread_cancel(sender->rx_thrd);
+                ok += pthread_join(sender->rx_thrd,NULL);
+                sender->rxthrdrun = false;
+        }
+        return ok;
+}
+
 //End execution with cleanup
 int cleanup(struct tsnsender_t *sender)
 {
         int ok = 0;
         //stop threads
-        ok = pthread_cancel(sender->rt_thrd);
-        ok =+ pthread_cancel(sender->rx_thrd);
+        ok = stprtthrds(sender);
+        if (sender->pmcthrdrun) {
+                pthread_cancel(sender->pmc_thrd);
+                pthread_join(sender->pmc_thrd,NULL);
+                sender->pmcthrdrun = false;
+        }
+        clspmcthrd(&(sender->txpmc));
+        clspmcthrd(&(sender->rxpmc));
+
+        stprtlog(&(sender->log));
+        stpcaptap(&(sender->cap));
+        clsfltrcrdr(&(sender->txfltrcrdr));
+        clsfltrcrdr(&(sender->rxfltrcrdr));
+        clsrctr(&(sender->rctr));
 
         //close rx socket
+        clsrxring(&(sender->rxring));
+        if (sender->cnfg_optns.xskmode >= 0)
+                clsxsk(&(sender->xsk));
         ok += close(sender->rxsckt);
         
         //close tx socket
@@ -331,6 +628,7 @@ int cleanup(struct tsnsender_t *sender)
 
         //free allocated memory for packets
         ok += destroypktstrg(&(sender->pkts));
+        destroytmplt(&(sender->cntrltmplt));
 
         free(sender->cnfg_optns.dstaddr);
         for (int i = 0;i<4;i++){
@@ -342,206 +640,567 @@ int cleanup(struct tsnsender_t *sender)
         return ok;
 }
 
-//Real time thread sender
-void *rt_thrd(void *tsnsender)
+//check for frames of the last cycles dropped by the ETF qdisc, they trigger the flight recorder of the send thread
+static void chk_etfdrps(struct tsnsender_t *sender)
 {
-	int ok;
-        struct tsnsender_t *sender = (struct tsnsender_t *) tsnsender;
-        struct timespec est;
+        int drps;
+        if ((sender->cnfg_optns.fltpath == NULL) || (sender->cnfg_optns.xskmode >= 0))
+                return;
+        if (sender->cnfg_optns.tmstmp)
+                drps = sender->tmstmp.etfdrps - sender->etfdrps;        //error queue is read with the TX timestamps
+        else
+                drps = rcvetfdrps(sender->txsckt);
+        if (drps > 0) {
+                sender->etfdrps += drps;
+                trgfltrcrdr(&(sender->txfltrcrdr),FLTTRG_ETFDRP);
+        }
+}
+
+//value in nano units for the flight recorder
+static int64_t rcrdval(double val)
+{
+        int64_t res = 0;
+        dbl2nint64(val,&res);
+        return res;
+}
+
+//set-points read from the shared memory for the flight recorder
+static void rcrdsetpnts(struct tsnsender_t *sender, struct fltrcrd_t *fltrcrd, struct cntrlnfo_t *cntrlnfo)
+{
+        if (sender->cnfg_optns.fltpath == NULL)
+                return;
+        fltrcrd->vals[x] = rcrdval(cntrlnfo->x_set.cntrlvl);
+        fltrcrd->vals[y] = rcrdval(cntrlnfo->y_set.cntrlvl);
+        fltrcrd->vals[z] = rcrdval(cntrlnfo->z_set.cntrlvl);
+        fltrcrd->vals[s] = rcrdval(cntrlnfo->s_set.cntrlvl);
+}
+
+/* state of the cycles of the send thread */
+struct sndcycl_t {
+        struct cycltmln_t tmln;
+        int64_t txoffs;
+        int64_t wkupoffs;
+        uint64_t cycl;
+        uint64_t txtime;
         struct timespec wkupsndtm;
-        struct timespec txtime;
-        struct rt_pkt_t *snd_pkt;
-        struct sockaddr_ll snd_addr;
-        struct cntrlnfo_t snd_cntrlnfo;
-        memset(&snd_cntrlnfo,0, sizeof(struct cntrlnfo_t));
-        uint16_t snd_seqno = 0;
-        
         struct timespec cntrlrd_tmout;
+        struct cntrlnfo_t snd_cntrlnfo;
+        uint16_t snd_seqno;
+        uint64_t sndtm;
+        struct fltrcrd_t *fltrcrd;
+};
 
-        //init sending address since it will be static
-        ok = fillethaddr(&snd_addr, sender->cnfg_optns.dstaddr, ETHERTYPE, sender->txsckt, sender->cnfg_optns.ifname);
-	                
+//initialize the timeline of the send cycles and the times of the first cycle
+static void initsndcycl(struct tsnsender_t *sender, struct sndcycl_t *sc)
+{
+        struct timespec curtm;
+
+        memset(sc,0,sizeof(struct sndcycl_t));
         /*sleep this (basetime minus one period) is reached
         or (basetime plus multiple periods) */
-        clock_gettime(CLOCK_TAI,&wkupsndtm);
-        clc_est(&wkupsndtm,&(sender->cnfg_optns.basetm), sender->cnfg_optns.intrvl_ns, &est);      //check if added period is enough time buffer, maybe increase to two
-        txtime = clc_txtm(&est,sender->cnfg_optns.sndoffst,SENDINGSTACK_DURATION);
-        wkupsndtm = clc_sndwkuptm(&txtime,APPSENDWAKEUP,MAXWAKEUPJITTER);
-        tmspc_cp(&cntrlrd_tmout,&wkupsndtm);
-        inc_tm(&cntrlrd_tmout,APPSENDWAKEUP/2);
+        clock_gettime(CLOCK_TAI,&curtm);
+        inittmln(&(sc->tmln),cnvrt_tmspc2int64(&(sender->cnfg_optns.basetm)),sender->cnfg_optns.intrvl_ns,cnvrt_tmspc2int64(&curtm));      //check if added period is enough time buffer, maybe increase to two
+        sc->txoffs = clc_txoffs(sender->cnfg_optns.sndoffst,SENDINGSTACK_DURATION);
+        sc->wkupoffs = clc_sndwkupoffs(sc->txoffs,APPSENDWAKEUP,sender->cnfg_optns.wkupjttr);
+}
+
+//calculate TxTime-Stamp, wakeuptime and timeout of the shared memory from the index of the cycle
+static void clcsndtms(struct sndcycl_t *sc)
+{
+        sc->txtime = tmln_tm(&(sc->tmln),sc->cycl,sc->txoffs);
+        cnvrt_int642tmspc(tmln_tm(&(sc->tmln),sc->cycl,sc->wkupoffs),&(sc->wkupsndtm));
+        cnvrt_int642tmspc(tmln_tm(&(sc->tmln),sc->cycl,sc->wkupoffs + APPSENDWAKEUP/2),&(sc->cntrlrd_tmout));
+}
+
+//start a send cycle after the wakeup, mssd cycles were missed by an overrun before it
+static void strtsndcycl(struct tsnsender_t *sender, struct sndcycl_t *sc, uint64_t mssd)
+{
+        sc->fltrcrd = strtfltcycl(&(sender->txfltrcrdr),sc->cycl,&(sc->wkupsndtm));
+        if (mssd > 0) {
+                trgfltrcrdr(&(sender->txfltrcrdr),FLTTRG_OVERRUN);
+                rtlog(LOG_OVERRUN,"send",mssd,sc->cycl,0);
+        }
+        //counts of the last cycle, read before the profile starts
+        smplpmc(&(sender->txpmc));
+        strtstg(&(sender->prf));
+}
+
+//read the set-points, send them and go to the next cycle, returns 1 if the frame can not be filled
+static int sndcycl(struct tsnsender_t *sender, struct sndcycl_t *sc)
+{
+        int ok;
+        struct frmtmplt_t *sndtmplt;
+        int snderr;
+        struct timespec curtm;
+        struct txtmstmp_t txtss[8];
+        int txtscnt;
+        struct fltrcrd_t *fltrcrd = sc->fltrcrd;
+
+        //get TX values from shared memory
+        ok = rd_shm2cntrlinfo(sender->txshm, &(sc->snd_cntrlnfo), sender->txshm_sem, &(sc->cntrlrd_tmout));
+        fltrcrd->rets[STG_SHMRD] = ok;
+        //safe state after an overrun: machine off and all axes disabled
+        if (sender->txovrn.safe)
+                memset(&(sc->snd_cntrlnfo),0,sizeof(struct cntrlnfo_t));
+        rcrdsetpnts(sender,fltrcrd,&(sc->snd_cntrlnfo));
+        endstg(&(sender->prf),STG_SHMRD);
+
+        //fill TX-Packet of the prepared frame template
+        ok = fillcntrlpkt(sender->cntrltmplt.pkt,&(sc->snd_cntrlnfo),sc->snd_seqno);
+        fltrcrd->rets[STG_ENC] = ok;
+        if (ok != 0){
+                rtlog(LOG_FILLFAIL,NULL,0,0,0);
+                return 1;       //fail
+        }
+        endstg(&(sender->prf),STG_ENC);
+        //collect TX timestamps of the frames of the last cycles
+        if (sender->cnfg_optns.tmstmp) {
+                do {
+                        txtscnt = rcvtxtmstmps(&(sender->tmstmp),txtss,8);
+                        for (int i = 0; i < txtscnt; i++) {
+                                updtltncy(&(sender->txltncy), (int64_t) (txtss[i].tmstmp - txtss[i].sndtm));
+                                updtltncy(&(sender->txdvtn), (int64_t) (txtss[i].tmstmp - txtss[i].txtime));
+                        }
+                } while (txtscnt == 8);
+                clock_gettime(CLOCK_TAI,&curtm);
+                sc->sndtm = cnvrt_tmspc2int64(&curtm);
+                strtstg(&(sender->prf));
+        }
+        chk_etfdrps(sender);
+        //send TX-Packet, the TxTime of a cycle which is caught up after an overrun already passed
+        if (sender->txovrn.lt) {
+                fltrcrd->txtm = 0;
+        } else if (sender->cnfg_optns.xskmode >= 0) {
+                fltrcrd->txtm = sc->txtime;
+                sndtmplt = &(sender->cntrltmplt);
+                if (sndxsktmplts(&(sender->xsk),&sndtmplt,&(sc->txtime),1,&snderr) != 1)
+                        ok = 1;
+        } else {
+                fltrcrd->txtm = sc->txtime;
+                ok += sendtmplt(sender->txsckt,&(sender->cntrltmplt),sc->txtime);
+        }
+        endstg(&(sender->prf),STG_SND);
+        fltrcrd->rets[STG_SND] = ok;
+        if ((0 == ok) && (fltrcrd->txtm != 0)) {
+                sc->snd_seqno++;        //sending packet succeded
+                rgsttx(&(sender->tmstmp),sc->sndtm,sc->txtime,sc->cycl);
+        }
+        sc->cycl++;
+        return 0;       //succeded
+}
+
+//Real time thread sender
+void *rt_thrd(void *tsnsender)
+{
+        struct tsnsender_t *sender = (struct tsnsender_t *) tsnsender;
+        struct sndcycl_t sc;
+        uint64_t mssd;
+
+        //counters of this thread can be opened from now on
+        rgstpmcthrd(&(sender->txpmc));
+
+        initsndcycl(sender,&sc);
+        clcsndtms(&sc);
 
         //sleep till first wakeup time
-        clock_nanosleep(CLOCK_TAI, TIMER_ABSTIME, &wkupsndtm, NULL);
-        
+        if (hybwkup(&(sender->txwkup),&(sc.wkupsndtm)) == 0)
+                updtwkuphst(&(sender->txwkuphst),&(sc.wkupsndtm));
+        strtsndcycl(sender,&sc,0);
 	
         //while loop
         while(true){
-                //get TX values from shared memory
-                ok = rd_shm2cntrlinfo(sender->txshm, &snd_cntrlnfo, sender->txshm_sem, &cntrlrd_tmout);
-
-                //get and fill TX-Packet
-                ok = getfreepkt(&(sender->pkts),&snd_pkt);       //maybe change to one static packet in thread to avoid competing access to paket store from rx and tx threads
-                if (ok == 1){
-                        printf("Could not get free packet for sending. \n");
+                if (sndcycl(sender,&sc) != 0)
                         return NULL;       //fail
-                }
-                ok += setpkt(snd_pkt,1,CNTRL,sender->cnfg_optns.pubid);
-                
-                ok += fillcntrlpkt(snd_pkt,&snd_cntrlnfo,snd_seqno);
-                if (ok != 0){
-                        printf("Error in filling sending packet or corresponding headers.\n");
-                        return NULL;       //fail
-                }
-                //send TX-Packet
-                ok += sendpkt(sender->txsckt,snd_pkt->sktbf,snd_pkt->len,&snd_addr,cnvrt_tmspc2int64(&txtime),CLOCK_TAI);
-                if (0 == ok)
-                        snd_seqno++;    //sending packet succeded
-
-                //return packet to store
-                ok += retusedpkt(&(sender->pkts),&snd_pkt);
-
-                //update time
-                inc_tm(&est,sender->cnfg_optns.intrvl_ns);
-                //calculate next TxTime-Stamp and next wakeuptime
-                txtime = clc_txtm(&est,sender->cnfg_optns.sndoffst,SENDINGSTACK_DURATION);
-                wkupsndtm = clc_sndwkuptm(&txtime,APPSENDWAKEUP,MAXWAKEUPJITTER);
-                tmspc_cp(&cntrlrd_tmout,&wkupsndtm);
-                inc_tm(&cntrlrd_tmout,APPSENDWAKEUP/2);
-                //sleep until the next cycle
-                clock_nanosleep(CLOCK_TAI, TIMER_ABSTIME, &wkupsndtm, NULL);
+
+                //sleep until the next cycle, cycles whose TxTime passed before they started are handled by the overrun policy
+                mssd = 0;
+                do {
+                        //calculate next TxTime-Stamp and next wakeuptime from the index of the cycle
+                        clcsndtms(&sc);
+                        if (hybwkup(&(sender->txwkup),&(sc.wkupsndtm)) == 0)
+                                updtwkuphst(&(sender->txwkuphst),&(sc.wkupsndtm));
+                        mssd += chckovrn(&(sender->txovrn),&(sc.tmln),&(sc.cycl),sc.txoffs);
+                } while (sender->txovrn.lt && (sender->txovrn.plcy != OVRN_CATCHUP));
+                strtsndcycl(sender,&sc,mssd);
         }
         return NULL;
 }
 
-//Real time recv thread
-void *rx_thrd(void *tsnsender)
+//check and parse a received axis packet and write its values to shared memory, returns number of axis messages written to shared memory or -1
+int hndl_axspkt(struct tsnsender_t *sender, struct rt_pkt_t *rcvd_pkt, struct timespec *axswrt_tmout, uint32_t axswrt_tmoutfrac)
 {
-	int ok = 0;
-        int rcv_cnt = 1;
-        struct tsnsender_t *sender = (struct tsnsender_t *) tsnsender;
-        struct timespec est;
-        struct timespec wkuprcvtm;
+        struct axsnfo_t axs_nfos[MAXDTSTMSGS];
+        int axscnt;
+        int wrtcnt = 0;
+        enum dcderr_t dcderr;
+        uint16_t pubid;
+        uint16_t seqno;
+        enum seqrslt_t seqrslt;
         struct timespec curtm;
-        
-        struct pollfd fds[1] = {};
-        fds[0].fd = sender->rxsckt;
-        fds[0].events = POLLIN;
-        int tmout;
-        if (sender->cnfg_optns.rcvwndw >= 1000000) {
-                tmout = sender->cnfg_optns.rcvwndw/1000000;
-        } else {
-                tmout = 0;
+        struct fltrcrd_t *fltrcrd = sender->rxfltrcrdr.rcrd;
+        int ok;
+
+        if (rcvd_pkt->len == 0) {
+                rtlog(LOG_TRUNC,NULL,0,0,0);
+                return -1;      //fail
+        }
+        //check and decode RX-packet in a single pass
+        dcderr = dcdaxsfrm(rcvd_pkt, sender->cnfg_optns.rcv_macs, sender->cnfg_optns.num_rcvmacs, axs_nfos, &axscnt);
+        fltrcrd->rets[RXRET_DCD] = dcderr;
+        if (dcderr != DCD_OK) {
+                rtlog(LOG_DCDFAIL,dcderrstr(dcderr),0,0,0);
+                return -1;      //fail
+        }
+
+        //latency from receiving the frame at the NIC till handling it
+        if (sender->cnfg_optns.tmstmp && (rcvd_pkt->rxtmstmp != 0)) {
+                clock_gettime(CLOCK_TAI,&curtm);
+                updtltncy(&(sender->rxltncy), (int64_t) (cnvrt_tmspc2int64(&curtm) - tmstmp2tai(&(sender->tmstmp),rcvd_pkt->rxtmstmp,rcvd_pkt->rxhw)));
+        }
+        //track sequence number per axis and write RX values to shared memory
+        dcdseqhdr(rcvd_pkt, &pubid, &seqno);
+        for (int i = 0;i<axscnt; i++) {
+                seqrslt = trckseq(&(sender->seqtrck), pubid, axs2wrtrid(axs_nfos[i].axsID), seqno);
+                fltrcrd->rxseq = seqno;
+                if (seqrslt == SEQ_GAP)
+                        trgfltrcrdr(&(sender->rxfltrcrdr),FLTTRG_SEQGAP);
+                if (sender->cnfg_optns.drpold && seqisold(seqrslt))
+                        continue;       //older values would set the axis back
+                fltrcrd->vals[4 + axs_nfos[i].axsID] = rcrdval(axs_nfos[i].cntrlvl);
+                ok = wrt_axsinfo2shm(&(axs_nfos[i]), sender->rxshm,sender->rxshm_sem,axswrt_tmout);
+                if (ok != 0)
+                        fltrcrd->rets[RXRET_SHMWRT] = ok;
+                if (ok == 2)
+                        trgfltrcrdr(&(sender->rxfltrcrdr),FLTTRG_SHMTMOUT);
+                inc_tm(axswrt_tmout,axswrt_tmoutfrac);
+                wrtcnt++;
         }
+        return wrtcnt;  //succeded
+}
 
-	struct rt_pkt_t * rcvd_pkt;
-        struct msghdr rcvd_msghdr;
-        enum msgtyp_t msg_typ;
-        union dtstmsg_t *dtstmsgs[4] = {NULL,NULL,NULL,NULL};
-        int dtstmsgcnt;
-        struct axsnfo_t axs_nfo;
+/* state of the cycles of the receive thread */
+struct rcvcycl_t {
+        struct cycltmln_t tmln;
+        int64_t wkupoffs;
+        uint64_t tmlncycl;
+        struct timespec wkuprcvtm;
+        struct timespec rcvdln;         //end of the receive window
         struct timespec axswrt_tmout;
         uint32_t axswrt_tmoutfrac;
-        axswrt_tmoutfrac = sender->cnfg_optns.intrvl_ns/(sender->cnfg_optns.num_rcvmacs+1);
-                
+        uint64_t rxcycl;
+        int rcv_cnt;
+};
+
+//calculate wakeuptime, end of the receive window and timeout of the shared memory from the index of the cycle
+static void clcrcvtms(struct tsnsender_t *sender, struct rcvcycl_t *rc)
+{
+        cnvrt_int642tmspc(tmln_tm(&(rc->tmln),rc->tmlncycl,rc->wkupoffs),&(rc->wkuprcvtm));
+        cnvrt_int642tmspc(tmln_tm(&(rc->tmln),rc->tmlncycl,rc->wkupoffs + rc->axswrt_tmoutfrac),&(rc->axswrt_tmout));
+        cnvrt_int642tmspc(tmln_tm(&(rc->tmln),rc->tmlncycl,rc->wkupoffs + sender->cnfg_optns.rcvwndw),&(rc->rcvdln));
+}
+
+//initialize the timeline of the receive cycles, the first receive window is waited for without sleeping
+static void initrcvcycl(struct tsnsender_t *sender, struct rcvcycl_t *rc)
+{
+        struct timespec curtm;
+
+        memset(rc,0,sizeof(struct rcvcycl_t));
+        rc->axswrt_tmoutfrac = sender->cnfg_optns.intrvl_ns/(sender->cnfg_optns.num_rcvmacs+1);
+        rc->rcv_cnt = 1;
         /*sleep this (basetime minus one period) is reached
         or (basetime plus multiple periods), calculated fitting offset to recv */
-        clock_gettime(CLOCK_TAI,&wkuprcvtm);
-        clc_est(&wkuprcvtm,&(sender->cnfg_optns.basetm), sender->cnfg_optns.intrvl_ns, &est);
-        wkuprcvtm = clc_rcvwkuptm(&est,sender->cnfg_optns.rcvoffst,RECEIVINGSTACK_DURATION,APPRECVWAKEUP,MAXWAKEUPJITTER);
-        tmspc_cp(&axswrt_tmout,&wkuprcvtm);
-        inc_tm(&axswrt_tmout,axswrt_tmoutfrac);
+        clock_gettime(CLOCK_TAI,&curtm);
+        inittmln(&(rc->tmln),cnvrt_tmspc2int64(&(sender->cnfg_optns.basetm)),sender->cnfg_optns.intrvl_ns,cnvrt_tmspc2int64(&curtm));
+        rc->wkupoffs = clc_rcvwkupoffs(sender->cnfg_optns.rcvoffst,RECEIVINGSTACK_DURATION,APPRECVWAKEUP,MAXWAKEUPJITTER);
+        clcrcvtms(sender,rc);
+}
+
+//go to the next receive cycle whose wakeuptime is not in the past
+static void nxtrcvcycl(struct tsnsender_t *sender, struct rcvcycl_t *rc)
+{
+        struct timespec curtm;
+
+        //if no (valid) packet arrives the receive could wait longer than a period
+        clock_gettime(CLOCK_TAI,&curtm);
+        rc->tmlncycl = tmln_nxtcycl(&(rc->tmln),cnvrt_tmspc2int64(&curtm),rc->wkupoffs);
+        clcrcvtms(sender,rc);
+        if (cntownpkts(&(sender->pkts),PKTOWNR_RX) != 0)
+                rtlog(LOG_PKTLEAK,"receive",rclmownpkts(&(sender->pkts),PKTOWNR_RX),0,0);
+}
+
+//start a receive cycle after the wakeup
+static void strtrcvcycl(struct tsnsender_t *sender, struct rcvcycl_t *rc)
+{
+        strtfltcycl(&(sender->rxfltrcrdr),rc->rxcycl,&(rc->wkuprcvtm));
+        rc->rxcycl++;
+        smplpmc(&(sender->rxpmc));
+        rc->rcv_cnt = 1;
+}
+
+//receive and handle all ready frames, returns 1 if no packet is free or the receive failed
+static int rcvfrms(struct tsnsender_t *sender, struct rcvcycl_t *rc)
+{
+        int ok;
+	struct rt_pkt_t * rcvd_pkts[MAXRCVBATCH];
+        struct rt_pkt_t ring_pkt;
+        int pktcnt;
+        int axscnt;
+
+        if (sender->cnfg_optns.xskmode >= 0) {
+                //handle all received frames in place and hand them back to the kernel
+                while (rcvxskpkt(&(sender->xsk), &ring_pkt) == 0) {
+                        axscnt = hndl_axspkt(sender, &ring_pkt, &(rc->axswrt_tmout), rc->axswrt_tmoutfrac);
+                        if (axscnt > 0)
+                                rc->rcv_cnt += axscnt;
+                }
+                rlsxskpkts(&(sender->xsk));
+                return 0;       //succeded
+        }
+        if (sender->cnfg_optns.rxring) {
+                //handle all ready frames in place and hand them back to the kernel
+                while (rcvringpkt(&(sender->rxring), &ring_pkt, NULL) == 0) {
+                        axscnt = hndl_axspkt(sender, &ring_pkt, &(rc->axswrt_tmout), rc->axswrt_tmoutfrac);
+                        if (axscnt > 0)
+                                rc->rcv_cnt += axscnt;
+                }
+                rlsringpkts(&(sender->rxring));
+                return 0;       //succeded
+        }
+
+        //get memory for all packets which could be queued
+        for (pktcnt = 0; pktcnt < MAXRCVBATCH; pktcnt++) {
+                if (getfreepkt(&(sender->pkts),&(rcvd_pkts[pktcnt]),PKTOWNR_RX) != 0)
+                        break;
+        }
+        if (pktcnt == 0) {
+                rtlog(LOG_NOFREEPKT,NULL,0,0,0);
+                return 1;       //fail
+        }
+        //receive all queued pakets at once
+        ok = rcvpkts(sender->rxsckt, rcvd_pkts, pktcnt);
+        if (ok == -1) {
+                rtlog(LOG_RCVERR,NULL,0,0,0);
+                for (int i = 0; i < pktcnt; i++)
+                        retusedpkt(&(sender->pkts),&(rcvd_pkts[i]));
+                return 1;       //fail
+        }
+        //handle received packets and return all packets
+        for (int i = 0; i < pktcnt; i++) {
+                if (i < ok) {
+                        axscnt = hndl_axspkt(sender, rcvd_pkts[i], &(rc->axswrt_tmout), rc->axswrt_tmoutfrac);
+                        if (axscnt > 0)
+                                rc->rcv_cnt += axscnt;
+                }
+                retusedpkt(&(sender->pkts),&(rcvd_pkts[i]));
+        }
+        return 0;       //succeded
+}
+
+//Real time recv thread
+void *rx_thrd(void *tsnsender)
+{
+	int ok = 0;
+        struct tsnsender_t *sender = (struct tsnsender_t *) tsnsender;
+        struct rcvcycl_t rc;
+
+        //counters of this thread can be opened from now on
+        rgstpmcthrd(&(sender->rxpmc));
+
+        initrcvcycl(sender,&rc);
                 
         //while loop
         while(true){
                 
-                //for more than one axis, multiple packets should arrive within a period
-                if((rcv_cnt%(sender->cnfg_optns.num_rcvmacs+1)) == 0){
+                //for more than one axis, multiple axis messages should arrive within a period
+                if(rc.rcv_cnt > sender->cnfg_optns.num_rcvmacs){
                         // nanosleep at start of cycle because of "continue" statement
-                        //update time
-                        /* can be done more simple when recv_offset cannot change during operation
-                        inc_tm(&est,sender->cnfg_optns.intrvl_ns);
-                        //calculate next wakeuptime
-                        wkuprcvtm = clc_rcvwkuptm(&est,sender->cnfg_optns.rcvoffst,RECEIVINGSTACK_DURATION,APPRECVWAKEUP,MAXWAKEUPJITTER);
-                        */
-                        //more simple
-                        clock_gettime(CLOCK_TAI,&curtm);
-                        while(cmptmspc_Ab4rB(&wkuprcvtm,&curtm)){
-                                //if no (valid) packet arrives the receive could wait longer than a period
-                                inc_tm(&wkuprcvtm,sender->cnfg_optns.intrvl_ns);
-                        }
-                        tmspc_cp(&axswrt_tmout,&wkuprcvtm);
-                        inc_tm(&axswrt_tmout,axswrt_tmoutfrac);
+                        nxtrcvcycl(sender,&rc);
                         //sleep until the next cycle
-                        clock_nanosleep(CLOCK_TAI, TIMER_ABSTIME, &wkuprcvtm, NULL);
-                        rcv_cnt = 1;
+                        if (clock_nanosleep(CLOCK_TAI, TIMER_ABSTIME, &(rc.wkuprcvtm), NULL) == 0)
+                                updtwkuphst(&(sender->rxwkuphst),&(rc.wkuprcvtm));
+                        strtrcvcycl(sender,&rc);
                 }
 
-                //check for RX-packet
-                ok = poll(fds,1,tmout);
+                //wait for RX-packets till the end of the receive window, then for one more window each time
+                ok = rcvwt(&(sender->rxwt),&(rc.rcvdln));
+                if (ok == 0)
+                        inc_tm(&(rc.rcvdln),sender->cnfg_optns.rcvwndw);
                 if (ok <= 0)
                         continue;
-               
-                //receive paket
-                ok = getfreepkt(&(sender->pkts),&rcvd_pkt);
-                if (ok == 1) {
-                        printf("Could not get free packet for receiving. \n");
-                        return NULL;       //fail
-                }
-                ok = rcvpkt(sender->rxsckt, rcvd_pkt, &rcvd_msghdr);
-                if (ok == 1) {
-                        printf("Receive failed. \n");
-                        retusedpkt(&(sender->pkts),&rcvd_pkt);
+
+                if (rcvfrms(sender,&rc) != 0)
                         return NULL;       //fail
-                }
+        }
 
-                // check ETH-header
-                axs_nfo.axsID = chckethhdr(rcvd_pkt, sender->cnfg_optns.rcv_macs, sender->cnfg_optns.num_rcvmacs);
-                if (axs_nfo.axsID == -1) {
-                        printf("Check ETH-Header failed. \n");
-                        retusedpkt(&(sender->pkts),&rcvd_pkt);
-                        continue;
+        return NULL;
+}
+
+//arm a timerfd of the reactor at a time of CLOCK_TAI, the timerfds run on CLOCK_REALTIME
+static int armtfd(struct rctr_t *rctr, int tfd, const struct timespec *tm)
+{
+        struct itimerspec tmrspc;
+
+        memset(&tmrspc,0,sizeof(struct itimerspec));
+        cnvrt_int642tmspc(cnvrt_tmspc2int64((struct timespec *) tm) - rctr->taioffs,&(tmrspc.it_value));
+        return timerfd_settime(tfd,TFD_TIMER_ABSTIME,&tmrspc,NULL);
+}
+
+//the socket wakes the reactor only while the receive window is open
+static int armrxsckt(struct rctr_t *rctr, bool wndw)
+{
+        struct epoll_event ev;
+
+        ev.events = wndw ? EPOLLIN : 0;
+        ev.data.fd = rctr->rxfd;
+        return epoll_ctl(rctr->epfd,EPOLL_CTL_MOD,rctr->rxfd,&ev);
+}
+
+//wakeup of the send cycle in the reactor, overruns are handled like in the send thread
+static int rctrsnd(struct tsnsender_t *sender, struct sndcycl_t *sc, uint64_t *mssd)
+{
+        updtwkuphst(&(sender->txwkuphst),&(sc->wkupsndtm));
+        *mssd += chckovrn(&(sender->txovrn),&(sc->tmln),&(sc->cycl),sc->txoffs);
+        if (!sender->txovrn.lt || (sender->txovrn.plcy == OVRN_CATCHUP)) {
+                strtsndcycl(sender,sc,*mssd);
+                *mssd = 0;
+                if (sndcycl(sender,sc) != 0)
+                        return 1;       //fail
+        }
+        //wakeup of the next cycle, a skipped cycle is started at once if its TxTime is still ahead
+        clcsndtms(sc);
+        return armtfd(&(sender->rctr),sender->rctr.txtfd,&(sc->wkupsndtm));
+}
+
+//timer of the receive cycle in the reactor: its wakeup or the end of its receive window
+static int rctrrcvtm(struct tsnsender_t *sender, struct rcvcycl_t *rc, bool *rxslp)
+{
+        if (*rxslp) {
+                //wakeup, the receive window opens
+                updtwkuphst(&(sender->rxwkuphst),&(rc->wkuprcvtm));
+                strtrcvcycl(sender,rc);
+                *rxslp = false;
+                if (armrxsckt(&(sender->rctr),true) != 0)
+                        return 1;       //fail
+        } else {
+                //end of the receive window, wait for one more window like the receive thread
+                inc_tm(&(rc->rcvdln),sender->cnfg_optns.rcvwndw);
+        }
+        return armtfd(&(sender->rctr),sender->rctr.rxtfd,&(rc->rcvdln));
+}
+
+//frames ready on the socket in the reactor, the receive cycle sleeps after all axis messages arrived
+static int rctrrcv(struct tsnsender_t *sender, struct rcvcycl_t *rc, bool *rxslp)
+{
+        if (rcvfrms(sender,rc) != 0)
+                return 1;       //fail
+        if (rc->rcv_cnt <= sender->cnfg_optns.num_rcvmacs)
+                return 0;       //window stays open
+        nxtrcvcycl(sender,rc);
+        *rxslp = true;
+        if (armrxsckt(&(sender->rctr),false) != 0)
+                return 1;       //fail
+        return armtfd(&(sender->rctr),sender->rctr.rxtfd,&(rc->wkuprcvtm));
+}
+
+//Real time thread of the reactor mode, sends and receives in one thread woken by the timerfds and the socket
+void *rctr_thrd(void *tsnsender)
+{
+        int ok = 0;
+        struct tsnsender_t *sender = (struct tsnsender_t *) tsnsender;
+        struct rctr_t *rctr = &(sender->rctr);
+        struct sndcycl_t sc;
+        struct rcvcycl_t rc;
+        struct epoll_event evs[3];
+        int evcnt;
+        uint64_t exps;
+        uint64_t mssd = 0;
+        bool rxslp = false;     //receive cycle sleeps till its wakeup, otherwise its receive window is open
+        bool txrdy, rxrdy, sckrdy;
+        struct timespec *rxtm;
+
+        //counters of this thread can be opened from now on, they count the send and the receive cycle
+        rgstpmcthrd(&(sender->txpmc));
+
+        initsndcycl(sender,&sc);
+        clcsndtms(&sc);
+        initrcvcycl(sender,&rc);
+        //like the receive thread, the first receive window is waited for without sleeping
+        if ((armtfd(rctr,rctr->txtfd,&(sc.wkupsndtm)) != 0) || (armtfd(rctr,rctr->rxtfd,&(rc.rcvdln)) != 0)) {
+                rtlog(LOG_FATAL,"reactor",0,0,0);
+                return NULL;       //fail
+        }
+
+        while(true){
+                evcnt = epoll_wait(rctr->epfd,evs,3,-1);
+                if (evcnt < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        rtlog(LOG_FATAL,"reactor",0,0,0);
+                        return NULL;       //fail
                 }
-                //parse RX-packet
-                ok = prspkt(rcvd_pkt, &msg_typ);
-                if ((ok == -1) || (msg_typ != AXS)) {
-                        printf("Parsing of received packet failed, or packet not a AXS-packet. typ %d; ok: %d\n",msg_typ, ok);
-                        retusedpkt(&(sender->pkts),&rcvd_pkt);
-                        continue;
+                txrdy = false;
+                rxrdy = false;
+                sckrdy = false;
+                for (int i = 0; i < evcnt; i++) {
+                        if (evs[i].data.fd == rctr->txtfd)
+                                txrdy = (read(rctr->txtfd,&exps,sizeof(exps)) == sizeof(exps));
+                        else if (evs[i].data.fd == rctr->rxtfd)
+                                rxrdy = (read(rctr->rxtfd,&exps,sizeof(exps)) == sizeof(exps));
+                        else
+                                sckrdy = true;
                 }
-                ok = chckpkthdrs(rcvd_pkt);
-                if (ok == 1) {
-                        printf("Check Packet-Headers failed. \n");
-                        retusedpkt(&(sender->pkts),&rcvd_pkt);
-                        continue;
+
+                //handle the events in the order of their phases within the cycle, the timer of the receive cycle before its frames
+                rxtm = rxslp ? &(rc.wkuprcvtm) : &(rc.rcvdln);
+                if (txrdy && !(rxrdy && cmptmspc_Ab4rB(rxtm,&(sc.wkupsndtm)))) {
+                        ok = rctrsnd(sender,&sc,&mssd);
+                        txrdy = false;
                 }
-                ok = prsdtstmsg(rcvd_pkt, msg_typ, dtstmsgs, &dtstmsgcnt);
-                
-                //write RX values to shared memory
-                for (int i = 0;i<dtstmsgcnt; i++) {
-                        ok = prsaxsmsg(dtstmsgs[i],&axs_nfo);
-                        if (dtstmsgcnt > 1)  {
-                                //only one datasetmsg in packet, axs differentation through rcvmac
-                                //could also be done through different writer ids
-                                axs_nfo.axsID = i;
-                        }
-                        ok =  wrt_axsinfo2shm(&axs_nfo, sender->rxshm,sender->rxshm_sem,&axswrt_tmout);
-                        inc_tm(&axswrt_tmout,axswrt_tmoutfrac);
-                        dtstmsgs[i] = NULL;
+                if ((ok == 0) && rxrdy)
+                        ok = rctrrcvtm(sender,&rc,&rxslp);
+                if ((ok == 0) && sckrdy && !rxslp)
+                        ok = rctrrcv(sender,&rc,&rxslp);
+                if ((ok == 0) && txrdy)
+                        ok = rctrsnd(sender,&sc,&mssd);
+                if (ok != 0) {
+                        rtlog(LOG_FATAL,"reactor",0,0,0);
+                        return NULL;       //fail
                 }
-
-                retusedpkt(&(sender->pkts),&rcvd_pkt);
-                rcv_cnt++;
         }
-
         return NULL;
 }
 
 
+//monitoring thread of the performance counters, not real-time
+void *pmc_thrd(void *tsnsender)
+{
+        struct tsnsender_t *sender = (struct tsnsender_t *) tsnsender;
+        int txok, rxok;
+
+        //wait till both real-time threads registered themselves, the reactor registers only as send thread
+        while ((txok = opnpmcthrd(&(sender->txpmc))) == -1)
+                usleep(1000);
+        rxok = 1;
+        while (!sender->cnfg_optns.rctr && ((rxok = opnpmcthrd(&(sender->rxpmc))) == -1))
+                usleep(1000);
+        if ((txok != 0) && (rxok != 0))
+                return NULL;    //fail
+        while (true) {
+                sleep(PMC_RPRTINTRVL);
+                prtpmc(&(sender->txpmc));
+                if (!sender->cnfg_optns.rctr)
+                        prtpmc(&(sender->rxpmc));
+        }
+        return NULL;
+}
+
 int main(int argc, char* argv[])
 {
         struct tsnsender_t sender;
+        struct ltncyhst_t hstsnpst;
         int ok;
         unsigned char mac[ETH_ALEN];
+        memset(&sender,0,sizeof(struct tsnsender_t));
 
         //set standard values for addresses
         sender.cnfg_optns.dstaddr = calloc(ETH_ALEN,sizeof(char));
@@ -579,10 +1238,30 @@ int main(int argc, char* argv[])
         signal(SIGTERM, sigfunc);
         signal(SIGINT, sigfunc);
 
+        //start log thread with default (not real-time) attributes
+        if (strtrtlog(&(sender.log)))
+                printf("messages of the real-time threads are printed directly\n");
+        //start dump threads of the flight recorders with default (not real-time) attributes
+        if (strtfltrcrdr(&(sender.txfltrcrdr)) || strtfltrcrdr(&(sender.rxfltrcrdr)))
+                printf("flight recorder is not dumped\n");
+        //start writer thread of the capture with default (not real-time) attributes
+        if (strtcaptap(&(sender.cap)))
+                printf("frames are not captured\n");
+
         //start rt-thread   
         /* Create a pthread with specified attributes */
-        ok = pthread_create(&(sender.rt_thrd), &(sender.rtthrd_attr), (void*) rt_thrd, (void*)&sender);
-        ok += pthread_create(&(sender.rx_thrd),&(sender.rxthrd_attr),(void*) rx_thrd, (void*) &sender);
+        if (sender.cnfg_optns.rctr) {
+                //reactor with the attributes of the send thread
+                ok = pthread_create(&(sender.rt_thrd), &(sender.rtthrd_attr), (void*) rctr_thrd, (void*)&sender);
+                sender.rtthrdrun = (ok == 0);
+        } else {
+                ok = pthread_create(&(sender.rt_thrd), &(sender.rtthrd_attr), (void*) rt_thrd, (void*)&sender);
+                sender.rtthrdrun = (ok == 0);
+                if (pthread_create(&(sender.rx_thrd),&(sender.rxthrd_attr),(void*) rx_thrd, (void*) &sender) == 0)
+                        sender.rxthrdrun = true;
+                else
+                        ok = 1;
+        }
         if (ok) {
                 printf("create pthread failed\n");
                 //cleanup
@@ -597,11 +1276,51 @@ int main(int argc, char* argv[])
         //        printf("join pthread failed: %d\n",ret);
         
 
-        //OPTIONAL: start pmc-thread
+        //start pmc-thread with default (not real-time) attributes
+        if (sender.cnfg_optns.pmc) {
+                if (pthread_create(&(sender.pmc_thrd), NULL, pmc_thrd, (void*)&sender) == 0)
+                        sender.pmcthrdrun = true;
+                else
+                        printf("create pmc-thread failed\n");
+        }
 
         while(run){
                 sleep(1);
         }
+        stprtthrds(&sender);
+        stprtlog(&(sender.log));
+        stpcaptap(&(sender.cap));
+
+        snpsthst(&(sender.txwkuphst),&hstsnpst);
+        prthst("Wakeup latency of real-time thread",&hstsnpst);
+        snpsthst(&(sender.rxwkuphst),&hstsnpst);
+        prthst("Wakeup latency of receive thread",&hstsnpst);
+        prthybwkup("Hybrid wakeup of send thread",&(sender.txwkup));
+        if (!sender.cnfg_optns.rctr)
+                prtrcvwt("Receive wait of receive thread",&(sender.rxwt));
+        prtovrn("Overruns of send thread",&(sender.txovrn));
+        prtstgprf("Stage profile of send thread",&(sender.prf));
+        if (sender.pmcthrdrun) {
+                pthread_cancel(sender.pmc_thrd);
+                pthread_join(sender.pmc_thrd,NULL);
+                sender.pmcthrdrun = false;
+                prtpmc(&(sender.txpmc));
+                if (!sender.cnfg_optns.rctr)
+                        prtpmc(&(sender.rxpmc));
+        }
+        prtseqcntrs(&(sender.seqtrck));
+        if (sender.cnfg_optns.fltpath != NULL) {
+                prtfltrcrdr(&(sender.txfltrcrdr));
+                prtfltrcrdr(&(sender.rxfltrcrdr));
+                printf("%llu frames dropped by the ETF qdisc\n", (unsigned long long) sender.etfdrps);
+        }
+        if (sender.cnfg_optns.tmstmp) {
+                prtltncy("TX stack latency (to TX timestamp)",&(sender.txltncy));
+                prtltncy("TX timestamp - TxTime",&(sender.txdvtn));
+                prtltncy("RX stack latency (from RX timestamp)",&(sender.rxltncy));
+                printf("%llu TX timestamps without sent frame, %llu other reports of the error queue\n",
+                       (unsigned long long) sender.tmstmp.unmtchd, (unsigned long long) sender.tmstmp.txerrs);
+        }
 
         // cleanup
         ok = cleanup(&sender);
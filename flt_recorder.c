@@ -0,0 +1,237 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "flt_recorder.h"
+#include "time_calc.h"
+
+int initfltrcrdr(struct fltrcrdr_t *rcrdr, const char *name, const char *path, int64_t wkuplmt)
+{
+        memset(rcrdr,0,sizeof(struct fltrcrdr_t));
+        rcrdr->name = name;
+        rcrdr->wkuplmt = wkuplmt;
+        rcrdr->rcrd = &(rcrdr->scrtch);
+        rcrdr->dmpbuf = -1;
+        if (NULL == path)
+                return 0;       //succeded, disabled
+        for (int i = 0; i < 2; i++) {
+                //allocated before the memory is locked, so no page fault occurs in the real-time thread
+                rcrdr->bufs[i] = calloc(FLTRCRD_CYCLS,sizeof(struct fltrcrd_t));
+                if (NULL == rcrdr->bufs[i]) {
+                        free(rcrdr->bufs[0]);
+                        rcrdr->bufs[0] = NULL;
+                        return 1;       //fail
+                }
+        }
+        rcrdr->path = path;
+        return 0;       //succeded
+}
+
+/* hands the current buffer to the dump thread and continues in the other one */
+static void hndovr(struct fltrcrdr_t *rcrdr)
+{
+        if ((__atomic_load_n(&(rcrdr->dmpbuf), __ATOMIC_ACQUIRE) >= 0) ||
+            (__atomic_load_n(&(rcrdr->dmps), __ATOMIC_RELAXED) >= FLTRCRD_MAXDMPS)) {
+                //last dump not written yet or enough dumps, continue in the same buffer
+                __atomic_store_n(&(rcrdr->mssd), rcrdr->mssd + 1, __ATOMIC_RELAXED);
+                return;
+        }
+        if (rcrdr->pos > FLTRCRD_CYCLS) {
+                rcrdr->dmpcnt = FLTRCRD_CYCLS;
+                rcrdr->dmpstrt = rcrdr->pos & (FLTRCRD_CYCLS - 1);
+        } else {
+                rcrdr->dmpcnt = rcrdr->pos;
+                rcrdr->dmpstrt = 0;
+        }
+        rcrdr->dmptrgs = rcrdr->trgs;
+        rcrdr->dmptrgcycl = rcrdr->trgcycl;
+        __atomic_store_n(&(rcrdr->dmpbuf), rcrdr->cur, __ATOMIC_RELEASE);
+        rcrdr->cur ^= 1;
+        rcrdr->pos = 0;
+}
+
+struct fltrcrd_t *strtfltcycl(struct fltrcrdr_t *rcrdr, uint64_t cycl, const struct timespec *plndwkup)
+{
+        struct fltrcrd_t *rcrd;
+        struct timespec curtm;
+
+        if (NULL == rcrdr->path)
+                return rcrdr->rcrd;     //disabled, records go to the scratch record
+        //after the last cycle following a trigger, the buffer is dumped
+        if (rcrdr->pstcnt > 0) {
+                rcrdr->pstcnt--;
+                if (rcrdr->pstcnt == 0)
+                        hndovr(rcrdr);
+        }
+        rcrd = &(rcrdr->bufs[rcrdr->cur][rcrdr->pos & (FLTRCRD_CYCLS - 1)]);
+        rcrdr->pos++;
+        rcrdr->rcrd = rcrd;
+
+        //clock_gettime is served by the vDSO, no system call is made
+        clock_gettime(CLOCK_TAI,&curtm);
+        rcrd->cycl = cycl;
+        rcrd->plndwkup = cnvrt_tmspc2int64((struct timespec *) plndwkup);
+        rcrd->wkup = cnvrt_tmspc2int64(&curtm);
+        rcrd->txtm = 0;
+        rcrd->rxseq = -1;
+        rcrd->trgs = 0;
+        memset(rcrd->rets,0,sizeof(rcrd->rets));
+        if (rcrd->wkup - rcrd->plndwkup > rcrdr->wkuplmt)
+                trgfltrcrdr(rcrdr,FLTTRG_LATEWKUP);
+        return rcrd;
+}
+
+void trgfltrcrdr(struct fltrcrdr_t *rcrdr, enum flttrg_t trg)
+{
+        if (NULL == rcrdr->path)
+                return;
+        rcrdr->rcrd->trgs |= trg;
+        if (rcrdr->pstcnt == 0) {
+                //first trigger, the cycles after it are recorded before the dump
+                rcrdr->pstcnt = FLTRCRD_PSTCYCLS + 1;
+                rcrdr->trgs = trg;
+                rcrdr->trgcycl = rcrdr->rcrd->cycl;
+        } else {
+                rcrdr->trgs |= trg;
+        }
+}
+
+const char *flttrgstr(enum flttrg_t trg)
+{
+        switch(trg){
+        case FLTTRG_LATEWKUP:
+                return "late wake up";
+        case FLTTRG_SEQGAP:
+                return "sequence gap";
+        case FLTTRG_SHMTMOUT:
+                return "shared memory timeout";
+        case FLTTRG_ETFDRP:
+                return "ETF drop";
+        case FLTTRG_OVERRUN:
+                return "overrun";
+        default:
+                return "unknown";
+        }
+}
+
+/* names of all triggers of a mask */
+static const char *prttrgs(uint32_t trgs, char *str, size_t len)
+{
+        size_t pos = 0;
+        str[0] = '\0';
+        for (uint32_t trg = FLTTRG_LATEWKUP; trg <= FLTTRG_OVERRUN; trg <<= 1) {
+                if (!(trgs & trg) || (pos >= len))
+                        continue;
+                pos += snprintf(&(str[pos]), len - pos, "%s%s", (pos > 0) ? ", " : "", flttrgstr(trg));
+        }
+        return str;
+}
+
+/* writes the handed buffer to the next dump file */
+static int wrtdmp(struct fltrcrdr_t *rcrdr)
+{
+        struct fltdmphdr_t hdr;
+        struct fltrcrd_t *buf;
+        char flnm[256];
+        char trgs[128];
+        uint32_t frst;
+        FILE *fl;
+        int ok = 0;
+        int dmpbuf;
+
+        dmpbuf = __atomic_load_n(&(rcrdr->dmpbuf), __ATOMIC_ACQUIRE);
+        if (dmpbuf < 0)
+                return -1;      //nothing to dump
+        buf = rcrdr->bufs[dmpbuf];
+        memset(&hdr,0,sizeof(struct fltdmphdr_t));
+        hdr.magic = FLTRCRD_MAGIC;
+        hdr.vrsn = FLTRCRD_VRSN;
+        hdr.rcrdsz = sizeof(struct fltrcrd_t);
+        hdr.cnt = rcrdr->dmpcnt;
+        hdr.trgs = rcrdr->dmptrgs;
+        hdr.trgcycl = rcrdr->dmptrgcycl;
+        strncpy(hdr.name, rcrdr->name, sizeof(hdr.name) - 1);
+
+        snprintf(flnm, sizeof(flnm), "%s_%s_%llu.bin", rcrdr->path, rcrdr->name, (unsigned long long) rcrdr->dmps);
+        fl = fopen(flnm,"wb");
+        if (NULL == fl) {
+                printf("Flight recorder of %s thread: could not open %s\n", rcrdr->name, flnm);
+                ok = 1;
+        } else {
+                //records in the order of the cycles, the buffer may have wrapped
+                frst = FLTRCRD_CYCLS - rcrdr->dmpstrt;
+                if (frst > hdr.cnt)
+                        frst = hdr.cnt;
+                if ((fwrite(&hdr,sizeof(hdr),1,fl) != 1) ||
+                    (fwrite(&(buf[rcrdr->dmpstrt]),sizeof(struct fltrcrd_t),frst,fl) != frst) ||
+                    (fwrite(buf,sizeof(struct fltrcrd_t),hdr.cnt - frst,fl) != hdr.cnt - frst))
+                        ok = 1;
+                if (fclose(fl) != 0)
+                        ok = 1;
+                if (ok)
+                        printf("Flight recorder of %s thread: writing %s failed\n", rcrdr->name, flnm);
+                else
+                        printf("Flight recorder of %s thread: %u cycles written to %s, triggered in cycle %llu by %s\n",
+                               rcrdr->name, hdr.cnt, flnm, (unsigned long long) hdr.trgcycl, prttrgs(hdr.trgs,trgs,sizeof(trgs)));
+                __atomic_store_n(&(rcrdr->dmps), rcrdr->dmps + 1, __ATOMIC_RELAXED);
+        }
+        //hand the buffer back to the real-time thread
+        __atomic_store_n(&(rcrdr->dmpbuf), -1, __ATOMIC_RELEASE);
+        return ok;
+}
+
+static void *fltdmpthrd(void *arg)
+{
+        struct fltrcrdr_t *rcrdr = (struct fltrcrdr_t *) arg;
+        while (__atomic_load_n(&(rcrdr->run), __ATOMIC_ACQUIRE)) {
+                wrtdmp(rcrdr);
+                usleep(FLTRCRD_DMPINTRVL);
+        }
+        return NULL;
+}
+
+int strtfltrcrdr(struct fltrcrdr_t *rcrdr)
+{
+        if (NULL == rcrdr->path)
+                return 0;       //succeded, disabled
+        //normal (not real-time) priority, writing the file may block
+        __atomic_store_n(&(rcrdr->run), true, __ATOMIC_RELEASE);
+        if (pthread_create(&(rcrdr->thrd), NULL, fltdmpthrd, rcrdr) != 0) {
+                printf("create dump thread of the flight recorder failed\n");
+                rcrdr->run = false;
+                return 1;       //fail
+        }
+        return 0;       //succeded
+}
+
+void clsfltrcrdr(struct fltrcrdr_t *rcrdr)
+{
+        if (__atomic_load_n(&(rcrdr->run), __ATOMIC_ACQUIRE)) {
+                __atomic_store_n(&(rcrdr->run), false, __ATOMIC_RELEASE);
+                pthread_join(rcrdr->thrd, NULL);
+        }
+        if (NULL == rcrdr->path)
+                return;
+        wrtdmp(rcrdr);
+        rcrdr->path = NULL;
+        rcrdr->rcrd = &(rcrdr->scrtch);
+        free(rcrdr->bufs[0]);
+        free(rcrdr->bufs[1]);
+        rcrdr->bufs[0] = NULL;
+        rcrdr->bufs[1] = NULL;
+}
+
+void prtfltrcrdr(const struct fltrcrdr_t *rcrdr)
+{
+        if (NULL == rcrdr->path)
+                return;
+        printf("Flight recorder of %s thread: %llu dump(s) written, %llu trigger(s) not dumped\n", rcrdr->name,
+               (unsigned long long) __atomic_load_n(&(rcrdr->dmps), __ATOMIC_RELAXED),
+               (unsigned long long) __atomic_load_n(&(rcrdr->mssd), __ATOMIC_RELAXED));
+}
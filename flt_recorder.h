@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Flight recorder of a real-time thread. The thread writes one record per
+ * cycle (planned and actual wake up, TxTime, received sequence number,
+ * set-points and positions, return codes of the stages) into a preallocated
+ * circular buffer. When a trigger fires (late wake up, sequence gap, shared
+ * memory timeout, frame dropped by the ETF qdisc, overrun), some more cycles
+ * are recorded and then the buffer is handed to a dump thread, which writes it
+ * to a binary file, while the real-time thread continues in a second buffer.
+ * Recording never blocks: if the last dump is not written yet or the maximum
+ * number of dumps is reached, the trigger is only counted.
+ */
+
+#ifndef _FLTRECORDER_H_
+#define _FLTRECORDER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+
+#define FLTRCRD_CYCLS 1024              //recorded cycles per buffer, power of 2
+#define FLTRCRD_PSTCYCLS 64             //cycles recorded after the trigger before the buffer is dumped
+#define FLTRCRD_STGS 6                  //return codes per cycle, indexed by the stages of the thread
+#define FLTRCRD_VALS 8                  //values per cycle: set-points of the 4 axes, then positions of the 4 axes
+#define FLTRCRD_MAGIC 0x44524346        //"FCRD" at the start of a dump file
+#define FLTRCRD_VRSN 1
+#define FLTRCRD_DMPINTRVL 100000        //interval in us in which the dump thread checks for a dump
+#define FLTRCRD_MAXDMPS 16              //dump files written at most, later triggers are only counted
+
+/* triggers of a dump, bit mask */
+enum flttrg_t {
+        FLTTRG_LATEWKUP = 0x01,         //wake up later than the limit
+        FLTTRG_SEQGAP = 0x02,           //sequence numbers of a writer missing
+        FLTTRG_SHMTMOUT = 0x04,         //timeout writing the shared memory
+        FLTTRG_ETFDRP = 0x08,           //frame dropped by the ETF qdisc (TxTime missed or invalid)
+        FLTTRG_OVERRUN = 0x10,          //deadline of a cycle passed at its start
+};
+
+/* record of one cycle, all times CLOCK_TAI in ns */
+struct fltrcrd_t {
+        uint64_t cycl;
+        int64_t plndwkup;               //planned wake up
+        int64_t wkup;                   //actual wake up
+        int64_t txtm;                   //TxTime of the first sent frame, 0 if nothing was sent
+        int32_t rxseq;                  //sequence number of the last received frame, -1 if none
+        uint32_t trgs;                  //triggers which fired in this cycle
+        int8_t rets[FLTRCRD_STGS];      //return codes of the stages
+        uint8_t rsrvd[2];
+        int64_t vals[FLTRCRD_VALS];     //nano units, set-points and positions of the axes
+};
+
+/* header of a dump file, followed by cnt records in the order of the cycles */
+struct fltdmphdr_t {
+        uint32_t magic;
+        uint16_t vrsn;
+        uint16_t rcrdsz;                //size of a record
+        uint32_t cnt;                   //records in the file
+        uint32_t trgs;                  //all triggers which fired till the dump
+        uint64_t trgcycl;               //cycle of the first trigger
+        char name[16];                  //recording thread
+};
+
+/* flight recorder of one real-time thread */
+struct fltrcrdr_t {
+        const char *name;
+        const char *path;               //prefix of the dump files, NULL if disabled
+        int64_t wkuplmt;                //wake up latency which triggers a dump
+        struct fltrcrd_t *bufs[2];
+        int cur;                        //buffer written by the real-time thread
+        uint64_t pos;                   //records written to the current buffer
+        struct fltrcrd_t *rcrd;         //record of the current cycle
+        struct fltrcrd_t scrtch;        //record written before the first cycle or if disabled
+        int pstcnt;                     //cycles till the buffer is handed over, 0 if not triggered
+        uint32_t trgs;                  //triggers since the first trigger
+        uint64_t trgcycl;               //cycle of the first trigger
+        int dmpbuf;                     //buffer handed to the dump thread, -1 if none
+        uint32_t dmpcnt;                //records in the handed buffer
+        uint64_t dmpstrt;               //first record in the handed buffer
+        uint32_t dmptrgs;
+        uint64_t dmptrgcycl;
+        uint64_t dmps;                  //written dumps
+        uint64_t mssd;                  //triggers not dumped, the last dump was not written yet or too many dumps
+        bool run;
+        pthread_t thrd;
+};
+
+/* initialize the recorder and allocate the buffers, path NULL disables it */
+int initfltrcrdr(struct fltrcrdr_t *rcrdr, const char *name, const char *path, int64_t wkuplmt);
+
+/* start the dump thread */
+int strtfltrcrdr(struct fltrcrdr_t *rcrdr);
+
+/* start the record of a cycle after the wake up, checks the wake up latency and returns the record */
+struct fltrcrd_t *strtfltcycl(struct fltrcrdr_t *rcrdr, uint64_t cycl, const struct timespec *plndwkup);
+
+/* fire a trigger in the current cycle */
+void trgfltrcrdr(struct fltrcrdr_t *rcrdr, enum flttrg_t trg);
+
+/* get name of a trigger */
+const char *flttrgstr(enum flttrg_t trg);
+
+/* stop the dump thread, write a handed buffer and free the buffers */
+void clsfltrcrdr(struct fltrcrdr_t *rcrdr);
+
+/* print the number of dumps */
+void prtfltrcrdr(const struct fltrcrdr_t *rcrdr);
+
+#endif /* _FLTRECORDER_H_ */
@@ -4,10 +4,20 @@
  * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
  */
 
+#define _GNU_SOURCE
 #include "packet_handler.h"
+#include "rt_log.h"
+#include "pcap_tap.h"
 #include <arpa/inet.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <linux/filter.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+#include <linux/sockios.h>
+#include "cnvrt_simd.h"
 
 void initpkthdrs(struct rt_pkt_t* pkt, uint16_t pubid)
 {
@@ -20,11 +30,20 @@ void initpkthdrs(struct rt_pkt_t* pkt, uint16_t pubid)
         pkt->grp_hdr->grpVer = htonl(GRPVER);
 }
 
+/* the dataset messages are packed with the size of their type, the union is
+ * larger than an axis message, so indexing the union array is not possible */
+static union dtstmsg_t* dtstmsgat(struct rt_pkt_t* pkt, int idx, int dtstmsgsz)
+{
+        return (union dtstmsg_t*) ((char *) pkt->dtstmsg + idx*dtstmsgsz);
+}
+
 int setpkt(struct rt_pkt_t* pkt, int msgcnt, enum msgtyp_t msgtyp, uint16_t pubid)
 {
         uint16_t dtstmsgsz = 0;
         int msgfldsz;
         int msgfldcnt;
+        if ((msgcnt < 1) || (msgcnt > MAXDTSTMSGS))
+                return 1;       //fail
         memset(pkt->sktbf,0,MAXPKTSZ*sizeof(char));
         pkt->eth_hdr = NULL; //pkt->sktbf;
         pkt->ip_hdr = NULL;
@@ -41,7 +60,7 @@ int setpkt(struct rt_pkt_t* pkt, int msgcnt, enum msgtyp_t msgtyp, uint16_t pubi
                 msgfldcnt = 0;
         } else {
                 //for msgcnt >1, set sizes of datasetmessages in sizearray
-                pkt->szrry = (struct szrry_t*) ((char *) pkt->extntwrkmsg_hdr + sizeof(struct ntwrkmsg_hdr_t));
+                pkt->szrry = (struct szrry_t*) ((char *) pkt->extntwrkmsg_hdr + sizeof(struct extntwrkmsg_hdr_t));
                 msgfldsz = msgcnt*sizeof(*(pkt->szrry));
                 msgfldcnt = msgcnt;
         }
@@ -52,8 +71,8 @@ int setpkt(struct rt_pkt_t* pkt, int msgcnt, enum msgtyp_t msgtyp, uint16_t pubi
                 pkt->len = sizeof(struct ntwrkmsg_hdr_t) + sizeof(struct grp_hdr_t) + sizeof(struct extntwrkmsg_hdr_t) + sizeof(pkt->pyld_hdr->msgcnt) + msgcnt*sizeof(pkt->pyld_hdr->wrtrId) + msgfldsz + msgcnt*sizeof(struct dtstmsg_cntrl_t);
                 dtstmsgsz = sizeof(struct dtstmsg_cntrl_t);
                 while(i<msgcnt) {
-                        pkt->dtstmsg[i].dtstmsg_cntrl.dtstmsg_hdr = 0x01;
-                        pkt->dtstmsg[i].dtstmsg_cntrl.fldcnt = htons(11);
+                        dtstmsgat(pkt,i,dtstmsgsz)->dtstmsg_cntrl.dtstmsg_hdr = 0x01;
+                        dtstmsgat(pkt,i,dtstmsgsz)->dtstmsg_cntrl.fldcnt = htons(11);
                         i++;
                 }
                 break;
@@ -61,8 +80,8 @@ int setpkt(struct rt_pkt_t* pkt, int msgcnt, enum msgtyp_t msgtyp, uint16_t pubi
                 pkt->len = sizeof(struct ntwrkmsg_hdr_t) + sizeof(struct grp_hdr_t) + sizeof(struct extntwrkmsg_hdr_t) + sizeof(pkt->pyld_hdr->msgcnt) + msgcnt*sizeof(pkt->pyld_hdr->wrtrId) + msgfldsz + msgcnt*sizeof(struct dtstmsg_axs_t);
                 dtstmsgsz = sizeof(struct dtstmsg_axs_t);
                 while(i<msgcnt) {
-                        pkt->dtstmsg[i].dtstmsg_axs.dtstmsg_hdr = 0x01;
-                        pkt->dtstmsg[i].dtstmsg_axs.fldcnt = htons(2);
+                        dtstmsgat(pkt,i,dtstmsgsz)->dtstmsg_axs.dtstmsg_hdr = 0x01;
+                        dtstmsgat(pkt,i,dtstmsgsz)->dtstmsg_axs.fldcnt = htons(2);
                         i++;
                 }
                 break;
@@ -97,6 +116,7 @@ int createpkt(struct rt_pkt_t** pkt)
                 return 1;
         }
 
+        newpkt->stridx = PKTSTRG_NIL;
         *pkt = newpkt;
         return 0;       //succeded
 }
@@ -120,7 +140,7 @@ void destroypkt(struct rt_pkt_t* pkt)
 
 int fillcntrlpkt(struct rt_pkt_t* pkt, struct cntrlnfo_t* cntrlnfo, uint16_t seqno)
 {
-        int64_t tmp;
+        double vals[4];
         struct timespec time;
         int ok = 0;
         pkt->grp_hdr->seqNo = htons(seqno);
@@ -128,17 +148,15 @@ int fillcntrlpkt(struct rt_pkt_t* pkt, struct cntrlnfo_t* cntrlnfo, uint16_t seq
         if(pkt->pyld_hdr->msgcnt != 1)
                 return 1; //fail
         pkt->pyld_hdr->wrtrId = htons(WRITERID_CNTRL);
-        ok += dbl2nint64(cntrlnfo->x_set.cntrlvl,&tmp);
-        pkt->dtstmsg[0].dtstmsg_cntrl.xvel_set = htobe64(tmp);
+        //the four set values are consecutive in the datasetmessage and converted at once
+        vals[0] = cntrlnfo->x_set.cntrlvl;
+        vals[1] = cntrlnfo->y_set.cntrlvl;
+        vals[2] = cntrlnfo->z_set.cntrlvl;
+        vals[3] = cntrlnfo->s_set.cntrlvl;
+        ok += dbls2nbe64(vals,(char *) pkt->dtstmsg + offsetof(struct dtstmsg_cntrl_t,xvel_set),4);
         pkt->dtstmsg[0].dtstmsg_cntrl.xenable = cntrlnfo->x_set.cntrlsw;
-        ok += dbl2nint64(cntrlnfo->y_set.cntrlvl,&tmp);
-        pkt->dtstmsg[0].dtstmsg_cntrl.yvel_set = htobe64(tmp);
         pkt->dtstmsg[0].dtstmsg_cntrl.yenable = cntrlnfo->y_set.cntrlsw;
-        ok += dbl2nint64(cntrlnfo->z_set.cntrlvl,&tmp);
-        pkt->dtstmsg[0].dtstmsg_cntrl.zvel_set = htobe64(tmp);
         pkt->dtstmsg[0].dtstmsg_cntrl.zenable = cntrlnfo->z_set.cntrlsw;
-        ok += dbl2nint64(cntrlnfo->s_set.cntrlvl,&tmp);
-        pkt->dtstmsg[0].dtstmsg_cntrl.spindlespeed = htobe64(tmp);
         pkt->dtstmsg[0].dtstmsg_cntrl.spindleenable = cntrlnfo->s_set.cntrlsw;
         pkt->dtstmsg[0].dtstmsg_cntrl.spindlebrake = (uint8_t) cntrlnfo->spindlebrake;
         pkt->dtstmsg[0].dtstmsg_cntrl.machinestatus = (uint8_t) cntrlnfo->machinestatus;
@@ -152,36 +170,86 @@ int fillcntrlpkt(struct rt_pkt_t* pkt, struct cntrlnfo_t* cntrlnfo, uint16_t seq
  
 int fillaxspkt(struct rt_pkt_t* pkt, struct axsnfo_t* axsnfo, uint16_t seqno)
 {
-        int64_t tmp;
+        return fillaxspkts(pkt,axsnfo,1,seqno);
+}
+
+/* fills the datasetmessages of cnt axes with the positions nvals (already big endian) */
+static void fillaxsmsgs(struct rt_pkt_t* pkt, struct axsnfo_t axsnfos[], const int64_t nvals[], int cnt, uint16_t seqno)
+{
         struct timespec time;
-        int ok = 0;
+        union dtstmsg_t *dtstmsg;
         pkt->grp_hdr->seqNo = htons(seqno);
-        
-        if(pkt->pyld_hdr->msgcnt != 1)
+        for (int i = 0; i < cnt; i++) {
+                //writer ids are an array in the payload header
+                *(&(pkt->pyld_hdr->wrtrId) + i) = htons(axs2wrtrid(axsnfos[i].axsID));
+                dtstmsg = dtstmsgat(pkt,i,sizeof(struct dtstmsg_axs_t));
+                dtstmsg->dtstmsg_axs.pos_cur = nvals[i];
+                dtstmsg->dtstmsg_axs.fault = (uint8_t) axsnfos[i].cntrlsw;
+        }
+
+        clock_gettime(CLOCK_TAI,&time);
+        pkt->extntwrkmsg_hdr->timestamp = cnvrt_tmspc2uatm(time);
+}
+
+int fillaxspkts(struct rt_pkt_t* pkt, struct axsnfo_t axsnfos[], int cnt, uint16_t seqno)
+{
+        double vals[MAXDTSTMSGS];
+        int64_t nvals[MAXDTSTMSGS];
+        int ok = 0;
+
+        if((cnt > MAXDTSTMSGS) || (pkt->pyld_hdr->msgcnt != cnt))
+                return 1; //fail
+        //convert the positions of all axes at once
+        for (int i = 0; i < cnt; i++)
+                vals[i] = axsnfos[i].cntrlvl;
+        ok += dbls2nbe64(vals,nvals,cnt);
+        fillaxsmsgs(pkt,axsnfos,nvals,cnt,seqno);
+        return ok;
+}
+
+int fillaxspktsfxp(struct rt_pkt_t* pkt, struct axsnfo_t axsnfos[], int cnt, uint16_t seqno)
+{
+        int64_t nvals[MAXDTSTMSGS];
+
+        if((cnt > MAXDTSTMSGS) || (pkt->pyld_hdr->msgcnt != cnt))
                 return 1; //fail
-        switch(axsnfo->axsID){
+        //positions are already in nano units, only the byte order changes
+        for (int i = 0; i < cnt; i++)
+                nvals[i] = htobe64(axsnfos[i].ncntrlvl);
+        fillaxsmsgs(pkt,axsnfos,nvals,cnt,seqno);
+        return 0; //succeded
+}
+
+uint16_t axs2wrtrid(enum axsID_t axsID)
+{
+        switch(axsID){
         case x:
-                pkt->pyld_hdr->wrtrId = htons(WRITERID_AXX);
-                break;
+                return WRITERID_AXX;
         case y: 
-                pkt->pyld_hdr->wrtrId = htons(WRITERID_AXY);
-                break;
+                return WRITERID_AXY;
         case z:
-                pkt->pyld_hdr->wrtrId = htons(WRITERID_AXZ);
-                break;
+                return WRITERID_AXZ;
         case s: 
-                pkt->pyld_hdr->wrtrId = htons(WRITERID_AXS);
-                break;
+                return WRITERID_AXS;
         default:
-                pkt->pyld_hdr->wrtrId = htons(0);
+                return 0;
         }
-        ok += dbl2nint64(axsnfo->cntrlvl,&tmp);
-        pkt->dtstmsg[0].dtstmsg_axs.pos_cur = htobe64(tmp);
-        pkt->dtstmsg[0].dtstmsg_axs.fault = (uint8_t) axsnfo->cntrlsw;
+}
 
-        clock_gettime(CLOCK_TAI,&time);
-        pkt->extntwrkmsg_hdr->timestamp = cnvrt_tmspc2uatm(time);
-        return 0;
+int wrtrid2axs(uint16_t wrtrid)
+{
+        switch(wrtrid){
+        case WRITERID_AXX:
+                return x;
+        case WRITERID_AXY:
+                return y;
+        case WRITERID_AXZ:
+                return z;
+        case WRITERID_AXS:
+                return s;
+        default:
+                return -1;      //fail
+        }
 }
 
 int dbl2nint64(double val, int64_t* res)
@@ -197,6 +265,119 @@ double nint642dbl(int64_t val)
         return (double)(val*1e-9);
 }
 
+
+/* ##### Batch conversion ##### */
+
+/* The vector kernels are in cnvrt_simd.c, which is always built optimized */
+static int cnvrtisa = -1;       //used instruction set, -1 if not detected yet
+
+static int dbls2nbe64_scalar(const double vals[], char *res, int cnt)
+{
+        int64_t tmp;
+        int ok = 0;
+        for (int i = 0; i < cnt; i++) {
+                tmp = 0;
+                ok |= dbl2nint64(vals[i],&tmp);
+                tmp = htobe64(tmp);
+                memcpy(res + i*sizeof(int64_t),&tmp,sizeof(int64_t));
+        }
+        return ok;
+}
+
+static void nbe642dbls_scalar(const char *vals, double res[], int cnt)
+{
+        int64_t tmp;
+        for (int i = 0; i < cnt; i++) {
+                memcpy(&tmp,vals + i*sizeof(int64_t),sizeof(int64_t));
+                res[i] = nint642dbl(be64toh(tmp));
+        }
+}
+
+
+static void dtctcnvrtisa(void)
+{
+#ifdef CNVRT_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+                cnvrtisa = CNVRT_AVX2;
+        else if (__builtin_cpu_supports("sse4.1"))
+                cnvrtisa = CNVRT_SSE41;
+        else
+#endif
+                cnvrtisa = CNVRT_SCALAR;
+}
+
+int setcnvrtisa(enum cnvrtisa_t isa)
+{
+        enum cnvrtisa_t avlbl;
+        dtctcnvrtisa();
+        avlbl = cnvrtisa;
+        if (isa > avlbl)
+                return 1;       //fail, not supported by the cpu
+        cnvrtisa = isa;
+        return 0;       //succeded
+}
+
+enum cnvrtisa_t getcnvrtisa(void)
+{
+        if (cnvrtisa < 0)
+                dtctcnvrtisa();
+        return cnvrtisa;
+}
+
+int dbls2nbe64(const double vals[], void *res, int cnt)
+{
+        int64_t tmp = 0;
+        int ok;
+        if (cnt == 1) {
+                //one position per frame in the default mode, without loop and dispatch
+                ok = dbl2nint64(vals[0],&tmp);
+                tmp = htobe64(tmp);
+                memcpy(res,&tmp,sizeof(int64_t));
+                return ok;
+        }
+        if (cnt < 1)
+                return 0;       //succeded, nothing to convert
+        switch(getcnvrtisa()){
+#ifdef CNVRT_X86
+        case CNVRT_AVX2:
+                return dbls2nbe64_avx2(vals,res,cnt);
+        case CNVRT_SSE41:
+                return dbls2nbe64_sse41(vals,res,cnt);
+#endif
+        default:
+                return dbls2nbe64_scalar(vals,res,cnt);
+        }
+}
+
+void nbe642dbls(const void *vals, double res[], int cnt)
+{
+        int64_t tmp;
+        if (cnt == 1) {
+                //one position per frame in the default mode, without loop and dispatch
+                memcpy(&tmp,vals,sizeof(int64_t));
+                res[0] = nint642dbl(be64toh(tmp));
+                return;
+        }
+        if (cnt < 1)
+                return;
+        switch(getcnvrtisa()){
+#ifdef CNVRT_X86
+        case CNVRT_AVX2:
+                nbe642dbls_avx2(vals,res,cnt);
+                break;
+        case CNVRT_SSE41:
+                nbe642dbls_sse41(vals,res,cnt);
+                break;
+#endif
+        default:
+                nbe642dbls_scalar(vals,res,cnt);
+                break;
+        }
+}
+
+/* ##### END Batch conversion ##### */
+
 int fillethaddr(struct sockaddr_ll *addr, uint8_t *mac_addr, uint16_t ethtyp, int fd, char *ifnm)
 {
         if (NULL == addr)
@@ -263,12 +444,59 @@ int sendpkt(int fd, void *buf, int buflen, struct sockaddr_ll *addr, uint64_t tx
 
         sndcnt = sendmsg(fd,&msg_hdr,0);
         if (sndcnt < 0) {
-		printf("error in sndmsg, errono: %d;",errno);
+		rtlog(LOG_SNDFAIL,NULL,errno,0,0);
                 return 1;       //fail
 	}
+        captx(addr,buf,buflen,txtime);
         return 0;
 }
 
+/* builds a classic BPF program which only accepts frames with the Ethertype,
+ * the supported NetworkMessage flags, writer group and group version and one of
+ * the destination MAC-addresses. Returns the number of instructions */
+static int bldrxfltr(struct sock_filter *fltr, char *mac_addrs[], int no_macs)
+{
+        int len = 0;
+        int drop;
+        uint32_t macl;
+        uint16_t mach;
+        //offsets of the fields in the received frame (including Ethernet header)
+        const uint32_t ofst_ver = sizeof(struct eth_hdr_t);
+        const uint32_t ofst_wgrp = ofst_ver + sizeof(struct ntwrkmsg_hdr_t) + sizeof(uint8_t);
+        const uint32_t ofst_grpver = ofst_wgrp + sizeof(uint16_t);
+
+        //jump to drop is patched after the length of the program is known
+        fltr[len++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12);
+        fltr[len++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETHERTYPE, 0, 0);
+        fltr[len++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_B | BPF_ABS, ofst_ver);
+        fltr[len++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0xF1, 0, 0);
+        fltr[len++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_B | BPF_ABS, ofst_ver + 1);
+        fltr[len++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x21, 0, 0);
+        fltr[len++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_H | BPF_ABS, ofst_wgrp);
+        fltr[len++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, WGRPID, 0, 0);
+        fltr[len++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_W | BPF_ABS, ofst_grpver);
+        fltr[len++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, GRPVER, 0, 0);
+        //compare destination MAC-address: lower 4 bytes, then upper 2 bytes
+        for (int i = 0; i < no_macs; i++) {
+                memcpy(&macl, &(mac_addrs[i][2]), sizeof(macl));
+                memcpy(&mach, &(mac_addrs[i][0]), sizeof(mach));
+                macl = ntohl(macl);
+                mach = ntohs(mach);
+                fltr[len++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 2);
+                fltr[len++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, macl, 0, 2);
+                fltr[len++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 0);
+                //accept is behind the remaining MAC-address checks and the drop
+                fltr[len++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, mach, (no_macs - i - 1)*4 + 1, 0);
+        }
+        drop = len;
+        fltr[len++] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, 0);
+        fltr[len++] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, UINT32_MAX);
+        //patch jumps of the header checks to drop
+        for (int i = 1; i < 10; i += 2)
+                fltr[i].jf = drop - i - 1;
+        return len;
+}
+
 int opnrxsckt(char *ifnm, char *mac_addrs[], int no_macs)
 {
         struct ifreq ifopts;
@@ -276,12 +504,27 @@ int opnrxsckt(char *ifnm, char *mac_addrs[], int no_macs)
         int rxsckt;
         struct sockaddr_ll scktaddr;
         struct packet_mreq pkt_mr;
+        struct sock_filter fltr[RXFLTR_MAXLEN];
+        struct sock_fprog fprog;
+        char drnbf[1];
         memset(&pkt_mr, 0, sizeof(struct packet_mreq));
 
+        if ((no_macs < 1) || (no_macs > RXFLTR_MAXMACS))
+                return -1;      //fail
         rxsckt = socket(AF_PACKET,SOCK_RAW,htons(ETHERTYPE));
         if (rxsckt < 0)
                 return -1;      //fail
 
+        // only let frames for the application pass to the socket
+        fprog.len = bldrxfltr(fltr, mac_addrs, no_macs);
+        fprog.filter = fltr;
+        if (setsockopt(rxsckt, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(struct sock_fprog)) < 0) {
+                close(rxsckt);
+                return -1;      //fail
+        }
+        // drop frames queued before the filter was attached
+        while (recv(rxsckt, drnbf, sizeof(drnbf), MSG_DONTWAIT | MSG_TRUNC) >= 0);
+
         // allow socket to be reused
         if (setsockopt(rxsckt, SOL_SOCKET, SO_REUSEADDR, &scktopts, sizeof(scktopts)) < 0) {
                 close(rxsckt);
@@ -311,10 +554,40 @@ int opnrxsckt(char *ifnm, char *mac_addrs[], int no_macs)
         return rxsckt;
 }
 
+/* space for the RX timestamp in the control message of a received packet */
+#define RXTMSTMP_CMSGSZ CMSG_SPACE(sizeof(struct scm_timestamping))
+
+/* takes the RX timestamp from the control message, the hardware timestamp is preferred */
+static void getrxtmstmp(struct msghdr *msg_hdr, struct rt_pkt_t *pkt)
+{
+        struct cmsghdr *cmsg;
+        struct scm_timestamping tss;
+
+        pkt->rxtmstmp = 0;
+        pkt->rxhw = false;
+        if (msg_hdr->msg_controllen == 0)
+                return;
+        for (cmsg = CMSG_FIRSTHDR(msg_hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(msg_hdr, cmsg)) {
+                if ((cmsg->cmsg_level != SOL_SOCKET) || (cmsg->cmsg_type != SO_TIMESTAMPING))
+                        continue;
+                memcpy(&tss,CMSG_DATA(cmsg),sizeof(struct scm_timestamping));
+                if ((tss.ts[2].tv_sec != 0) || (tss.ts[2].tv_nsec != 0)) {
+                        pkt->rxtmstmp = cnvrt_tmspc2int64(&(tss.ts[2]));
+                        pkt->rxhw = true;
+                } else {
+                        pkt->rxtmstmp = cnvrt_tmspc2int64(&(tss.ts[0]));
+                }
+        }
+}
+
 int rcvpkt(int fd, struct rt_pkt_t* pkt, struct msghdr * rcvmsg_hdr)
 {
         int ok = 0;
         struct iovec msg_iov;
+        union {
+                char buf[RXTMSTMP_CMSGSZ];
+                struct cmsghdr align;
+        } cntlmsg;
         if (NULL == pkt)
                 return 1;       //fail
         if(NULL == rcvmsg_hdr)
@@ -325,19 +598,70 @@ int rcvpkt(int fd, struct rt_pkt_t* pkt, struct msghdr * rcvmsg_hdr)
         rcvmsg_hdr->msg_iov->iov_base = pkt->sktbf;
         rcvmsg_hdr->msg_iov->iov_len = MAXPKTSZ;
         rcvmsg_hdr->msg_iovlen = 1;
+        rcvmsg_hdr->msg_control = cntlmsg.buf;
+        rcvmsg_hdr->msg_controllen = sizeof(cntlmsg.buf);
         
         ok = recvmsg(fd, rcvmsg_hdr, MSG_DONTWAIT);
         if(ok < 0){
-                printf("recv failed errno: %d\n",errno);
+                rtlog(LOG_RCVFAIL,NULL,errno,0,0);
                 return 1;       //fail
         }
         if(MSG_TRUNC == (rcvmsg_hdr->msg_flags & MSG_TRUNC))
                 return 1;       //fail
         pkt->len = ok;
+        getrxtmstmp(rcvmsg_hdr,pkt);
+        caprx(pkt->sktbf,pkt->len,pkt->rxtmstmp,pkt->rxhw);
+        //control message is only valid in this function
+        rcvmsg_hdr->msg_control = NULL;
+        rcvmsg_hdr->msg_controllen = 0;
 
         return 0;
 }
 
+int rcvpkts(int fd, struct rt_pkt_t* pkts[], int cnt)
+{
+        int rcvcnt;
+        struct mmsghdr msgs[MAXRCVBATCH];
+        struct iovec msg_iovs[MAXRCVBATCH];
+        union {
+                char buf[RXTMSTMP_CMSGSZ];
+                struct cmsghdr align;
+        } cntlmsgs[MAXRCVBATCH];
+        if ((cnt <= 0) || (cnt > MAXRCVBATCH))
+                return -1;      //fail
+
+        memset(msgs,0,cnt*sizeof(struct mmsghdr));
+        for (int i = 0; i < cnt; i++) {
+                if (NULL == pkts[i])
+                        return -1;      //fail
+                msg_iovs[i].iov_base = pkts[i]->sktbf;
+                msg_iovs[i].iov_len = MAXPKTSZ;
+                msgs[i].msg_hdr.msg_iov = &(msg_iovs[i]);
+                msgs[i].msg_hdr.msg_iovlen = 1;
+                msgs[i].msg_hdr.msg_control = cntlmsgs[i].buf;
+                msgs[i].msg_hdr.msg_controllen = sizeof(cntlmsgs[i].buf);
+        }
+
+        rcvcnt = recvmmsg(fd, msgs, cnt, MSG_DONTWAIT, NULL);
+        if (rcvcnt < 0) {
+                if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                        return 0;       //nothing queued
+                rtlog(LOG_RCVFAIL,NULL,errno,0,0);
+                return -1;      //fail
+        }
+        for (int i = 0; i < rcvcnt; i++) {
+                //only packets which are not truncated are forwarded
+                if(MSG_TRUNC == (msgs[i].msg_hdr.msg_flags & MSG_TRUNC))
+                        pkts[i]->len = 0;
+                else
+                        pkts[i]->len = msgs[i].msg_len;
+                getrxtmstmp(&(msgs[i].msg_hdr),pkts[i]);
+                if (pkts[i]->len > 0)
+                        caprx(pkts[i]->sktbf,pkts[i]->len,pkts[i]->rxtmstmp,pkts[i]->rxhw);
+        }
+        return rcvcnt;
+}
+
 int chckethhdr(struct rt_pkt_t* pkt, char *mac_addrs[], int no_macs)
 {
         struct eth_hdr_t * rcvd_ethhdr;
@@ -379,6 +703,8 @@ int prspkt(struct rt_pkt_t* pkt, enum msgtyp_t *pkttyp)
         pkt->grp_hdr = (struct grp_hdr_t*) ((char *) pkt->ntwrkmsg_hdr + sizeof(struct ntwrkmsg_hdr_t));
         pkt->pyld_hdr = (struct pyld_hdr_t*) ((char *) pkt->grp_hdr + sizeof(struct grp_hdr_t));
         msgcnt = pkt->pyld_hdr->msgcnt;
+        if ((msgcnt < 1) || (msgcnt > MAXDTSTMSGS))
+                return -1;      //fail
         pkt->extntwrkmsg_hdr = (struct extntwrkmsg_hdr_t*) ((char *) pkt->pyld_hdr + sizeof(pkt->pyld_hdr->msgcnt) + msgcnt*sizeof(pkt->pyld_hdr->wrtrId));
         if (msgcnt < 2){
                 //for msgcnt = 1, sizearray is omitted
@@ -390,10 +716,17 @@ int prspkt(struct rt_pkt_t* pkt, enum msgtyp_t *pkttyp)
                         dtstmsgsz = pkt->len - sizeof(struct eth_hdr_t) - sizeof(struct ntwrkmsg_hdr_t) - sizeof(struct grp_hdr_t) - sizeof(struct extntwrkmsg_hdr_t) - sizeof(pkt->pyld_hdr->msgcnt) - msgcnt*sizeof(pkt->pyld_hdr->wrtrId) - msgfldsz;
                 }
         } else {
-                //for msgcnt >1, set sizes of datasetmessages in sizearray
-                pkt->szrry = (struct szrry_t*) ((char *) pkt->extntwrkmsg_hdr + sizeof(struct ntwrkmsg_hdr_t));
+                //for msgcnt >1, get sizes of datasetmessages from sizearray
+                pkt->szrry = (struct szrry_t*) ((char *) pkt->extntwrkmsg_hdr + sizeof(struct extntwrkmsg_hdr_t));
                 msgfldsz = msgcnt*sizeof(*(pkt->szrry));
                 dtstmsgsz = ntohs(pkt->szrry->size);
+                //limitation: all datasetmessages have the same size and type, and must fit into the packet
+                for (int i = 1; i < msgcnt; i++) {
+                        if (ntohs(*(&(pkt->szrry->size) + i)) != dtstmsgsz)
+                                return -1;      //fail
+                }
+                if (((char *) pkt->extntwrkmsg_hdr - (char *) pkt->sktbf) + sizeof(struct extntwrkmsg_hdr_t) + msgfldsz + msgcnt*dtstmsgsz > pkt->len)
+                        return -1;      //fail
         }
         pkt->dtstmsg = (union dtstmsg_t*) ((char *) pkt->extntwrkmsg_hdr + sizeof(struct extntwrkmsg_hdr_t) + msgfldsz);
         // limitation: only one type of dataset-message in a single packet supported
@@ -411,6 +744,13 @@ int prspkt(struct rt_pkt_t* pkt, enum msgtyp_t *pkttyp)
         return msgcnt;
 }
 
+int prswrtrid(struct rt_pkt_t* pkt, int idx)
+{
+        if ((idx < 0) || (idx >= pkt->pyld_hdr->msgcnt))
+                return -1;      //fail
+        return wrtrid2axs(ntohs(*(&(pkt->pyld_hdr->wrtrId) + idx)));
+}
+
 int chckpkthdrs(struct rt_pkt_t* pkt)
 {
         //check if flags are the supported paket modes
@@ -443,8 +783,10 @@ int prsdtstmsg(struct rt_pkt_t* pkt, enum msgtyp_t pkttyp, union dtstmsg_t *dtst
                 return 1;       //fail
         }
         
+        if (pkt->pyld_hdr->msgcnt > MAXDTSTMSGS)
+                return 1;       //fail
         while(*dtstmsgcnt < pkt->pyld_hdr->msgcnt) {
-                dtstmsgs[*dtstmsgcnt] = (union dtstmsg_t*) (pkt->dtstmsg + (*dtstmsgcnt)*dtstmsgsz); 
+                dtstmsgs[*dtstmsgcnt] = dtstmsgat(pkt,*dtstmsgcnt,dtstmsgsz);
 
                 (*dtstmsgcnt)++;
         }
@@ -465,17 +807,19 @@ int prsaxsmsg(union dtstmsg_t *dtstmsg, struct axsnfo_t * axsnfo)
 
 int prscntrlmsg(union dtstmsg_t *dtstmsg, struct cntrlnfo_t * cntrlnfo)
 {
+        double vals[4];
         if(dtstmsg->dtstmsg_cntrl.dtstmsg_hdr != 0x01)
                 return 1;       //fail
         if(dtstmsg->dtstmsg_cntrl.fldcnt != ntohs(11))    //identifier if truly control-dataset-message
                 return 1;       //fail
-        cntrlnfo->x_set.cntrlvl = nint642dbl(be64toh(dtstmsg->dtstmsg_cntrl.xvel_set));
+        nbe642dbls((char *) dtstmsg + offsetof(struct dtstmsg_cntrl_t,xvel_set),vals,4);
+        cntrlnfo->x_set.cntrlvl = vals[0];
         cntrlnfo->x_set.cntrlsw = (bool) dtstmsg->dtstmsg_cntrl.xenable;
-        cntrlnfo->y_set.cntrlvl = nint642dbl(be64toh(dtstmsg->dtstmsg_cntrl.yvel_set));
+        cntrlnfo->y_set.cntrlvl = vals[1];
         cntrlnfo->y_set.cntrlsw = (bool) dtstmsg->dtstmsg_cntrl.yenable;
-        cntrlnfo->z_set.cntrlvl = nint642dbl(be64toh(dtstmsg->dtstmsg_cntrl.zvel_set));
+        cntrlnfo->z_set.cntrlvl = vals[2];
         cntrlnfo->z_set.cntrlsw = (bool) dtstmsg->dtstmsg_cntrl.zenable;
-        cntrlnfo->s_set.cntrlvl = nint642dbl(be64toh(dtstmsg->dtstmsg_cntrl.spindlespeed));
+        cntrlnfo->s_set.cntrlvl = vals[3];
         cntrlnfo->s_set.cntrlsw = (bool) dtstmsg->dtstmsg_cntrl.spindleenable;
         cntrlnfo->spindlebrake = (bool) dtstmsg->dtstmsg_cntrl.spindlebrake;
         cntrlnfo->estopstatus = (bool) dtstmsg->dtstmsg_cntrl.estopstatus;
@@ -485,30 +829,944 @@ int prscntrlmsg(union dtstmsg_t *dtstmsg, struct cntrlnfo_t * cntrlnfo)
 }
 
 
+/* ##### Fused decoders ##### */
+
+#define DCD_HDROFFS 12                  //offset of the compared header bytes (ethertype up to message count)
+#define DCD_PUBIDOFFS 16                //offset of the publisher id
+#define DCD_SEQNOOFFS 25                //offset of the sequence number
+#define DCD_MSGCNTOFFS 27               //offset of the message count
+#define DCD_WRTRIDOFFS 28               //offset of the writer id array
+
+/* expected values and masks of the 16 header bytes from the ethertype up to the message count */
+static const uint8_t dcdhdrval[16] = {
+        ETHERTYPE >> 8, ETHERTYPE & 0xFF,                       //ethertype
+        0xF1, 0x21, 0x00, 0x00,                                 //network message header flags, publisher id
+        0x0B, WGRPID >> 8, WGRPID & 0xFF,                       //group flags, writer group id
+        GRPVER >> 24, (GRPVER >> 16) & 0xFF, (GRPVER >> 8) & 0xFF, GRPVER & 0xFF,  //group version
+        0x00, 0x00,                                             //sequence number
+        0x00};                                                  //message count
+static const uint8_t dcdhdrmsk[16] = {
+        0xFF, 0xFF,
+        0xFF, 0xFF, 0x00, 0x00,
+        0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF,
+        0x00, 0x00,
+        0x00};
+
+static inline uint64_t ldu64(const unsigned char *p)
+{
+        uint64_t val;
+        memcpy(&val,p,sizeof(uint64_t));
+        return val;
+}
+
+/* loads a MAC-address as 48 bit value, without partial stores which would stall the load */
+static inline uint64_t ldmac(const void *p)
+{
+        uint32_t lo;
+        uint16_t hi;
+        memcpy(&lo,p,sizeof(uint32_t));
+        memcpy(&hi,(const char *) p + sizeof(uint32_t),sizeof(uint16_t));
+        return (uint64_t) lo | ((uint64_t) hi << 32);
+}
+
+/* offset of the first datasetmessage in a frame with msgcnt messages */
+static inline uint32_t dcdmsgoffs(int msgcnt)
+{
+        uint32_t offs = DCD_WRTRIDOFFS + msgcnt*sizeof(uint16_t) + sizeof(struct extntwrkmsg_hdr_t);
+        if (msgcnt > 1)
+                offs += msgcnt*sizeof(uint16_t);        //size array
+        return offs;
+}
+
+static inline uint16_t dcdwrtrid(const unsigned char *frm, int idx)
+{
+        uint16_t wrtrid;
+        memcpy(&wrtrid,frm + DCD_WRTRIDOFFS + idx*sizeof(uint16_t),sizeof(uint16_t));
+        return ntohs(wrtrid);
+}
+
+/* checks the fixed header fields and the destination address, the index of the
+ * matching address is written to macidx */
+static enum dcderr_t dcdhdrs(const unsigned char *frm, char *mac_addrs[], int no_macs, int *macidx)
+{
+        uint64_t val[2];
+        uint64_t msk[2];
+        uint64_t dst;
+
+        memcpy(val,dcdhdrval,sizeof(val));
+        memcpy(msk,dcdhdrmsk,sizeof(msk));
+        if ((((ldu64(frm + DCD_HDROFFS) ^ val[0]) & msk[0]) | ((ldu64(frm + DCD_HDROFFS + 8) ^ val[1]) & msk[1])) != 0)
+                return DCD_HDR;         //fail
+
+        dst = ldmac(frm);
+        for (int i = 0; i < no_macs; i++) {
+                if (dst == ldmac(mac_addrs[i])) {
+                        *macidx = i;
+                        return DCD_OK;  //succeded
+                }
+        }
+        return DCD_MAC;         //fail
+}
+
+/* validates a control frame, msg points to its datasetmessage afterwards */
+static enum dcderr_t dcdcntrlhdrs(struct rt_pkt_t* pkt, char *mac_addrs[], int no_macs, const struct dtstmsg_cntrl_t **msg)
+{
+        const unsigned char *frm = pkt->sktbf;
+        enum dcderr_t err;
+        int macidx;
+
+        //a control frame is longer than the minimal frame length, so it is never padded
+        if (pkt->len != dcdmsgoffs(1) + sizeof(struct dtstmsg_cntrl_t))
+                return DCD_LEN;         //fail
+        err = dcdhdrs(frm,mac_addrs,no_macs,&macidx);
+        if (err != DCD_OK)
+                return err;             //fail
+        if (frm[DCD_MSGCNTOFFS] != 1)
+                return DCD_MSGCNT;      //fail
+        if (dcdwrtrid(frm,0) != WRITERID_CNTRL)
+                return DCD_WRTRID;      //fail
+        *msg = (const struct dtstmsg_cntrl_t*) (frm + dcdmsgoffs(1));
+        if (((*msg)->dtstmsg_hdr != 0x01) || ((*msg)->fldcnt != htons(11)))
+                return DCD_DTSTMSG;     //fail
+        return DCD_OK;          //succeded
+}
+
+/* copies the switches and states of a control datasetmessage to cntrlnfo */
+static void dcdcntrlsws(const struct dtstmsg_cntrl_t *msg, struct cntrlnfo_t *cntrlnfo)
+{
+        cntrlnfo->x_set.cntrlsw = (bool) msg->xenable;
+        cntrlnfo->y_set.cntrlsw = (bool) msg->yenable;
+        cntrlnfo->z_set.cntrlsw = (bool) msg->zenable;
+        cntrlnfo->s_set.cntrlsw = (bool) msg->spindleenable;
+        cntrlnfo->spindlebrake = (bool) msg->spindlebrake;
+        cntrlnfo->estopstatus = (bool) msg->estopstatus;
+        cntrlnfo->machinestatus = (bool) msg->machinestatus;
+}
+
+enum dcderr_t dcdcntrlfrm(struct rt_pkt_t* pkt, char *mac_addrs[], int no_macs, struct cntrlnfo_t *cntrlnfo)
+{
+        const struct dtstmsg_cntrl_t *msg;
+        enum dcderr_t err;
+        double vals[4];
+
+        err = dcdcntrlhdrs(pkt,mac_addrs,no_macs,&msg);
+        if (err != DCD_OK)
+                return err;             //fail
+        nbe642dbls((const char *) msg + offsetof(struct dtstmsg_cntrl_t,xvel_set),vals,4);
+        cntrlnfo->x_set.cntrlvl = vals[0];
+        cntrlnfo->y_set.cntrlvl = vals[1];
+        cntrlnfo->z_set.cntrlvl = vals[2];
+        cntrlnfo->s_set.cntrlvl = vals[3];
+        dcdcntrlsws(msg,cntrlnfo);
+        return DCD_OK;          //succeded
+}
+
+enum dcderr_t dcdcntrlfrmfxp(struct rt_pkt_t* pkt, char *mac_addrs[], int no_macs, struct cntrlnfo_t *cntrlnfo)
+{
+        const struct dtstmsg_cntrl_t *msg;
+        enum dcderr_t err;
+
+        err = dcdcntrlhdrs(pkt,mac_addrs,no_macs,&msg);
+        if (err != DCD_OK)
+                return err;             //fail
+        //set values stay in nano units, only the byte order changes
+        cntrlnfo->x_set.ncntrlvl = be64toh(msg->xvel_set);
+        cntrlnfo->y_set.ncntrlvl = be64toh(msg->yvel_set);
+        cntrlnfo->z_set.ncntrlvl = be64toh(msg->zvel_set);
+        cntrlnfo->s_set.ncntrlvl = be64toh(msg->spindlespeed);
+        dcdcntrlsws(msg,cntrlnfo);
+        return DCD_OK;          //succeded
+}
+
+enum dcderr_t dcdaxsfrm(struct rt_pkt_t* pkt, char *mac_addrs[], int no_macs, struct axsnfo_t axsnfos[], int *axscnt)
+{
+        const unsigned char *frm = pkt->sktbf;
+        const struct dtstmsg_axs_t *msg;
+        enum dcderr_t err;
+        int macidx;
+        int msgcnt;
+        uint32_t frmlen;
+        uint16_t sz;
+        int axs;
+        int64_t nvals[MAXDTSTMSGS];
+        double vals[MAXDTSTMSGS];
+
+        *axscnt = 0;
+        if (pkt->len < DCD_WRTRIDOFFS)
+                return DCD_LEN;         //fail, the compared headers must be in the frame
+        err = dcdhdrs(frm,mac_addrs,no_macs,&macidx);
+        if (err != DCD_OK)
+                return err;             //fail
+        msgcnt = frm[DCD_MSGCNTOFFS];
+        if ((msgcnt < 1) || (msgcnt > MAXDTSTMSGS))
+                return DCD_MSGCNT;      //fail
+        //short frames may be padded to the minimal frame length, not on lo, veth or AF_XDP
+        frmlen = dcdmsgoffs(msgcnt) + msgcnt*sizeof(struct dtstmsg_axs_t);
+        if ((pkt->len != frmlen) && ((pkt->len < frmlen) || (pkt->len != ETH_ZLEN)))
+                return DCD_LEN;         //fail
+        for (int i = 1; (msgcnt > 1) && (i <= msgcnt); i++) {
+                //size array follows the writer ids and the timestamp
+                memcpy(&sz,frm + dcdmsgoffs(msgcnt) - i*sizeof(uint16_t),sizeof(uint16_t));
+                if (sz != htons(sizeof(struct dtstmsg_axs_t)))
+                        return DCD_DTSTMSG;     //fail
+        }
+
+        msg = (const struct dtstmsg_axs_t*) (frm + dcdmsgoffs(msgcnt));
+        for (int i = 0; i < msgcnt; i++, msg++) {
+                if ((msg->dtstmsg_hdr != 0x01) || (msg->fldcnt != htons(2)))
+                        return DCD_DTSTMSG;     //fail
+                axs = wrtrid2axs(dcdwrtrid(frm,i));
+                if ((axs == -1) && (msgcnt == 1))
+                        axs = macidx;
+                if (axs == -1)
+                        return DCD_WRTRID;      //fail
+                axsnfos[i].axsID = axs;
+                axsnfos[i].cntrlsw = (bool) msg->fault;
+                nvals[i] = msg->pos_cur;
+        }
+        //convert the positions of all axes at once
+        nbe642dbls(nvals,vals,msgcnt);
+        for (int i = 0; i < msgcnt; i++)
+                axsnfos[i].cntrlvl = vals[i];
+        *axscnt = msgcnt;
+        return DCD_OK;          //succeded
+}
+
+const char* dcderrstr(enum dcderr_t err)
+{
+        switch(err){
+        case DCD_OK:
+                return "ok";
+        case DCD_LEN:
+                return "wrong frame length";
+        case DCD_HDR:
+                return "wrong ethertype or message headers";
+        case DCD_MAC:
+                return "wrong destination address";
+        case DCD_MSGCNT:
+                return "wrong message count";
+        case DCD_WRTRID:
+                return "unknown writer id";
+        case DCD_DTSTMSG:
+                return "wrong datasetmessage header or size";
+        default:
+                return "unknown error";
+        }
+}
+
+void dcdseqhdr(struct rt_pkt_t* pkt, uint16_t *pubid, uint16_t *seqno)
+{
+        uint16_t val;
+        memcpy(&val,pkt->sktbf + DCD_PUBIDOFFS,sizeof(uint16_t));
+        *pubid = ntohs(val);
+        memcpy(&val,pkt->sktbf + DCD_SEQNOOFFS,sizeof(uint16_t));
+        *seqno = ntohs(val);
+}
+
+
+/* ##### Sequence tracking ##### */
+
+void initseqtrck(struct seqtrck_t *trck)
+{
+        memset(trck,0,sizeof(struct seqtrck_t));
+}
+
+/* returns the entry of a writer, a new entry is added for an unknown writer */
+static struct seqwrtr_t* seqwrtr(struct seqtrck_t *trck, uint16_t pubid, uint16_t wrtrid, bool *isnew)
+{
+        *isnew = false;
+        for (int i = 0; i < trck->cnt; i++) {
+                if ((trck->wrtrs[i].pubid == pubid) && (trck->wrtrs[i].wrtrid == wrtrid))
+                        return &(trck->wrtrs[i]);
+        }
+        if (trck->cnt >= MAXSEQWRTRS)
+                return NULL;    //fail
+        *isnew = true;
+        trck->wrtrs[trck->cnt].pubid = pubid;
+        trck->wrtrs[trck->cnt].wrtrid = wrtrid;
+        return &(trck->wrtrs[trck->cnt++]);
+}
+
+/* (re)starts the tracking of a writer at seqno */
+static void seqstrt(struct seqwrtr_t *wrtr, uint16_t seqno)
+{
+        wrtr->lastseq = seqno;
+        wrtr->rcvdmsk = 1;
+        wrtr->trckd = 1;
+        wrtr->stlcnt = 0;
+}
+
+enum seqrslt_t trckseq(struct seqtrck_t *trck, uint16_t pubid, uint16_t wrtrid, uint16_t seqno)
+{
+        struct seqwrtr_t *wrtr;
+        bool isnew;
+        int16_t diff;
+        uint16_t back;
+
+        wrtr = seqwrtr(trck,pubid,wrtrid,&isnew);
+        if (wrtr == NULL) {
+                trck->untrckd++;
+                return SEQ_FULL;        //fail
+        }
+        wrtr->cntrs.rcvd++;
+        if (isnew) {
+                seqstrt(wrtr,seqno);
+                return SEQ_NEW;
+        }
+        //distance to the newest sequence number, wraps around after 65535
+        diff = (int16_t) (seqno - wrtr->lastseq);
+        if (diff > 0) {
+                wrtr->stlcnt = 0;
+                wrtr->lastseq = seqno;
+                wrtr->rcvdmsk = (diff < SEQWNDW) ? ((wrtr->rcvdmsk << diff) | 1) : 1;
+                wrtr->trckd = (wrtr->trckd + diff < SEQWNDW) ? wrtr->trckd + diff : SEQWNDW;
+                if (diff == 1)
+                        return SEQ_OK;
+                wrtr->cntrs.gaps++;
+                wrtr->cntrs.lost += diff - 1;
+                return SEQ_GAP;
+        }
+        back = (uint16_t) -diff;
+        if (back < wrtr->trckd) {
+                wrtr->stlcnt = 0;
+                if (wrtr->rcvdmsk & (1ULL << back)) {
+                        wrtr->cntrs.dups++;
+                        return SEQ_DUP;
+                }
+                //counted as lost when the gap was detected
+                wrtr->rcvdmsk |= 1ULL << back;
+                wrtr->cntrs.lost--;
+                wrtr->cntrs.reord++;
+                return SEQ_REORD;
+        }
+        wrtr->stlcnt++;
+        if (wrtr->stlcnt >= SEQRSYNC) {
+                //publisher was restarted, continue with its new sequence numbers
+                wrtr->cntrs.rsyncs++;
+                seqstrt(wrtr,seqno);
+                return SEQ_NEW;
+        }
+        wrtr->cntrs.stale++;
+        return SEQ_STALE;
+}
+
+bool seqisold(enum seqrslt_t rslt)
+{
+        return (rslt == SEQ_DUP) || (rslt == SEQ_REORD) || (rslt == SEQ_STALE);
+}
+
+int getseqcntrs(struct seqtrck_t *trck, uint16_t pubid, uint16_t wrtrid, struct seqcntrs_t *cntrs)
+{
+        for (int i = 0; i < trck->cnt; i++) {
+                if ((trck->wrtrs[i].pubid == pubid) && (trck->wrtrs[i].wrtrid == wrtrid)) {
+                        *cntrs = trck->wrtrs[i].cntrs;
+                        return 0;       //succeded
+                }
+        }
+        return 1;       //fail
+}
+
+void prtseqcntrs(struct seqtrck_t *trck)
+{
+        struct seqcntrs_t *cntrs;
+        for (int i = 0; i < trck->cnt; i++) {
+                cntrs = &(trck->wrtrs[i].cntrs);
+                printf("Publisher 0x%04X writer 0x%04X: %llu received, %llu lost in %llu gaps, %llu duplicates, "
+                       "%llu reordered, %llu stale, %llu resynchronizations\n",
+                       trck->wrtrs[i].pubid, trck->wrtrs[i].wrtrid, (unsigned long long) cntrs->rcvd,
+                       (unsigned long long) cntrs->lost, (unsigned long long) cntrs->gaps,
+                       (unsigned long long) cntrs->dups, (unsigned long long) cntrs->reord,
+                       (unsigned long long) cntrs->stale, (unsigned long long) cntrs->rsyncs);
+        }
+        if (trck->untrckd > 0)
+                printf("%llu frames of further writers not tracked\n", (unsigned long long) trck->untrckd);
+}
+
+/* ##### END Sequence tracking ##### */
+
+
+/* ##### Frame templates ##### */
+
+int inittmplt(struct frmtmplt_t *tmplt, int msgcnt, enum msgtyp_t msgtyp, uint16_t pubid, struct sockaddr_ll *addr)
+{
+        struct cmsghdr *cmsg;
+        if ((NULL == tmplt) || (NULL == addr))
+                return 1;       //fail
+        memset(tmplt,0,sizeof(struct frmtmplt_t));
+        if (createpkt(&(tmplt->pkt)) != 0)
+                return 1;       //fail
+        if (setpkt(tmplt->pkt,msgcnt,msgtyp,pubid) != 0) {
+                destroytmplt(tmplt);
+                return 1;       //fail
+        }
+        memcpy(&(tmplt->addr),addr,sizeof(struct sockaddr_ll));
+
+        tmplt->msg_iov.iov_base = tmplt->pkt->sktbf;
+        tmplt->msg_iov.iov_len = tmplt->pkt->len;
+        tmplt->msg_hdr.msg_name = &(tmplt->addr);
+        tmplt->msg_hdr.msg_namelen = sizeof(struct sockaddr_ll);
+        tmplt->msg_hdr.msg_iov = &(tmplt->msg_iov);
+        tmplt->msg_hdr.msg_iovlen = 1;
+        tmplt->msg_hdr.msg_control = tmplt->cntlmsg.buf;
+        tmplt->msg_hdr.msg_controllen = sizeof(tmplt->cntlmsg.buf);
+
+        cmsg = CMSG_FIRSTHDR(&(tmplt->msg_hdr));
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_TXTIME;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+        tmplt->txtm = (uint64_t *) CMSG_DATA(cmsg);
+        *(tmplt->txtm) = 0;
+
+        return 0;       //succeded
+}
+
+void destroytmplt(struct frmtmplt_t *tmplt)
+{
+        if ((NULL == tmplt) || (NULL == tmplt->pkt))
+                return;
+        destroypkt(tmplt->pkt);
+        tmplt->pkt = NULL;
+        tmplt->txtm = NULL;
+}
+
+int sendtmplt(int fd, struct frmtmplt_t *tmplt, uint64_t txtime)
+{
+        int sndcnt;
+        *(tmplt->txtm) = txtime;
+        sndcnt = sendmsg(fd,&(tmplt->msg_hdr),0);
+        if (sndcnt < 0) {
+                rtlog(LOG_SNDFAIL,NULL,errno,0,0);
+                return 1;       //fail
+        }
+        captx(&(tmplt->addr),tmplt->pkt->sktbf,tmplt->pkt->len,txtime);
+        return 0;
+}
+
+int sendtmplts(int fd, struct frmtmplt_t *tmplts[], const uint64_t txtimes[], int cnt, int errs[])
+{
+        struct mmsghdr msgs[MAXSNDBATCH];
+        int sndcnt;
+        int sent = 0;
+        int i;
+        if ((cnt < 0) || (cnt > MAXSNDBATCH))
+                return -1;      //fail
+
+        for (i = 0; i < cnt; i++) {
+                *(tmplts[i]->txtm) = txtimes[i];
+                msgs[i].msg_hdr = tmplts[i]->msg_hdr;
+                msgs[i].msg_len = 0;
+        }
+
+        i = 0;
+        while (i < cnt) {
+                sndcnt = sendmmsg(fd,&(msgs[i]),cnt-i,0);
+                if (sndcnt <= 0) {
+                        //first of the remaining frames failed, continue with next frame
+                        errs[i] = (sndcnt < 0) ? errno : EAGAIN;
+                        rtlog(LOG_SNDMFAIL,NULL,i,errs[i],0);
+                        i++;
+                        continue;
+                }
+                for (int j = 0; j < sndcnt; j++) {
+                        errs[i+j] = 0;
+                        captx(&(tmplts[i+j]->addr),tmplts[i+j]->pkt->sktbf,tmplts[i+j]->pkt->len,txtimes[i+j]);
+                }
+                sent += sndcnt;
+                i += sndcnt;
+        }
+        return sent;
+}
+
+/* ##### END Frame templates ##### */
+
+
+/* ##### RX ring ##### */
+
+static struct tpacket2_hdr *ringfrm(struct rxring_t *ring, uint32_t idx)
+{
+        return (struct tpacket2_hdr *) (ring->map + (size_t) idx*RXRING_FRMSZ);
+}
+
+int opnrxring(struct rxring_t *ring, int fd)
+{
+        int ver = TPACKET_V2;
+        struct tpacket_req req;
+        memset(ring,0,sizeof(struct rxring_t));
+
+        if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &ver, sizeof(ver)) < 0) {
+                printf("Setting of TPACKET version failed. Error: %d\n",errno);
+                return 1;       //fail
+        }
+        memset(&req,0,sizeof(struct tpacket_req));
+        req.tp_frame_size = RXRING_FRMSZ;
+        req.tp_frame_nr = RXRING_FRMCNT;
+        req.tp_block_size = RXRING_BLKSZ;
+        req.tp_block_nr = (RXRING_FRMCNT*RXRING_FRMSZ)/RXRING_BLKSZ;
+        if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+                printf("Setting up RX ring failed. Error: %d\n",errno);
+                return 1;       //fail
+        }
+
+        ring->mapsz = (size_t) req.tp_block_nr*req.tp_block_size;
+        ring->map = mmap(NULL, ring->mapsz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, fd, 0);
+        if (MAP_FAILED == ring->map) {
+                printf("Mapping of RX ring failed. Error: %d\n",errno);
+                ring->map = NULL;
+                return 1;       //fail
+        }
+        ring->frmcnt = RXRING_FRMCNT;
+        return 0;       //succeded
+}
+
+void clsrxring(struct rxring_t *ring)
+{
+        if (NULL != ring->map)
+                munmap(ring->map, ring->mapsz);
+        ring->map = NULL;
+        ring->mapsz = 0;
+}
+
+int rcvringpkt(struct rxring_t *ring, struct rt_pkt_t *pkt, struct timespec *rxtm)
+{
+        struct tpacket2_hdr *frm;
+        while (true) {
+                //all frame slots are read, but not released yet
+                if (ring->rdcnt == ring->frmcnt)
+                        return -1;
+                frm = ringfrm(ring, ring->curfrm);
+                if (!(__atomic_load_n(&(frm->tp_status), __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+                        return -1;      //no frame ready
+                ring->curfrm = (ring->curfrm + 1) % ring->frmcnt;
+                ring->rdcnt++;
+                //only frames which are not truncated are forwarded
+                if (frm->tp_snaplen < frm->tp_len)
+                        continue;
+
+                memset(pkt,0,sizeof(struct rt_pkt_t));
+                pkt->sktbf = (unsigned char *) frm + frm->tp_mac;
+                pkt->len = frm->tp_snaplen;
+                pkt->stridx = PKTSTRG_NIL;
+                if (NULL != rxtm) {
+                        rxtm->tv_sec = frm->tp_sec;
+                        rxtm->tv_nsec = frm->tp_nsec;
+                }
+                pkt->rxtmstmp = (uint64_t) frm->tp_sec*1000000000 + frm->tp_nsec;
+                pkt->rxhw = (frm->tp_status & TP_STATUS_TS_RAW_HARDWARE) != 0;
+                caprx(pkt->sktbf,pkt->len,pkt->rxtmstmp,pkt->rxhw);
+                return 0;       //succeded
+        }
+}
+
+void rlsringpkts(struct rxring_t *ring)
+{
+        uint32_t idx;
+        idx = (ring->curfrm + ring->frmcnt - ring->rdcnt) % ring->frmcnt;
+        while (ring->rdcnt > 0) {
+                __atomic_store_n(&(ringfrm(ring, idx)->tp_status), TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+                idx = (idx + 1) % ring->frmcnt;
+                ring->rdcnt--;
+        }
+}
+
+/* ##### END RX ring ##### */
+
+
+/* ##### Receive wait ##### */
+
+static int64_t rcvwtclk(clockid_t clk)
+{
+        struct timespec tm;
+        clock_gettime(clk,&tm);
+        return cnvrt_tmspc2int64(&tm);
+}
+
+int initrcvwt(struct rcvwt_t *wt, enum rcvwtmd_t md, int fd, int64_t grd)
+{
+        int val;
+        memset(wt,0,sizeof(struct rcvwt_t));
+        wt->md = md;
+        wt->grd = grd;
+        wt->fds[0].fd = fd;
+        wt->fds[0].events = POLLIN;
+        if (md == RCVWT_PPOLL)
+                return 0;       //succeded
+
+        val = RCVWT_BSYPLL;
+        if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof(val)) < 0) {
+                printf("Setting busy polling of the socket failed. Error: %d\n",errno);
+                return 1;       //fail
+        }
+        //older kernels only busy poll without deferring the interrupts of the device
+        val = 1;
+        if (setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &val, sizeof(val)) < 0)
+                printf("Preferring busy polling is not supported. Error: %d\n",errno);
+        val = RCVWT_BSYBDGT;
+        if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL_BUDGET, &val, sizeof(val)) < 0)
+                printf("Setting the budget of busy polling is not supported. Error: %d\n",errno);
+        return 0;       //succeded
+}
+
+int rcvwt(struct rcvwt_t *wt, const struct timespec *dln)
+{
+        struct timespec tmout;
+        int64_t strt;
+        int64_t cpustrt;
+        int64_t now;
+        int64_t end;
+        int64_t slp;
+        int ok = 0;
+
+        cpustrt = rcvwtclk(CLOCK_THREAD_CPUTIME_ID);
+        strt = rcvwtclk(CLOCK_TAI);
+        now = strt;
+        end = cnvrt_tmspc2int64((struct timespec *) dln);
+
+        //sleep till the deadline, in the hybrid mode till the guard before it
+        if (wt->md != RCVWT_BUSY) {
+                slp = (wt->md == RCVWT_HYBRID) ? end - wt->grd : end;
+                cnvrt_int642tmspc((slp > now) ? slp - now : 0,&tmout);
+                ok = ppoll(wt->fds,1,&tmout,NULL);
+                now = rcvwtclk(CLOCK_TAI);
+        }
+        //spin till the deadline, the socket busy polls the device queue
+        if ((ok == 0) && (wt->md != RCVWT_PPOLL)) {
+                do {
+                        ok = poll(wt->fds,1,0);
+                        now = rcvwtclk(CLOCK_TAI);
+                } while ((ok == 0) && (now < end));
+        }
+
+        __atomic_store_n(&(wt->wts),wt->wts + 1,__ATOMIC_RELAXED);
+        if (ok > 0)
+                __atomic_store_n(&(wt->rdys),wt->rdys + 1,__ATOMIC_RELAXED);
+        __atomic_store_n(&(wt->wttm),wt->wttm + (now - strt),__ATOMIC_RELAXED);
+        if ((uint64_t) (now - strt) > wt->maxwttm)
+                __atomic_store_n(&(wt->maxwttm),now - strt,__ATOMIC_RELAXED);
+        __atomic_store_n(&(wt->cputm),wt->cputm + (rcvwtclk(CLOCK_THREAD_CPUTIME_ID) - cpustrt),__ATOMIC_RELAXED);
+
+        if (ok < 0)
+                return -1;      //fail
+        return (ok > 0) ? 1 : 0;
+}
+
+const char *rcvwtmdstr(enum rcvwtmd_t md)
+{
+        switch(md){
+        case RCVWT_PPOLL:
+                return "ppoll";
+        case RCVWT_BUSY:
+                return "busy polling";
+        case RCVWT_HYBRID:
+                return "hybrid";
+        default:
+                return "unknown";
+        }
+}
+
+void prtrcvwt(const char *name, const struct rcvwt_t *wt)
+{
+        uint64_t wts;
+        uint64_t wttm;
+        uint64_t cputm;
+
+        wts = __atomic_load_n(&(wt->wts),__ATOMIC_RELAXED);
+        if (wts == 0) {
+                printf("%s (%s): no waits\n", name, rcvwtmdstr(wt->md));
+                return;
+        }
+        wttm = __atomic_load_n(&(wt->wttm),__ATOMIC_RELAXED);
+        cputm = __atomic_load_n(&(wt->cputm),__ATOMIC_RELAXED);
+        printf("%s (%s): %llu waits, %llu with a frame, waited avg %llu ns, max %llu ns, CPU time avg %llu ns (%.1f%% of the time waited)\n",
+               name, rcvwtmdstr(wt->md), (unsigned long long) wts,
+               (unsigned long long) __atomic_load_n(&(wt->rdys),__ATOMIC_RELAXED),
+               (unsigned long long) (wttm/wts),
+               (unsigned long long) __atomic_load_n(&(wt->maxwttm),__ATOMIC_RELAXED),
+               (unsigned long long) (cputm/wts), (wttm > 0) ? 100.0*cputm/wttm : 0.0);
+}
+
+/* ##### END Receive wait ##### */
+
+
+/* ##### Timestamping ##### */
+
+/* enables hardware timestamps of the interface if it supports them, an
+ * existing configuration (e.g. of ptp4l) is kept */
+static bool enblhwtmstmp(int fd, char *ifnm, int flags)
+{
+        struct ifreq ifr;
+        struct hwtstamp_config cnfg;
+
+        memset(&ifr,0,sizeof(struct ifreq));
+        memset(&cnfg,0,sizeof(struct hwtstamp_config));
+        strncpy(ifr.ifr_name, ifnm, IFNAMSIZ - 1);
+        ifr.ifr_data = (void *) &cnfg;
+        if (ioctl(fd, SIOCGHWTSTAMP, &ifr) == 0) {
+                if ((!(flags & TMSTMP_TX) || (cnfg.tx_type == HWTSTAMP_TX_ON)) &&
+                    (!(flags & TMSTMP_RX) || (cnfg.rx_filter == HWTSTAMP_FILTER_ALL)))
+                        return true;
+        }
+        cnfg.flags = 0;
+        if (flags & TMSTMP_TX)
+                cnfg.tx_type = HWTSTAMP_TX_ON;
+        if (flags & TMSTMP_RX)
+                cnfg.rx_filter = HWTSTAMP_FILTER_ALL;
+        return (ioctl(fd, SIOCSHWTSTAMP, &ifr) == 0);
+}
+
+int enbltmstmp(struct tmstmpr_t *tsr, int fd, char *ifnm, int flags)
+{
+        int tsflgs = SOF_TIMESTAMPING_SOFTWARE;
+        struct timespec tai;
+        struct timespec rltm;
+        bool hw;
+
+        if (NULL == ifnm)
+                return 1;       //fail
+        hw = enblhwtmstmp(fd, ifnm, flags);
+        if (hw)
+                tsflgs |= SOF_TIMESTAMPING_RAW_HARDWARE;
+        if (flags & TMSTMP_RX) {
+                tsflgs |= SOF_TIMESTAMPING_RX_SOFTWARE;
+                if (hw)
+                        tsflgs |= SOF_TIMESTAMPING_RX_HARDWARE;
+        }
+        if (flags & TMSTMP_TX) {
+                //only the timestamp and the id of the frame are queued, not the frame
+                tsflgs |= SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+                if (hw)
+                        tsflgs |= SOF_TIMESTAMPING_TX_HARDWARE;
+        }
+        if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &tsflgs, sizeof(tsflgs)) < 0) {
+                printf("Setting of socket option SO_TIMESTAMPING failed. Error: %d \n",errno);
+                return 1;       //fail
+        }
+        //timestamps of the receive ring
+        if (hw && (flags & TMSTMP_RX)) {
+                tsflgs = SOF_TIMESTAMPING_RAW_HARDWARE;
+                setsockopt(fd, SOL_PACKET, PACKET_TIMESTAMP, &tsflgs, sizeof(tsflgs));
+        }
+
+        if (flags & TMSTMP_TX) {
+                memset(tsr->plnd,0,sizeof(tsr->plnd));
+                tsr->txfd = fd;
+                tsr->nxtid = 0;
+        }
+        if (tsr->flags == 0)
+                tsr->hw = hw;
+        else
+                tsr->hw = tsr->hw && hw;
+        tsr->flags |= flags;
+        clock_gettime(CLOCK_TAI,&tai);
+        clock_gettime(CLOCK_REALTIME,&rltm);
+        //offset is a whole number of seconds
+        tsr->taioffs = ((int64_t) tai.tv_sec - rltm.tv_sec)*1000000000;
+        if ((tai.tv_nsec - rltm.tv_nsec) < -500000000)
+                tsr->taioffs -= 1000000000;
+        return 0;       //succeded
+}
+
+int rcvetfdrps(int fd)
+{
+        struct msghdr msg_hdr;
+        struct cmsghdr *cmsg;
+        union {
+                char buf[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_ll))];
+                struct cmsghdr align;
+        } cntlmsg;
+        struct sock_extended_err serr;
+        int drps = 0;
+
+        while (true) {
+                memset(&msg_hdr,0,sizeof(struct msghdr));
+                msg_hdr.msg_control = cntlmsg.buf;
+                msg_hdr.msg_controllen = sizeof(cntlmsg.buf);
+                if (recvmsg(fd, &msg_hdr, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+                        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                                break;  //error queue is empty
+                        return -1;      //fail
+                }
+                for (cmsg = CMSG_FIRSTHDR(&msg_hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg_hdr, cmsg)) {
+                        if ((cmsg->cmsg_level != SOL_PACKET) || (cmsg->cmsg_type != PACKET_TX_TIMESTAMP))
+                                continue;
+                        memcpy(&serr,CMSG_DATA(cmsg),sizeof(struct sock_extended_err));
+                        if (serr.ee_origin == SO_EE_ORIGIN_TXTIME)
+                                drps++;
+                }
+        }
+        return drps;
+}
+
+void rgsttx(struct tmstmpr_t *tsr, uint64_t sndtm, uint64_t txtime, uint64_t cycl)
+{
+        struct txplnd_t *plnd;
+        if (!(tsr->flags & TMSTMP_TX))
+                return;
+        plnd = &(tsr->plnd[tsr->nxtid % TXTMSTMPSZ]);
+        plnd->id = tsr->nxtid;
+        plnd->vld = true;
+        plnd->cycl = cycl;
+        plnd->txtime = txtime;
+        plnd->sndtm = sndtm;
+        tsr->nxtid++;
+}
+
+uint64_t tmstmp2tai(struct tmstmpr_t *tsr, uint64_t tmstmp, bool hw)
+{
+        if (hw)
+                return tmstmp;
+        return tmstmp + tsr->taioffs;
+}
+
+int rcvtxtmstmps(struct tmstmpr_t *tsr, struct txtmstmp_t res[], int cnt)
+{
+        struct msghdr msg_hdr;
+        struct cmsghdr *cmsg;
+        union {
+                char buf[CMSG_SPACE(sizeof(struct scm_timestamping)) + CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_ll))];
+                struct cmsghdr align;
+        } cntlmsg;
+        struct scm_timestamping tss;
+        struct sock_extended_err serr;
+        struct txplnd_t *plnd;
+        bool hastss;
+        bool hasid;
+        int mtchd = 0;
+
+        if (!(tsr->flags & TMSTMP_TX))
+                return -1;      //fail
+        while (mtchd < cnt) {
+                memset(&msg_hdr,0,sizeof(struct msghdr));
+                msg_hdr.msg_control = cntlmsg.buf;
+                msg_hdr.msg_controllen = sizeof(cntlmsg.buf);
+                if (recvmsg(tsr->txfd, &msg_hdr, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+                        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                                break;  //error queue is empty
+                        return -1;      //fail
+                }
+                hastss = false;
+                hasid = false;
+                serr.ee_origin = 0;
+                for (cmsg = CMSG_FIRSTHDR(&msg_hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg_hdr, cmsg)) {
+                        if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SO_TIMESTAMPING)) {
+                                memcpy(&tss,CMSG_DATA(cmsg),sizeof(struct scm_timestamping));
+                                hastss = true;
+                        } else if ((cmsg->cmsg_level == SOL_PACKET) && (cmsg->cmsg_type == PACKET_TX_TIMESTAMP)) {
+                                memcpy(&serr,CMSG_DATA(cmsg),sizeof(struct sock_extended_err));
+                                hasid = (serr.ee_errno == ENOMSG) && (serr.ee_origin == SO_EE_ORIGIN_TIMESTAMPING);
+                        }
+                }
+                if (serr.ee_origin == SO_EE_ORIGIN_TXTIME) {
+                        //frame dropped by the qdisc, TxTime missed or invalid
+                        tsr->etfdrps++;
+                        continue;
+                }
+                if (!hastss || !hasid) {
+                        tsr->txerrs++;
+                        continue;
+                }
+                plnd = &(tsr->plnd[serr.ee_data % TXTMSTMPSZ]);
+                if (!plnd->vld || (plnd->id != serr.ee_data)) {
+                        tsr->unmtchd++;
+                        continue;
+                }
+                plnd->vld = false;
+                res[mtchd].cycl = plnd->cycl;
+                res[mtchd].txtime = plnd->txtime;
+                res[mtchd].sndtm = plnd->sndtm;
+                res[mtchd].hw = (tss.ts[2].tv_sec != 0) || (tss.ts[2].tv_nsec != 0);
+                if (res[mtchd].hw)
+                        res[mtchd].tmstmp = cnvrt_tmspc2int64(&(tss.ts[2]));
+                else
+                        res[mtchd].tmstmp = cnvrt_tmspc2int64(&(tss.ts[0])) + tsr->taioffs;
+                mtchd++;
+        }
+        return mtchd;
+}
+
+void updtltncy(struct ltncystats_t *stats, int64_t ltncy)
+{
+        if ((stats->cnt == 0) || (ltncy < stats->min))
+                stats->min = ltncy;
+        if ((stats->cnt == 0) || (ltncy > stats->max))
+                stats->max = ltncy;
+        stats->sum += ltncy;
+        stats->cnt++;
+}
+
+void prtltncy(const char *name, struct ltncystats_t *stats)
+{
+        if (stats->cnt == 0) {
+                printf("%s: no values\n", name);
+                return;
+        }
+        printf("%s: %llu values, min %lld ns, avg %lld ns, max %lld ns\n", name, (unsigned long long) stats->cnt,
+               (long long) stats->min, (long long) (stats->sum/(int64_t) stats->cnt), (long long) stats->max);
+}
+
+/* ##### END Timestamping ##### */
+
+
 /* ##### PacketStore ##### */
 
+/* push element to free-list */
+static void pshfrelmt(struct pktstore_t *pktstore, uint32_t idx)
+{
+        uint64_t hd;
+        uint64_t newhd;
+        hd = atomic_load_explicit(&(pktstore->frhd), memory_order_relaxed);
+        do {
+                atomic_store_explicit(&(pktstore->pktstrelmt[idx].nxt), (uint32_t) hd, memory_order_relaxed);
+                newhd = (((hd >> 32) + 1) << 32) | idx;
+        } while (!atomic_compare_exchange_weak_explicit(&(pktstore->frhd), &hd, newhd, memory_order_release, memory_order_relaxed));
+}
+
+/* pop element from free-list, returns PKTSTRG_NIL if list is empty */
+static uint32_t popfrelmt(struct pktstore_t *pktstore)
+{
+        uint64_t hd;
+        uint64_t newhd;
+        uint32_t idx;
+        uint32_t nxt;
+        hd = atomic_load_explicit(&(pktstore->frhd), memory_order_acquire);
+        do {
+                idx = (uint32_t) hd;
+                if (PKTSTRG_NIL == idx)
+                        return PKTSTRG_NIL;     //empty
+                nxt = atomic_load_explicit(&(pktstore->pktstrelmt[idx].nxt), memory_order_relaxed);
+                newhd = (((hd >> 32) + 1) << 32) | nxt;
+        } while (!atomic_compare_exchange_weak_explicit(&(pktstore->frhd), &hd, newhd, memory_order_acquire, memory_order_acquire));
+        return idx;
+}
+
 int initpktstrg(struct pktstore_t *pktstore, uint32_t size)
 {
         if(NULL == pktstore)
                 return 1;       //fail
-        int i = 0;
+        uint32_t i = 0;
         int ok;
         struct rt_pkt_t *pkt;
-        pktstore->size = size;
+        pktstore->size = 0;
+        atomic_init(&(pktstore->frhd), PKTSTRG_NIL);
+        for (i = 0; i < PKTSTRG_MAXOWNRS; i++)
+                atomic_init(&(pktstore->ownd[i]), 0);
+        if (size >= PKTSTRG_NIL)
+                return 1;       //fail
         pktstore->pktstrelmt = (struct pktstrelmt_t*) calloc(size,sizeof(struct pktstrelmt_t));
-        if (NULL == pktstore->pktstrelmt){
-                pktstore->size = 0;
+        if (NULL == pktstore->pktstrelmt)
                 return 1;       //fail
-        }
-        while(i < pktstore->size) {
+        i = 0;
+        while(i < size) {
                 pkt = NULL;
                 ok = createpkt(&pkt);
-                if( ok != 0){
-                        pktstore->size = i;
+                if( ok != 0)
                         return 1;       //fail
-                }
+                pkt->stridx = i;
                 pktstore->pktstrelmt[i].pkt = pkt;
-                pktstore->pktstrelmt[i].used = false;
+                atomic_init(&(pktstore->pktstrelmt[i].used), false);
+                atomic_init(&(pktstore->pktstrelmt[i].ownr), -1);
+                pktstore->size = i + 1;
+                pshfrelmt(pktstore, i);
                 i++;
         }
 
@@ -527,49 +1785,71 @@ int destroypktstrg(struct pktstore_t  *pktstore)
                 i++;
         }
         pktstore->size = 0;
+        atomic_store(&(pktstore->frhd), PKTSTRG_NIL);
         free(pktstore->pktstrelmt);
         pktstore->pktstrelmt = NULL;
         return 0;
 }
 
-int getfreepkt(struct pktstore_t *pktstore, struct rt_pkt_t** pkt)
+int getfreepkt(struct pktstore_t *pktstore, struct rt_pkt_t** pkt, int ownr)
 {
-        if(NULL == pktstore)
+        uint32_t idx;
+        if((NULL == pktstore) || (NULL == pkt))
                 return 1;       //fail
         *pkt = NULL;
-        int i = 0;
-        while(i < pktstore->size) {
-                if(pktstore->pktstrelmt[i].used == false){
-                        *pkt = pktstore->pktstrelmt[i].pkt;
-                        pktstore->pktstrelmt[i].used = true;
-                        i = pktstore->size;
-                } else {
-                        i++;
-                }
-                
-        }
-        if(NULL == *pkt)
+        if((ownr < 0) || (ownr >= PKTSTRG_MAXOWNRS))
                 return 1;       //fail
+        idx = popfrelmt(pktstore);
+        if(PKTSTRG_NIL == idx)
+                return 1;       //fail, no free packet
+        atomic_store_explicit(&(pktstore->pktstrelmt[idx].ownr), ownr, memory_order_relaxed);
+        atomic_store_explicit(&(pktstore->pktstrelmt[idx].used), true, memory_order_relaxed);
+        atomic_fetch_add_explicit(&(pktstore->ownd[ownr]), 1, memory_order_relaxed);
+        *pkt = pktstore->pktstrelmt[idx].pkt;
         return 0;       //succeded
 }
 
 int retusedpkt(struct pktstore_t *pktstore, struct rt_pkt_t** pkt)
 {
-        if((NULL == pktstore) || (NULL == pkt))
-                return 1;       //fail
-        int i = 0;
-        while(i < pktstore->size) {
-                if(pktstore->pktstrelmt[i].pkt == *pkt){
-                        pktstore->pktstrelmt[i].used = false;
-                        i = pktstore->size;
-                        *pkt = NULL;
-                } else {
-                        i++;
-                }
-        }
-        if(NULL != *pkt)
+        uint32_t idx;
+        int ownr;
+        if((NULL == pktstore) || (NULL == pkt) || (NULL == *pkt))
                 return 1;       //fail
+        idx = (*pkt)->stridx;
+        if((idx >= pktstore->size) || (pktstore->pktstrelmt[idx].pkt != *pkt))
+                return 1;       //fail, packet not from this store
+        //only the first return of a packet is valid
+        if(!atomic_exchange_explicit(&(pktstore->pktstrelmt[idx].used), false, memory_order_relaxed))
+                return 1;       //fail, packet was not used
+        ownr = atomic_exchange_explicit(&(pktstore->pktstrelmt[idx].ownr), -1, memory_order_relaxed);
+        if((ownr >= 0) && (ownr < PKTSTRG_MAXOWNRS))
+                atomic_fetch_sub_explicit(&(pktstore->ownd[ownr]), 1, memory_order_relaxed);
+        pshfrelmt(pktstore, idx);
+        *pkt = NULL;
         return 0;       //succeded
 }
 
+int cntownpkts(struct pktstore_t *pktstore, int ownr)
+{
+        if((NULL == pktstore) || (ownr < 0) || (ownr >= PKTSTRG_MAXOWNRS))
+                return -1;      //fail
+        return atomic_load_explicit(&(pktstore->ownd[ownr]), memory_order_relaxed);
+}
+
+int rclmownpkts(struct pktstore_t *pktstore, int ownr)
+{
+        int rclmd = 0;
+        struct rt_pkt_t *pkt;
+        if((NULL == pktstore) || (ownr < 0) || (ownr >= PKTSTRG_MAXOWNRS))
+                return 0;
+        for (uint32_t i = 0; i < pktstore->size; i++) {
+                if (atomic_load_explicit(&(pktstore->pktstrelmt[i].ownr), memory_order_relaxed) != ownr)
+                        continue;
+                pkt = pktstore->pktstrelmt[i].pkt;
+                if (retusedpkt(pktstore, &pkt) == 0)
+                        rclmd++;
+        }
+        return rclmd;
+}
+
 /* ##### END PacketStore ##### */
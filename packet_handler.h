@@ -25,6 +25,8 @@
 #include <linux/if_packet.h>
 #include <sys/ioctl.h>
 #include <time.h>
+#include <poll.h>
+#include <stdatomic.h>
 #include "datastructs.h"
 #include "time_calc.h"
 
@@ -48,6 +50,9 @@
 #define ETHERTYPE 0xB62C        //Ethertype for OPC UA UADP NetworkMessages over Ethernet II
 
 #define MAXPKTSZ 1500 
+#define MAXSNDBATCH 8           //maximum number of frames sent with a single system call
+#define MAXRCVBATCH 8           //maximum number of frames received with a single system call
+#define MAXDTSTMSGS 4           //maximum number of datasetmessages in a packet
 
 /* static defines */
 #define DBLOVERFLOW INT64_MAX*1e-9
@@ -132,6 +137,9 @@ struct rt_pkt_t {
         struct szrry_t *szrry;
         union dtstmsg_t *dtstmsg;
         uint32_t len;
+        uint32_t stridx;        //index of packet in packetstore, PKTSTRG_NIL if not from a store
+        uint64_t rxtmstmp;      //RX timestamp in ns (hardware clock or CLOCK_REALTIME), 0 if none
+        bool rxhw;              //RX timestamp is taken by the hardware
 };
 
 /* Enum for Type of the DataSetMessage */
@@ -163,6 +171,20 @@ int fillcntrlpkt(struct rt_pkt_t* pkt, struct cntrlnfo_t* cntrlnfo, uint16_t seq
  * correct number of message (1)*/
 int fillaxspkt(struct rt_pkt_t* pkt, struct axsnfo_t* axsnfo, uint16_t seqno);
 
+/* fill packet with information from cnt axes, one datasetmessage per axis with the
+ * writer id of the axis, packet must already have the correct number of messages (cnt)*/
+int fillaxspkts(struct rt_pkt_t* pkt, struct axsnfo_t axsnfos[], int cnt, uint16_t seqno);
+
+/* as fillaxspkts, but the positions are taken unchanged from ncntrlvl (nano units,
+ * fixed-point mode) */
+int fillaxspktsfxp(struct rt_pkt_t* pkt, struct axsnfo_t axsnfos[], int cnt, uint16_t seqno);
+
+/* maps an axis to the writer id of its datasetmessage */
+uint16_t axs2wrtrid(enum axsID_t axsID);
+
+/* maps a writer id to an axis, returns -1 for unknown writer ids */
+int wrtrid2axs(uint16_t wrtrid);
+
 /* converts double to int64 by changing the unit to nano units
  * e.g. multiplying by 10^9, keeping the sign */
 int dbl2nint64(double val, int64_t *res);
@@ -171,13 +193,41 @@ int dbl2nint64(double val, int64_t *res);
  * e.g. multiplying by 10^-9, keeping the sign */
 double nint642dbl(int64_t val);
 
+/* Instruction set of the batch conversion */
+enum cnvrtisa_t {
+        CNVRT_SCALAR,
+        CNVRT_SSE41,
+        CNVRT_AVX2,
+};
+
+/* converts cnt doubles to big endian int64 in nano units (like dbl2nint64 and
+ * htobe64), res may be unaligned e.g. the fields of a datasetmessage.
+ * Values out of range are written as 0, returns 1 if at least one value was out of range */
+int dbls2nbe64(const double vals[], void *res, int cnt);
+
+/* converts cnt big endian int64 in nano units to doubles (like be64toh and
+ * nint642dbl), vals may be unaligned */
+void nbe642dbls(const void *vals, double res[], int cnt);
+
+/* selects the instruction set of the batch conversion, by default the best
+ * supported one is detected. Returns 1 if the cpu does not support it */
+int setcnvrtisa(enum cnvrtisa_t isa);
+
+/* returns the instruction set used by the batch conversion */
+enum cnvrtisa_t getcnvrtisa(void);
+
 /* fills the LinkLayer(Ethernet)-Address structure */
 int fillethaddr(struct sockaddr_ll *addr, uint8_t *mac_addr, uint16_t ethtyp, int fd, char *ifnm);
 
 /* sends the packet with the specified txtime and other values */
 int sendpkt(int fd, void *buf, int buflen, struct sockaddr_ll *addr,uint64_t txtime, clockid_t clkid);
 
+#define RXFLTR_MAXMACS 4        //maximum number of receive addresses of a socket
+#define RXFLTR_MAXLEN (12 + 4*RXFLTR_MAXMACS)   //maximum number of instructions of the receive filter
+
 /* open receive socket as a RAW-packet socket with with AF_PACKET. 
+ * Attach a socket filter which only passes frames for the specified addresses with
+ * the configured writer group and group version (RXFLTR_MAXMACS addresses at most).
  * Activate reception of Ethernet-Multicast-packets for specifies addresses
  * and bind to specified interface. Returns socket ID.
  */
@@ -186,6 +236,10 @@ int opnrxsckt(char *ifnm, char *mac_addrs[], int no_macs);
 /* receives a packet, from socket */
 int rcvpkt(int fd, struct rt_pkt_t* pkt, struct msghdr * rcvmsg_hdr);
 
+/* receives all queued packets (up to cnt) from socket with a single system call,
+ * truncated packets get a length of 0; returns number of received packets or -1 */
+int rcvpkts(int fd, struct rt_pkt_t* pkts[], int cnt);
+
 /* checks the eth_hdr for one of the requested multicast-adresses
  * and the correct ethertype directly using the pkt_skb_buffer
  */
@@ -200,7 +254,10 @@ int prspkt(struct rt_pkt_t* pkt, enum msgtyp_t *msgtyp);
 /* checks paket headers for correct values like flags, groupids and so on */
 int chckpkthdrs(struct rt_pkt_t* pkt);
 
-/* parse dataset messages from packet, return datasetmessages 
+/* returns the axis of the writer id of the idx-th datasetmessage of a parsed packet or -1 */
+int prswrtrid(struct rt_pkt_t* pkt, int idx);
+
+/* parse dataset messages from packet, return datasetmessages (dtstmsgs must hold MAXDTSTMSGS)
  * limitation: only packets with a single type of dataset-message is supported
  */
 int prsdtstmsg(struct rt_pkt_t* pkt, enum msgtyp_t pkttyp, union dtstmsg_t *dtstmsgs[], int *dtstmsgcnt);
@@ -212,19 +269,347 @@ int prsaxsmsg(union dtstmsg_t *dtstmsg, struct axsnfo_t * axsnfo);
 int prscntrlmsg(union dtstmsg_t *dtstmsg, struct cntrlnfo_t * cntrlnfo);
 
 
+/* ##### Fused decoders ###### */
+/* A fused decoder validates and decodes a received frame of one message type
+ * in a single pass, instead of the chain chckethhdr, prspkt, chckpkthdrs,
+ * prsdtstmsg and prsaxsmsg/prscntrlmsg. The fixed header fields (Ethertype,
+ * NetworkMessage header and group header) are checked with two masked 64 bit
+ * compares, the frame length is checked against the length expected for the
+ * message count and the values are written directly to the info structs.
+ * The packet pointers (e.g. pkt->grp_hdr) are not set. */
+
+/* Result of a fused decoder */
+enum dcderr_t {
+        DCD_OK,         //frame decoded
+        DCD_LEN,        //frame length does not match the message count and type
+        DCD_HDR,        //ethertype, network message header or group header not as configured
+        DCD_MAC,        //destination address is none of the receive addresses
+        DCD_MSGCNT,     //message count out of range
+        DCD_WRTRID,     //writer id does not belong to the message type
+        DCD_DTSTMSG,    //datasetmessage header, field count or size not of the message type
+};
+
+/* validates a control frame for one of the receive addresses and decodes
+ * its datasetmessage to cntrlnfo */
+enum dcderr_t dcdcntrlfrm(struct rt_pkt_t* pkt, char *mac_addrs[], int no_macs, struct cntrlnfo_t *cntrlnfo);
+
+/* as dcdcntrlfrm, but the set values are written unchanged to ncntrlvl (nano
+ * units, fixed-point mode) instead of cntrlvl */
+enum dcderr_t dcdcntrlfrmfxp(struct rt_pkt_t* pkt, char *mac_addrs[], int no_macs, struct cntrlnfo_t *cntrlnfo);
+
+/* validates an axis frame for one of the receive addresses and decodes its
+ * datasetmessages to axsnfos (must hold MAXDTSTMSGS), the axis of a message is
+ * taken from its writer id (single message with unknown writer id: index of the
+ * receive address). The number of decoded axes is written to axscnt */
+enum dcderr_t dcdaxsfrm(struct rt_pkt_t* pkt, char *mac_addrs[], int no_macs, struct axsnfo_t axsnfos[], int *axscnt);
+
+/* returns a description of a decoder result */
+const char* dcderrstr(enum dcderr_t err);
+
+/* reads publisher id and sequence number of a frame accepted by one of the decoders */
+void dcdseqhdr(struct rt_pkt_t* pkt, uint16_t *pubid, uint16_t *seqno);
+
+/* ###### END Fused decoders ##### */
+
+
+/* ##### Sequence tracking ###### */
+/* The sequence numbers of the received frames are tracked per publisher and
+ * writer id. Sequence numbers are compared with wrap around, the ones up to
+ * SEQWNDW behind the newest are remembered to tell duplicates from late frames. */
+
+#define MAXSEQWRTRS 8           //number of publisher/writer pairs tracked
+#define SEQWNDW 64              //number of sequence numbers remembered (bits of rcvdmsk)
+#define SEQRSYNC 4              //consecutive stale frames after which the tracking restarts
+
+enum seqrslt_t {
+        SEQ_NEW,        //first frame of a writer or tracking restarted (publisher restarted)
+        SEQ_OK,         //next sequence number
+        SEQ_GAP,        //newer sequence number, the ones in between are missing
+        SEQ_DUP,        //sequence number received before
+        SEQ_REORD,      //missing sequence number arrived late
+        SEQ_STALE,      //older than the remembered sequence numbers
+        SEQ_FULL,       //no entry left for the writer, not tracked
+};
+
+struct seqcntrs_t {
+        uint64_t rcvd;          //received frames
+        uint64_t lost;          //missing sequence numbers, reduced again by late frames
+        uint64_t gaps;          //number of gaps
+        uint64_t dups;          //duplicates
+        uint64_t reord;         //late frames
+        uint64_t stale;         //stale frames
+        uint64_t rsyncs;        //restarts of the tracking
+};
+
+struct seqwrtr_t {
+        uint16_t pubid;
+        uint16_t wrtrid;
+        uint16_t lastseq;       //newest sequence number
+        uint16_t trckd;         //number of remembered sequence numbers (up to SEQWNDW)
+        uint16_t stlcnt;        //consecutive stale frames
+        uint64_t rcvdmsk;       //bit i is set if sequence number lastseq - i was received
+        struct seqcntrs_t cntrs;
+};
+
+struct seqtrck_t {
+        struct seqwrtr_t wrtrs[MAXSEQWRTRS];
+        int cnt;
+        uint64_t untrckd;       //frames of writers without entry
+};
+
+/* initializes a sequence tracker without writers */
+void initseqtrck(struct seqtrck_t *trck);
+
+/* tracks the sequence number of a frame (or datasetmessage) of a writer and
+ * updates its counters, unknown writers are added */
+enum seqrslt_t trckseq(struct seqtrck_t *trck, uint16_t pubid, uint16_t wrtrid, uint16_t seqno);
+
+/* returns true if a frame with this result is older than a frame already
+ * received from the writer, so it should not overwrite newer values */
+bool seqisold(enum seqrslt_t rslt);
+
+/* copies the counters of a writer, returns 1 if the writer is not tracked */
+int getseqcntrs(struct seqtrck_t *trck, uint16_t pubid, uint16_t wrtrid, struct seqcntrs_t *cntrs);
+
+/* prints the counters of all tracked writers */
+void prtseqcntrs(struct seqtrck_t *trck);
+
+/* ###### END Sequence tracking ##### */
+
+
+/* ##### Frame templates ###### */
+/* A frame template holds a packet of one writer together with the destination
+ * address and the message header including the control message for the
+ * TxTime. Everything is prepared once during initialization, during the cycle
+ * only sequence number, timestamp, payload and TxTime are patched.
+ * The message header points into the template, so a template must not be
+ * moved after initialization. */
+
+struct frmtmplt_t {
+        struct rt_pkt_t *pkt;
+        struct sockaddr_ll addr;
+        struct iovec msg_iov;
+        struct msghdr msg_hdr;
+        union {
+                char buf[CMSG_SPACE(sizeof(uint64_t))];
+                struct cmsghdr align;
+        } cntlmsg;
+        uint64_t *txtm;         //points to TxTime in control message
+};
+
+/* allocates the packet of the template, sets the packet with msgcnt messages
+ * of msgtyp and prepares address and message header for sending */
+int inittmplt(struct frmtmplt_t *tmplt, int msgcnt, enum msgtyp_t msgtyp, uint16_t pubid, struct sockaddr_ll *addr);
+
+/* frees the packet of the template */
+void destroytmplt(struct frmtmplt_t *tmplt);
+
+/* sends the (filled) packet of the template with the specified txtime */
+int sendtmplt(int fd, struct frmtmplt_t *tmplt, uint64_t txtime);
+
+/* sends the (filled) packets of cnt templates, each with its own txtime, in a
+ * single system call. The result of each frame is written to errs (0 or errno).
+ * Returns the number of sent frames or -1 if cnt is out of range */
+int sendtmplts(int fd, struct frmtmplt_t *tmplts[], const uint64_t txtimes[], int cnt, int errs[]);
+
+/* ###### END Frame templates ##### */
+
+
+/* ##### RX ring ###### */
+/* Memory mapped receive ring (PACKET_RX_RING) of a receive socket. Received
+ * frames are parsed in place from the ring, a packet only gives a view into
+ * the ring memory. The frames are handed back to the kernel after they were
+ * handled. TPACKET_V2 is used, as the frames of a TPACKET_V3 ring are only
+ * passed to user space when a block is full or its retire timeout (>= 1ms)
+ * expired. */
+
+#define RXRING_FRMSZ 2048       //size of a frame slot, must hold the tpacket header and MAXPKTSZ
+#define RXRING_BLKSZ 4096       //size of a ring block, multiple of the page size
+#define RXRING_FRMCNT 64        //number of frame slots in the ring
+
+struct rxring_t {
+        uint8_t *map;
+        size_t mapsz;
+        uint32_t frmcnt;
+        uint32_t curfrm;        //next frame slot to be read
+        uint32_t rdcnt;         //number of read frames not yet handed back to the kernel
+};
+
+/* sets up and maps a receive ring for an opened receive socket */
+int opnrxring(struct rxring_t *ring, int fd);
+
+/* unmaps the receive ring */
+void clsrxring(struct rxring_t *ring);
+
+/* gets the next frame from the receive ring, pkt becomes a view into the ring
+ * and is only valid until the frames are released. The kernel receive timestamp
+ * is written to rxtm (may be NULL). Truncated frames are skipped.
+ * Returns 0 on success or -1 if no frame is ready */
+int rcvringpkt(struct rxring_t *ring, struct rt_pkt_t *pkt, struct timespec *rxtm);
+
+/* hands all frames read from the ring since the last release back to the kernel */
+void rlsringpkts(struct rxring_t *ring);
+
+/* ###### END RX ring ##### */
+
+
+/* ##### Receive wait ###### */
+/* Waiting for a received frame on a socket till an absolute deadline
+ * (CLOCK_TAI) with nanosecond precision. The ppoll mode sleeps till a frame
+ * arrives or the deadline passed. The busy mode enables busy polling of the
+ * device queue on the socket (SO_BUSY_POLL, SO_PREFER_BUSY_POLL) and spins on
+ * poll without timeout. The hybrid mode sleeps in ppoll till a guard before the
+ * deadline and spins the rest. The time waited and the CPU time the thread
+ * burned while waiting are summed up. */
+
+#define RCVWT_BSYPLL 50         //time in us the device queue is busy polled per system call
+#define RCVWT_BSYBDGT 8         //frames handled per busy poll of the device queue
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+#ifndef SO_BUSY_POLL_BUDGET
+#define SO_BUSY_POLL_BUDGET 70
+#endif
+
+/* strategies to wait for a received frame */
+enum rcvwtmd_t {
+        RCVWT_PPOLL = 0,        //sleep in ppoll till the deadline
+        RCVWT_BUSY,             //busy polling of the socket till the deadline
+        RCVWT_HYBRID,           //ppoll till a guard before the deadline, then busy polling
+};
+
+struct rcvwt_t {
+        enum rcvwtmd_t md;
+        struct pollfd fds[1];
+        int64_t grd;            //time spun before the deadline in the hybrid mode in ns
+        uint64_t wts;           //number of waits
+        uint64_t rdys;          //waits which ended with a frame
+        uint64_t wttm;          //total time waited in ns
+        uint64_t maxwttm;
+        uint64_t cputm;         //total CPU time of the thread while waiting in ns
+};
+
+/* initializes the wait on a socket and sets the busy polling options of the
+ * socket in the busy and hybrid mode. Returns 0 on success or 1 on failure */
+int initrcvwt(struct rcvwt_t *wt, enum rcvwtmd_t md, int fd, int64_t grd);
+
+/* waits till a frame can be received or the deadline (CLOCK_TAI) passed.
+ * Returns 1 if a frame is ready, 0 if the deadline passed or -1 on an error */
+int rcvwt(struct rcvwt_t *wt, const struct timespec *dln);
+
+/* gets the name of a wait mode */
+const char *rcvwtmdstr(enum rcvwtmd_t md);
+
+/* prints the number of waits, the time waited and the CPU time burned */
+void prtrcvwt(const char *name, const struct rcvwt_t *wt);
+
+/* ###### END Receive wait ##### */
+
+
+/* ##### Timestamping ###### */
+/* RX and TX timestamps of the sockets (SO_TIMESTAMPING). The hardware of the
+ * interface takes the timestamps if it supports it, otherwise the kernel.
+ * Software timestamps are in CLOCK_REALTIME and converted to CLOCK_TAI,
+ * hardware timestamps are expected in TAI (clock of the NIC synchronized by PTP).
+ * TX timestamps are read from the error queue of the socket and matched to the
+ * registered frames by the id of the frame on the socket. */
+
+#define TMSTMP_RX 0x1           //timestamps of received frames
+#define TMSTMP_TX 0x2           //timestamps of sent frames
+#define TXTMSTMPSZ 64           //number of sent frames waiting for their timestamp
+
+/* a sent frame waiting for its timestamp */
+struct txplnd_t {
+        uint32_t id;            //id of the frame on the socket
+        bool vld;
+        uint64_t cycl;          //index of the cycle
+        uint64_t txtime;        //planned TxTime
+        uint64_t sndtm;         //time the frame was handed to the stack (TAI)
+};
+
+/* a sent frame with its timestamp, times in ns (TAI) */
+struct txtmstmp_t {
+        uint64_t cycl;
+        uint64_t txtime;
+        uint64_t sndtm;
+        uint64_t tmstmp;        //time the frame was sent
+        bool hw;                //timestamp is taken by the hardware
+};
+
+struct tmstmpr_t {
+        int flags;              //enabled timestamps, TMSTMP_RX and/or TMSTMP_TX
+        bool hw;                //hardware timestamps are enabled
+        int txfd;               //socket with TX timestamps
+        int64_t taioffs;        //CLOCK_TAI - CLOCK_REALTIME, for software timestamps
+        struct txplnd_t plnd[TXTMSTMPSZ];
+        uint32_t nxtid;         //id of the next sent frame
+        uint64_t unmtchd;       //TX timestamps without registered frame
+        uint64_t etfdrps;       //frames dropped by the qdisc (SO_TXTIME with SOF_TXTIME_REPORT_ERRORS)
+        uint64_t txerrs;        //other reports of the error queue
+};
+
+/* summary of a latency in ns */
+struct ltncystats_t {
+        uint64_t cnt;
+        int64_t min;
+        int64_t max;
+        int64_t sum;
+};
+
+/* enables timestamps (flags: TMSTMP_RX and/or TMSTMP_TX) on a socket of
+ * interface ifnm. Hardware timestamps are used if the interface supports them.
+ * Can be called for the RX and the TX socket with the same tmstmpr */
+int enbltmstmp(struct tmstmpr_t *tsr, int fd, char *ifnm, int flags);
+
+/* registers a frame sent on the TX socket, must be called for each sent frame in
+ * the order of sending */
+void rgsttx(struct tmstmpr_t *tsr, uint64_t sndtm, uint64_t txtime, uint64_t cycl);
+
+/* reads up to cnt TX timestamps from the error queue and matches them with the
+ * registered frames, returns the number of matched timestamps or -1 */
+int rcvtxtmstmps(struct tmstmpr_t *tsr, struct txtmstmp_t res[], int cnt);
+
+/* converts a timestamp of a packet to CLOCK_TAI */
+uint64_t tmstmp2tai(struct tmstmpr_t *tsr, uint64_t tmstmp, bool hw);
+
+/* reads the error queue of a send socket without TX timestamps, returns the
+ * number of frames dropped by the qdisc (SOF_TXTIME_REPORT_ERRORS) or -1 */
+int rcvetfdrps(int fd);
+
+/* adds a latency to the summary */
+void updtltncy(struct ltncystats_t *stats, int64_t ltncy);
+
+/* prints the summary of a latency */
+void prtltncy(const char *name, struct ltncystats_t *stats);
+
+/* ###### END Timestamping ##### */
+
+
 /* ##### PacketStore ###### */
-/* Holds and manages pointers to allocated packets to manage memory */
+/* Holds and manages pointers to allocated packets to manage memory.
+ * Unused packets are kept in a lock-free, index based free-list, so getting
+ * and returning a packet is O(1) and safe from multiple (realtime) threads.
+ * Every used packet is accounted to an owner to be able to detect leaks. */
+
+#define PKTSTRG_NIL UINT32_MAX          //end of free-list / packet not in store
+#define PKTSTRG_MAXOWNRS 4              //maximum number of owners (e.g. threads or paths) of a store
 
-/* Packetstorelement, has pointer to packet as well as flag if used or not */
+/* Packetstorelement, has pointer to packet, link to next free element, flag
+ * if used or not and the owner of the packet while used */
 struct pktstrelmt_t {
         struct rt_pkt_t* pkt;
-        bool used;
+        _Atomic uint32_t nxt;
+        _Atomic bool used;
+        _Atomic int ownr;
 };
 
-/* Packetstorage */
+/* Packetstorage, head of free-list holds the index of the first free element
+ * (lower 32 bit) and a counter against the ABA-problem (upper 32 bit) */
 struct pktstore_t {
         struct pktstrelmt_t* pktstrelmt;
         uint32_t size;
+        _Atomic uint64_t frhd;
+        _Atomic int32_t ownd[PKTSTRG_MAXOWNRS];
 };
 
 /* allocates necessary memory for Packetstorage, elements and packets */
@@ -234,12 +619,21 @@ int initpktstrg(struct pktstore_t *pktstore, uint32_t size);
  * are used */
 int destroypktstrg(struct pktstore_t  *pktstore);
 
-/* gets an unused pkt from packetstore and marks it as used */
-int getfreepkt(struct pktstore_t *pktstore, struct rt_pkt_t** pkt);
+/* gets an unused pkt from packetstore, marks it as used and accounts it to
+ * the owner */
+int getfreepkt(struct pktstore_t *pktstore, struct rt_pkt_t** pkt, int ownr);
 
 /* returns used pkt to packetsore and marks it as free */
 int retusedpkt(struct pktstore_t *pktstore, struct rt_pkt_t** pkt);
 
+/* returns the number of packets currently used by the owner */
+int cntownpkts(struct pktstore_t *pktstore, int ownr);
+
+/* returns all packets still used by the owner to the packetstore (leaked
+ * packets), must only be called by the owner itself; returns number of
+ * reclaimed packets */
+int rclmownpkts(struct pktstore_t *pktstore, int ownr);
+
 /* ###### END PacketStore ##### */
 
 
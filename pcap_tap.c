@@ -0,0 +1,332 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <net/ethernet.h>
+#include "pcap_tap.h"
+
+/* block types and options of pcapng */
+#define PCAPNG_SHB 0x0A0D0D0A
+#define PCAPNG_IDB 0x00000001
+#define PCAPNG_ISB 0x00000005
+#define PCAPNG_EPB 0x00000006
+#define PCAPNG_BYTEORDER 0x1A2B3C4D
+#define PCAPNG_LNKETH 1
+#define OPT_ENDOFOPT 0
+#define OPT_COMMENT 1
+#define OPT_SHBUSERAPPL 4
+#define OPT_IFNAME 2
+#define OPT_IFTSRESOL 9
+#define OPT_EPBFLAGS 2
+#define OPT_ISBOSDROP 7
+#define EPBFLG_INBOUND 0x01
+#define EPBFLG_OUTBOUND 0x02
+#define PCAPNG_MAXBLK 512               //largest written block, an EPB with CAPTAP_SNPLEN bytes and a comment
+
+//tap used by captx and caprx, NULL if no frames are captured
+static struct captap_t *actvtap = NULL;
+
+static uint64_t captm(void)
+{
+        struct timespec tm;
+        clock_gettime(CLOCK_TAI,&tm);
+        return (uint64_t) tm.tv_sec*1000000000ULL + tm.tv_nsec;
+}
+
+/* appends an option to a block, the value is padded to 32 bit */
+static size_t addopt(uint8_t *blk, size_t pos, uint16_t code, const void *val, uint16_t len)
+{
+        memcpy(&(blk[pos]), &code, sizeof(code));
+        memcpy(&(blk[pos+2]), &len, sizeof(len));
+        pos += 4;
+        if (len > 0)
+                memcpy(&(blk[pos]), val, len);
+        memset(&(blk[pos+len]), 0, (4 - (len & 3)) & 3);
+        return pos + ((len + 3) & ~3);
+}
+
+/* sets type and length of a block which ends at pos and writes it */
+static int wrtblk(FILE *fl, uint8_t *blk, uint32_t type, size_t pos)
+{
+        uint32_t len = pos + 4;
+        memcpy(&(blk[0]), &type, sizeof(type));
+        memcpy(&(blk[4]), &len, sizeof(len));
+        memcpy(&(blk[pos]), &len, sizeof(len));
+        if (fwrite(blk,len,1,fl) != 1)
+                return 1;       //fail
+        return 0;       //succeded
+}
+
+/* writes the section header and the description of the interface */
+static int wrthdr(FILE *fl, const char *ifnm)
+{
+        uint8_t blk[PCAPNG_MAXBLK];
+        uint32_t u32;
+        uint16_t u16;
+        int64_t i64;
+        uint8_t tsresol = 9;    //timestamps in ns
+        const char *appl = "AccessTSN RTDriveControl";
+        size_t pos = 8;
+
+        u32 = PCAPNG_BYTEORDER;
+        memcpy(&(blk[pos]), &u32, 4);
+        u16 = 1;
+        memcpy(&(blk[pos+4]), &u16, 2);
+        u16 = 0;
+        memcpy(&(blk[pos+6]), &u16, 2);
+        i64 = -1;               //length of the section not known
+        memcpy(&(blk[pos+8]), &i64, 8);
+        pos += 16;
+        pos = addopt(blk,pos,OPT_SHBUSERAPPL,appl,strlen(appl));
+        pos = addopt(blk,pos,OPT_ENDOFOPT,NULL,0);
+        if (wrtblk(fl,blk,PCAPNG_SHB,pos))
+                return 1;       //fail
+
+        pos = 8;
+        u16 = PCAPNG_LNKETH;
+        memcpy(&(blk[pos]), &u16, 2);
+        u16 = 0;
+        memcpy(&(blk[pos+2]), &u16, 2);
+        u32 = CAPTAP_SNPLEN;
+        memcpy(&(blk[pos+4]), &u32, 4);
+        pos += 8;
+        pos = addopt(blk,pos,OPT_IFNAME,ifnm,strnlen(ifnm,IFNAMSIZ));
+        pos = addopt(blk,pos,OPT_IFTSRESOL,&tsresol,1);
+        pos = addopt(blk,pos,OPT_ENDOFOPT,NULL,0);
+        return wrtblk(fl,blk,PCAPNG_IDB,pos);
+}
+
+/* writes a captured frame as enhanced packet block */
+static int wrtepb(FILE *fl, const struct capslt_t *slt)
+{
+        uint8_t blk[PCAPNG_MAXBLK];
+        char cmmnt[96];
+        uint32_t u32[5];
+        uint32_t caplen;
+        uint64_t ts;
+        int cmmntlen = 0;
+        size_t pos = 8;
+
+        caplen = (slt->len < CAPTAP_SNPLEN) ? slt->len : CAPTAP_SNPLEN;
+        if (slt->flgs & CAPFLG_TX) {
+                //sent frames at their planned TxTime
+                ts = slt->tmstmp;
+                cmmntlen = snprintf(cmmnt, sizeof(cmmnt), "planned TxTime, handed to the stack %lld ns before",
+                                    (long long) (slt->tmstmp - slt->tm));
+        } else {
+                //received frames when the application got them, all timestamps of the file are CLOCK_TAI
+                ts = slt->tm;
+                if (slt->flgs & CAPFLG_TMSTMP)
+                        cmmntlen = snprintf(cmmnt, sizeof(cmmnt), "RX timestamp (%s): %llu.%09llu",
+                                            (slt->flgs & CAPFLG_HW) ? "hardware" : "CLOCK_REALTIME",
+                                            (unsigned long long) (slt->tmstmp / 1000000000ULL),
+                                            (unsigned long long) (slt->tmstmp % 1000000000ULL));
+        }
+        u32[0] = 0;             //interface
+        u32[1] = ts >> 32;
+        u32[2] = ts & 0xFFFFFFFF;
+        u32[3] = caplen;
+        u32[4] = slt->len;
+        memcpy(&(blk[pos]), u32, sizeof(u32));
+        pos += sizeof(u32);
+        memcpy(&(blk[pos]), slt->frm, caplen);
+        memset(&(blk[pos+caplen]), 0, (4 - (caplen & 3)) & 3);
+        pos += (caplen + 3) & ~3;
+
+        u32[0] = (slt->flgs & CAPFLG_TX) ? EPBFLG_OUTBOUND : EPBFLG_INBOUND;
+        pos = addopt(blk,pos,OPT_EPBFLAGS,&(u32[0]),4);
+        if (cmmntlen > 0)
+                pos = addopt(blk,pos,OPT_COMMENT,cmmnt,cmmntlen);
+        pos = addopt(blk,pos,OPT_ENDOFOPT,NULL,0);
+        return wrtblk(fl,blk,PCAPNG_EPB,pos);
+}
+
+/* writes the frames dropped by the tap as interface statistics */
+static int wrtisb(FILE *fl, uint64_t drpd)
+{
+        uint8_t blk[PCAPNG_MAXBLK];
+        uint32_t u32[3];
+        const char *cmmnt = "frames dropped by the capture tap, the ring was full";
+        uint64_t ts = captm();
+        size_t pos = 8;
+
+        u32[0] = 0;
+        u32[1] = ts >> 32;
+        u32[2] = ts & 0xFFFFFFFF;
+        memcpy(&(blk[pos]), u32, sizeof(u32));
+        pos += sizeof(u32);
+        pos = addopt(blk,pos,OPT_COMMENT,cmmnt,strlen(cmmnt));
+        pos = addopt(blk,pos,OPT_ISBOSDROP,&drpd,sizeof(drpd));
+        pos = addopt(blk,pos,OPT_ENDOFOPT,NULL,0);
+        return wrtblk(fl,blk,PCAPNG_ISB,pos);
+}
+
+int initcaptap(struct captap_t *tap, const char *path, char *ifnm)
+{
+        struct ifreq ifr;
+        int fd;
+
+        memset(tap,0,sizeof(struct captap_t));
+        initsltring(&(tap->ring),tap->slts,sizeof(struct capslt_t),CAPTAP_RINGSZ);
+        if (NULL == path)
+                return 0;       //succeded, disabled
+        if (NULL == ifnm) {
+                printf("Capture needs a network interface.\n");
+                return 1;       //fail
+        }
+
+        //frames of a SOCK_DGRAM socket get the MAC of the interface as source
+        fd = socket(AF_PACKET, SOCK_DGRAM, 0);
+        if (fd < 0) {
+                printf("Opening socket for the capture failed. Error: %d\n",errno);
+                return 1;       //fail
+        }
+        memset(&ifr,0,sizeof(struct ifreq));
+        strncpy(ifr.ifr_name, ifnm, IFNAMSIZ - 1);
+        if (ioctl(fd, SIOCGIFHWADDR, &ifr) < 0) {
+                printf("Getting MAC address of %s for the capture failed. Error: %d\n",ifnm,errno);
+                close(fd);
+                return 1;       //fail
+        }
+        close(fd);
+        memcpy(tap->srcmac, ifr.ifr_hwaddr.sa_data, ETH_ALEN);
+
+        tap->fl = fopen(path,"wb");
+        if (NULL == tap->fl) {
+                printf("Opening capture file %s failed.\n",path);
+                return 1;       //fail
+        }
+        if (wrthdr(tap->fl,ifnm)) {
+                printf("Writing capture file %s failed.\n",path);
+                fclose(tap->fl);
+                tap->fl = NULL;
+                return 1;       //fail
+        }
+        tap->path = path;
+        return 0;       //succeded
+}
+
+void captx(const struct sockaddr_ll *addr, const void *frm, uint32_t len, uint64_t txtime)
+{
+        struct captap_t *tap;
+        struct capslt_t *slt;
+        struct ether_header *ethhdr;
+        uint32_t hdrlen = 0;
+        uint32_t cpylen;
+        uint64_t pos;
+
+        tap = __atomic_load_n(&actvtap, __ATOMIC_ACQUIRE);
+        if (NULL == tap)
+                return;
+        slt = clmslt(&(tap->ring),&pos);
+        if (NULL == slt)
+                return;
+        slt->tm = captm();
+        slt->tmstmp = txtime;
+        slt->flgs = CAPFLG_TX;
+        if (NULL != addr) {
+                //the Ethernet header is added by the kernel, build it the same way
+                ethhdr = (struct ether_header *) slt->frm;
+                memcpy(ethhdr->ether_dhost, addr->sll_addr, ETH_ALEN);
+                memcpy(ethhdr->ether_shost, tap->srcmac, ETH_ALEN);
+                ethhdr->ether_type = addr->sll_protocol;
+                hdrlen = sizeof(struct ether_header);
+        }
+        slt->len = hdrlen + len;
+        cpylen = (len < CAPTAP_SNPLEN - hdrlen) ? len : CAPTAP_SNPLEN - hdrlen;
+        memcpy(&(slt->frm[hdrlen]), frm, cpylen);
+        //hand the slot to the writer thread
+        pblslt(slt,pos);
+}
+
+void caprx(const void *frm, uint32_t len, uint64_t rxtmstmp, bool rxhw)
+{
+        struct captap_t *tap;
+        struct capslt_t *slt;
+        uint64_t pos;
+
+        tap = __atomic_load_n(&actvtap, __ATOMIC_ACQUIRE);
+        if (NULL == tap)
+                return;
+        slt = clmslt(&(tap->ring),&pos);
+        if (NULL == slt)
+                return;
+        slt->tm = captm();
+        slt->tmstmp = rxtmstmp;
+        slt->flgs = 0;
+        if (rxtmstmp != 0)
+                slt->flgs |= rxhw ? (CAPFLG_TMSTMP | CAPFLG_HW) : CAPFLG_TMSTMP;
+        slt->len = len;
+        memcpy(slt->frm, frm, (len < CAPTAP_SNPLEN) ? len : CAPTAP_SNPLEN);
+        pblslt(slt,pos);
+}
+
+int drncaptap(struct captap_t *tap)
+{
+        struct capslt_t *slt;
+        struct capslt_t cpy;
+        int cnt = 0;
+
+        while ((slt = nxtslt(&(tap->ring))) != NULL) {
+                memcpy(&cpy, slt, sizeof(struct capslt_t));
+                //hand the slot back to the capturing threads for the next round
+                rlsslt(&(tap->ring),slt);
+                if (wrtepb(tap->fl,&cpy) == 0)
+                        tap->wrttn++;
+                cnt++;
+        }
+        return cnt;
+}
+
+static void *captapthrd(void *arg)
+{
+        struct captap_t *tap = (struct captap_t *) arg;
+        while (__atomic_load_n(&(tap->run), __ATOMIC_ACQUIRE)) {
+                if (drncaptap(tap) > 0)
+                        fflush(tap->fl);
+                usleep(CAPTAP_WRTINTRVL);
+        }
+        return NULL;
+}
+
+int strtcaptap(struct captap_t *tap)
+{
+        if (NULL == tap->path)
+                return 0;       //succeded, disabled
+        //normal (not real-time) priority, writing the file may block
+        __atomic_store_n(&(tap->run), true, __ATOMIC_RELEASE);
+        if (pthread_create(&(tap->thrd), NULL, captapthrd, tap) != 0) {
+                printf("create capture thread failed\n");
+                tap->run = false;
+                return 1;       //fail
+        }
+        __atomic_store_n(&actvtap, tap, __ATOMIC_RELEASE);
+        return 0;       //succeded
+}
+
+void stpcaptap(struct captap_t *tap)
+{
+        if (NULL == tap->path)
+                return;         //disabled or already stopped
+        __atomic_store_n(&actvtap, NULL, __ATOMIC_RELEASE);
+        if (__atomic_load_n(&(tap->run), __ATOMIC_ACQUIRE)) {
+                __atomic_store_n(&(tap->run), false, __ATOMIC_RELEASE);
+                pthread_join(tap->thrd, NULL);
+        }
+        drncaptap(tap);
+        if ((wrtisb(tap->fl,__atomic_load_n(&(tap->ring.drpd), __ATOMIC_RELAXED)) != 0) || (fclose(tap->fl) != 0))
+                printf("Writing capture file %s failed.\n",tap->path);
+        printf("Capture: %llu frames written to %s, %llu frames dropped\n", (unsigned long long) tap->wrttn, tap->path,
+               (unsigned long long) __atomic_load_n(&(tap->ring.drpd), __ATOMIC_RELAXED));
+        tap->fl = NULL;
+        tap->path = NULL;
+}
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Capture of all sent and received frames without an external sniffer. The
+ * send and receive functions copy each frame (up to the snap length) into a
+ * slot of a preallocated lock-free ring, a writer thread with normal priority
+ * writes the slots to a pcapng file. Sent frames carry the planned TxTime as
+ * timestamp, received frames the time they were handed to the application and
+ * their RX timestamp as comment. If the ring is full, frames are dropped and
+ * counted. As long as no tap is active, the capture functions return at once.
+ */
+
+#ifndef _PCAPTAP_H_
+#define _PCAPTAP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <linux/if_packet.h>
+#include "slot_ring.h"
+
+#define CAPTAP_RINGSZ 512               //number of slots in the ring, power of 2
+#define CAPTAP_SNPLEN 256               //bytes of a frame which are captured
+#define CAPTAP_WRTINTRVL 10000          //interval in us in which the writer thread writes the slots
+
+/* flags of a captured frame */
+enum capflg_t {
+        CAPFLG_TX = 0x01,               //sent frame, otherwise received
+        CAPFLG_TMSTMP = 0x02,           //frame has an RX timestamp
+        CAPFLG_HW = 0x04,               //RX timestamp is taken by the hardware
+};
+
+/* slot in the ring */
+struct capslt_t {
+        uint64_t seq;                   //sequence number of the slot ring, first field
+        uint64_t tm;                    //CLOCK_TAI in ns when the frame was captured
+        uint64_t tmstmp;                //TxTime of a sent frame or RX timestamp of a received frame in ns
+        uint32_t len;                   //original length of the frame
+        uint32_t flgs;
+        uint8_t frm[CAPTAP_SNPLEN];
+};
+
+/* tap with ring, output file and writer thread */
+struct captap_t {
+        struct capslt_t slts[CAPTAP_RINGSZ];
+        struct sltring_t ring;          //hands the slots from the capturing threads to the writer thread, counts dropped frames
+        uint64_t wrttn;                 //frames written to the file
+        uint8_t srcmac[6];              //source MAC of frames sent through a socket without Ethernet header
+        const char *path;               //NULL if disabled
+        FILE *fl;
+        bool run;
+        pthread_t thrd;
+};
+
+/* initialize the tap and write the header of the pcapng file for the interface, path NULL disables it */
+int initcaptap(struct captap_t *tap, const char *path, char *ifnm);
+
+/* start the writer thread and make the tap active for all threads */
+int strtcaptap(struct captap_t *tap);
+
+/* make the tap inactive, stop the writer thread, write all remaining frames and close the file */
+void stpcaptap(struct captap_t *tap);
+
+/* capture a sent frame; with addr the frame has no Ethernet header, it is built from the address */
+void captx(const struct sockaddr_ll *addr, const void *frm, uint32_t len, uint64_t txtime);
+
+/* capture a received frame with Ethernet header, rxtmstmp 0 if it has no RX timestamp */
+void caprx(const void *frm, uint32_t len, uint64_t rxtmstmp, bool rxhw);
+
+/* write all slots in the ring to the file, only called by the writer thread (or after it stopped) */
+int drncaptap(struct captap_t *tap);
+
+#endif /* _PCAPTAP_H_ */
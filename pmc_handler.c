@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "pmc_handler.h"
+
+static const struct {
+        uint32_t type;
+        uint64_t config;
+        const char *name;
+} pmcevnts[PMC_CNT] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "cache misses"},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch misses"},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, "ctx switches"},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, "page faults"},
+};
+
+const char *pmcevntstr(enum pmcevnt_t evnt)
+{
+        if ((evnt < 0) || (evnt >= PMC_CNT))
+                return "unknown";
+        return pmcevnts[evnt].name;
+}
+
+void initpmcthrd(struct pmcthrd_t *thrd, const char *name)
+{
+        memset(thrd,0,sizeof(struct pmcthrd_t));
+        thrd->name = name;
+        thrd->ldrfd = -1;
+        for (int i = 0; i < PMC_CNT; i++) {
+                thrd->fds[i] = -1;
+                thrd->idx[i] = -1;
+                inithst(&(thrd->hsts[i]),0);
+        }
+}
+
+void rgstpmcthrd(struct pmcthrd_t *thrd)
+{
+        __atomic_store_n(&(thrd->tid), (int) syscall(SYS_gettid), __ATOMIC_RELEASE);
+}
+
+/* closes all counters of the group */
+static void clsgrp(struct pmcthrd_t *thrd)
+{
+        for (int i = 0; i < PMC_CNT; i++) {
+                if (thrd->fds[i] >= 0)
+                        close(thrd->fds[i]);
+                thrd->fds[i] = -1;
+                thrd->idx[i] = -1;
+        }
+        thrd->nr = 0;
+        thrd->ldrfd = -1;
+}
+
+int opnpmcthrd(struct pmcthrd_t *thrd)
+{
+        struct perf_event_attr attr;
+        int tid;
+
+        tid = __atomic_load_n(&(thrd->tid), __ATOMIC_ACQUIRE);
+        if (tid == 0)
+                return -1;      //try again, thread not registered yet
+        for (int i = 0; i < PMC_CNT; i++) {
+                memset(&attr,0,sizeof(struct perf_event_attr));
+                attr.size = sizeof(struct perf_event_attr);
+                attr.type = pmcevnts[i].type;
+                attr.config = pmcevnts[i].config;
+                attr.read_format = PERF_FORMAT_GROUP;
+                attr.exclude_hv = 1;
+                attr.exclude_kernel = thrd->usronly;
+                //the first available counter leads the group, all are read with one read of the leader
+                thrd->fds[i] = syscall(SYS_perf_event_open, &attr, tid, -1, thrd->ldrfd, 0);
+                if (thrd->fds[i] < 0) {
+                        thrd->fds[i] = -1;
+                        if (((errno == EACCES) || (errno == EPERM)) && !thrd->usronly) {
+                                //counting in the kernel is not allowed, start again counting user space only
+                                clsgrp(thrd);
+                                thrd->usronly = true;
+                                i = -1;
+                        }
+                        continue;       //counter not supported
+                }
+                if (thrd->ldrfd < 0)
+                        thrd->ldrfd = thrd->fds[i];
+                thrd->idx[i] = thrd->nr;
+                thrd->nr++;
+        }
+        if (thrd->nr == 0) {
+                printf("No performance counter available for %s thread: %s\n", thrd->name, strerror(errno));
+                return 1;       //fail
+        }
+        thrd->vld = false;
+        __atomic_store_n(&(thrd->rdy), true, __ATOMIC_RELEASE);
+        return 0;       //succeded
+}
+
+void smplpmc(struct pmcthrd_t *thrd)
+{
+        uint64_t vals[1 + PMC_CNT];
+        uint64_t cur;
+
+        if (!__atomic_load_n(&(thrd->rdy), __ATOMIC_ACQUIRE))
+                return;
+        //one read returns the number of counters followed by the values of all counters of the group
+        if ((read(thrd->ldrfd, vals, sizeof(vals)) < (ssize_t) ((1 + thrd->nr)*sizeof(uint64_t))) || (vals[0] != (uint64_t) thrd->nr)) {
+                thrd->rderrs++;
+                thrd->vld = false;
+                return;
+        }
+        for (int i = 0; i < PMC_CNT; i++) {
+                if (thrd->idx[i] < 0)
+                        continue;
+                cur = vals[1 + thrd->idx[i]];
+                if (thrd->vld)
+                        updthst(&(thrd->hsts[i]), (int64_t) (cur - thrd->prv[i]));
+                thrd->prv[i] = cur;
+        }
+        thrd->vld = true;
+}
+
+void prtpmc(const struct pmcthrd_t *thrd)
+{
+        struct ltncyhst_t snpst;
+        uint64_t cyclsum = 0;
+        uint64_t instrsum = 0;
+
+        if (!__atomic_load_n(&(thrd->rdy), __ATOMIC_ACQUIRE)) {
+                printf("Performance counters of %s thread: not open\n", thrd->name);
+                return;
+        }
+        printf("Performance counters of %s thread per cycle%s:\n", thrd->name, thrd->usronly ? " (user space only)" : "");
+        printf("  %-14s %10s %10s %10s %10s %10s %10s\n", "counter", "samples", "min", "mean", "p50", "p99", "max");
+        for (int i = 0; i < PMC_CNT; i++) {
+                if (thrd->idx[i] < 0) {
+                        printf("  %-14s %10s\n", pmcevntstr(i), "-");
+                        continue;
+                }
+                snpsthst(&(thrd->hsts[i]),&snpst);
+                if (i == PMC_CYCLES)
+                        cyclsum = snpst.sum;
+                if (i == PMC_INSTR)
+                        instrsum = snpst.sum;
+                if (snpst.cnt == 0) {
+                        printf("  %-14s %10d\n", pmcevntstr(i), 0);
+                        continue;
+                }
+                printf("  %-14s %10llu %10lld %10.2f %10lld %10lld %10lld\n", pmcevntstr(i),
+                       (unsigned long long) snpst.cnt, (long long) snpst.min, (double) snpst.sum/snpst.cnt,
+                       (long long) hstprcntl(&snpst,50.0), (long long) hstprcntl(&snpst,99.0), (long long) snpst.max);
+        }
+        if ((cyclsum > 0) && (instrsum > 0))
+                printf("  instructions per cycle %.2f\n", (double) instrsum/cyclsum);
+        if (thrd->rderrs > 0)
+                printf("  %llu failed reads\n", (unsigned long long) thrd->rderrs);
+}
+
+void clspmcthrd(struct pmcthrd_t *thrd)
+{
+        if (!__atomic_load_n(&(thrd->rdy), __ATOMIC_ACQUIRE))
+                return;         //nothing open
+        __atomic_store_n(&(thrd->rdy), false, __ATOMIC_RELEASE);
+        clsgrp(thrd);
+}
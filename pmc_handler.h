@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Performance monitoring counters (PMC) of the real-time threads. A
+ * monitoring thread opens a group of counters (perf_event_open) for each
+ * real-time thread: cpu cycles, instructions, cache misses, branch misses,
+ * context switches and page faults. The real-time thread reads its group with
+ * one read at each cycle boundary and adds the counts of the last cycle to a
+ * histogram per counter. Counters which are not supported by the cpu or the
+ * kernel (e.g. hardware counters in a virtual machine) are left out.
+ */
+
+#ifndef _PMCHANDLER_H_
+#define _PMCHANDLER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rt_stats.h"
+
+/* counted events */
+enum pmcevnt_t {
+        PMC_CYCLES = 0,
+        PMC_INSTR,
+        PMC_CACHEMISS,
+        PMC_BRANCHMISS,
+        PMC_CTXSW,
+        PMC_PGFLT,
+        PMC_CNT
+};
+
+/* counters of one real-time thread */
+struct pmcthrd_t {
+        const char *name;
+        int tid;                        //thread id, 0 till the thread registered itself
+        int fds[PMC_CNT];               //-1 if the counter is not available
+        int idx[PMC_CNT];               //position of the counter in the read group, -1 if not available
+        int nr;                         //number of counters in the group
+        int ldrfd;                      //counter which leads the group, -1 if not open
+        bool usronly;                   //only counted in user space (kernel not allowed by perf_event_paranoid)
+        bool rdy;                       //group is open, set by the monitoring thread
+        bool vld;                       //prv holds the values of the last cycle boundary
+        uint64_t prv[PMC_CNT];
+        struct ltncyhst_t hsts[PMC_CNT];        //counts per cycle
+        uint64_t rderrs;
+};
+
+/* get name of an event */
+const char *pmcevntstr(enum pmcevnt_t evnt);
+
+/* initialize the counters of a thread, nothing is opened yet */
+void initpmcthrd(struct pmcthrd_t *thrd, const char *name);
+
+/* register the calling thread, called by the real-time thread itself */
+void rgstpmcthrd(struct pmcthrd_t *thrd);
+
+/* open the counter group of a registered thread, called by the monitoring thread, -1 if not registered yet */
+int opnpmcthrd(struct pmcthrd_t *thrd);
+
+/* read the counter group at a cycle boundary and add the counts of the last cycle */
+void smplpmc(struct pmcthrd_t *thrd);
+
+/* print the distributions of the counts per cycle */
+void prtpmc(const struct pmcthrd_t *thrd);
+
+/* close the counter group if it is open */
+void clspmcthrd(struct pmcthrd_t *thrd);
+
+#endif /* _PMCHANDLER_H_ */
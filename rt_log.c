@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "rt_log.h"
+
+/* format of each event, events with a string get it as first argument; the name is used for suppressed records */
+static const struct {
+        const char *fmt;
+        bool hasstr;
+        const char *name;
+} rtlogevnts[LOG_EVNTCNT] = {
+        {"recv failed errno: %lld", false, "recv failed"},
+        {"error in sndmsg, errono: %lld", false, "error in sndmsg"},
+        {"error in sndmmsg, frame: %lld, errono: %lld", false, "error in sndmmsg"},
+        {"error in sndxsk, frame: %lld, errono: %lld", false, "error in sndxsk"},
+        {"error in sndxsk wakeup, errono: %lld", false, "error in sndxsk wakeup"},
+        {"Could not get free packet for receiving.", false, "no free packet"},
+        {"Receive failed.", false, "receive failed"},
+        {"Received packet truncated.", false, "packet truncated"},
+        {"Decoding of received packet failed: %s.", true, "decoding failed"},
+        {"Error in filling sending packet or corresponding headers.", false, "filling packet failed"},
+        {"Packet leak in %s thread, reclaimed %lld packet(s).", true, "packet leak"},
+        {"fatal error during %s", true, "fatal error"},
+        {"Overrun of %s thread, missed %lld cycle(s) at cycle %lld.", true, "overrun"},
+};
+
+//log used by rtlog, NULL if records are printed directly
+static struct rtlog_t *actvlog = NULL;
+
+static uint64_t logtm(void)
+{
+        struct timespec tm;
+        clock_gettime(CLOCK_MONOTONIC,&tm);
+        return (uint64_t) tm.tv_sec*1000000000ULL + tm.tv_nsec;
+}
+
+/* formats and prints a record */
+static void prtrcrd(FILE *out, const struct rtlogrcrd_t *rcrd)
+{
+        const char *str;
+        if (rcrd->evnt >= LOG_EVNTCNT)
+                return;
+        if (rtlogevnts[rcrd->evnt].hasstr) {
+                str = (rcrd->str != NULL) ? rcrd->str : "";
+                fprintf(out, rtlogevnts[rcrd->evnt].fmt, str, (long long) rcrd->args[0], (long long) rcrd->args[1],
+                        (long long) rcrd->args[2]);
+        } else {
+                fprintf(out, rtlogevnts[rcrd->evnt].fmt, (long long) rcrd->args[0], (long long) rcrd->args[1],
+                        (long long) rcrd->args[2]);
+        }
+        if (rcrd->sprsd > 0)
+                fprintf(out, " (%u similar messages suppressed before)", rcrd->sprsd);
+        fprintf(out, "\n");
+}
+
+void initrtlog(struct rtlog_t *log, FILE *out)
+{
+        memset(log,0,sizeof(struct rtlog_t));
+        initsltring(&(log->ring),log->rcrds,sizeof(struct rtlogrcrd_t),RTLOG_RINGSZ);
+        log->out = out;
+        log->rtintrvl = RTLOG_RATEINTRVL;
+}
+
+/* pushes a record into the ring, several threads may push at the same time */
+static int pushrcrd(struct rtlog_t *log, const struct rtlogrcrd_t *rcrd)
+{
+        struct rtlogrcrd_t *slt;
+        uint64_t pos;
+
+        slt = clmslt(&(log->ring),&pos);
+        if (NULL == slt)
+                return 1;       //fail, ring is full
+        slt->tm = rcrd->tm;
+        slt->evnt = rcrd->evnt;
+        slt->sprsd = rcrd->sprsd;
+        slt->str = rcrd->str;
+        memcpy(slt->args, rcrd->args, sizeof(slt->args));
+        //hand the slot to the log thread
+        pblslt(slt,pos);
+        return 0;       //succeded
+}
+
+int rtlog(enum rtlogevnt_t evnt, const char *str, int64_t arg0, int64_t arg1, int64_t arg2)
+{
+        struct rtlog_t *log;
+        struct rtlogrcrd_t rcrd;
+        uint64_t lsttm;
+
+        if ((evnt < 0) || (evnt >= LOG_EVNTCNT))
+                return 1;       //fail
+        rcrd.evnt = evnt;
+        rcrd.str = str;
+        rcrd.args[0] = arg0;
+        rcrd.args[1] = arg1;
+        rcrd.args[2] = arg2;
+        rcrd.sprsd = 0;
+        log = __atomic_load_n(&actvlog, __ATOMIC_ACQUIRE);
+        if (log == NULL) {
+                prtrcrd(stdout,&rcrd);
+                return 0;       //succeded
+        }
+
+        //only one record of an event per interval, the others are counted
+        rcrd.tm = logtm();
+        lsttm = __atomic_load_n(&(log->lsttm[evnt]), __ATOMIC_RELAXED);
+        if ((lsttm != 0) && (rcrd.tm - lsttm < log->rtintrvl)) {
+                __atomic_fetch_add(&(log->sprsd[evnt]), 1, __ATOMIC_RELAXED);
+                return 0;       //succeded
+        }
+        __atomic_store_n(&(log->lsttm[evnt]), rcrd.tm, __ATOMIC_RELAXED);
+        rcrd.sprsd = __atomic_exchange_n(&(log->sprsd[evnt]), 0, __ATOMIC_RELAXED);
+        return pushrcrd(log,&rcrd);
+}
+
+/* prints the suppressed records of events without a new record for an interval */
+static void prtsprsd(struct rtlog_t *log, bool all)
+{
+        uint64_t now = logtm();
+        uint32_t sprsd;
+        for (int i = 0; i < LOG_EVNTCNT; i++) {
+                if (__atomic_load_n(&(log->sprsd[i]), __ATOMIC_RELAXED) == 0)
+                        continue;
+                if (!all && (now - __atomic_load_n(&(log->lsttm[i]), __ATOMIC_RELAXED) < log->rtintrvl))
+                        continue;
+                sprsd = __atomic_exchange_n(&(log->sprsd[i]), 0, __ATOMIC_RELAXED);
+                if (sprsd > 0)
+                        fprintf(log->out, "%u similar messages suppressed: %s\n", sprsd, rtlogevnts[i].name);
+        }
+}
+
+int drnrtlog(struct rtlog_t *log)
+{
+        struct rtlogrcrd_t *slt;
+        struct rtlogrcrd_t rcrd;
+        int cnt = 0;
+
+        while ((slt = nxtslt(&(log->ring))) != NULL) {
+                memcpy(&rcrd, slt, sizeof(struct rtlogrcrd_t));
+                //hand the slot back to the writing threads for the next round
+                rlsslt(&(log->ring),slt);
+                prtrcrd(log->out,&rcrd);
+                cnt++;
+        }
+        return cnt;
+}
+
+static void *rtlogthrd(void *arg)
+{
+        struct rtlog_t *log = (struct rtlog_t *) arg;
+        while (__atomic_load_n(&(log->run), __ATOMIC_ACQUIRE)) {
+                if (drnrtlog(log) > 0)
+                        fflush(log->out);
+                prtsprsd(log,false);
+                usleep(RTLOG_DRNINTRVL);
+        }
+        return NULL;
+}
+
+int strtrtlog(struct rtlog_t *log)
+{
+        //normal (not real-time) priority, the log thread only runs when the real-time threads sleep
+        __atomic_store_n(&(log->run), true, __ATOMIC_RELEASE);
+        if (pthread_create(&(log->thrd), NULL, rtlogthrd, log) != 0) {
+                printf("create log thread failed\n");
+                log->run = false;
+                return 1;       //fail
+        }
+        __atomic_store_n(&actvlog, log, __ATOMIC_RELEASE);
+        return 0;       //succeded
+}
+
+void stprtlog(struct rtlog_t *log)
+{
+        if (!__atomic_load_n(&(log->run), __ATOMIC_ACQUIRE))
+                return;         //not started
+        __atomic_store_n(&actvlog, NULL, __ATOMIC_RELEASE);
+        __atomic_store_n(&(log->run), false, __ATOMIC_RELEASE);
+        pthread_join(log->thrd, NULL);
+        drnrtlog(log);
+        prtsprsd(log,true);
+        if (log->ring.drpd > 0)
+                fprintf(log->out, "%llu log messages dropped, log ring full\n", (unsigned long long) log->ring.drpd);
+        fflush(log->out);
+}
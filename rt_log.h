@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Logging from the real-time threads without console I/O. The real-time
+ * threads push fixed-size binary records (event and a few integer arguments)
+ * into a preallocated lock-free ring, a log thread with normal priority
+ * formats and prints them. Several threads may push at the same time. Records
+ * of the same event which follow within the rate interval are not pushed but
+ * counted and reported with the next record of the event. If the ring is
+ * full, records are dropped and counted. As long as no log is active (e.g.
+ * during initialization or in the tests), the records are printed directly.
+ */
+
+#ifndef _RTLOG_H_
+#define _RTLOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "slot_ring.h"
+
+#define RTLOG_RINGSZ 256                        //number of records in the ring, power of 2
+#define RTLOG_ARGS 3                            //integer arguments of a record
+#define RTLOG_RATEINTRVL 1000000000ULL          //interval in ns in which only one record of an event is pushed
+#define RTLOG_DRNINTRVL 10000                   //interval in us in which the log thread prints the records
+
+/* logged events */
+enum rtlogevnt_t {
+        LOG_RCVFAIL = 0,        //args: errno
+        LOG_SNDFAIL,            //args: errno
+        LOG_SNDMFAIL,           //args: frame, errno
+        LOG_XSKSNDFAIL,         //args: frame, errno
+        LOG_XSKWKUPFAIL,        //args: errno
+        LOG_NOFREEPKT,
+        LOG_RCVERR,
+        LOG_TRUNC,
+        LOG_DCDFAIL,            //str: reason
+        LOG_FILLFAIL,
+        LOG_PKTLEAK,            //str: thread, args: reclaimed packets
+        LOG_FATAL,              //str: stage
+        LOG_OVERRUN,            //str: thread, args: missed cycles, cycle
+        LOG_EVNTCNT
+};
+
+/* record in the ring */
+struct rtlogrcrd_t {
+        uint64_t seq;                   //sequence number of the slot ring, first field
+        uint64_t tm;                    //CLOCK_MONOTONIC in ns
+        uint32_t evnt;
+        uint32_t sprsd;                 //records of the same event suppressed before this one
+        const char *str;                //static string or NULL
+        int64_t args[RTLOG_ARGS];
+};
+
+/* log with ring and log thread */
+struct rtlog_t {
+        struct rtlogrcrd_t rcrds[RTLOG_RINGSZ];
+        struct sltring_t ring;          //hands the records from the writing threads to the log thread, counts dropped records
+        uint64_t lsttm[LOG_EVNTCNT];    //time of the last pushed record of each event
+        uint32_t sprsd[LOG_EVNTCNT];    //suppressed records of each event since the last pushed one
+        uint64_t rtintrvl;              //interval of the rate limit in ns, 0 pushes every record
+        FILE *out;
+        bool run;
+        pthread_t thrd;
+};
+
+/* initialize the log, records are printed to out */
+void initrtlog(struct rtlog_t *log, FILE *out);
+
+/* start the log thread and make the log active for all threads */
+int strtrtlog(struct rtlog_t *log);
+
+/* make the log inactive, stop the log thread and print all remaining records */
+void stprtlog(struct rtlog_t *log);
+
+/* log an event from any thread, str must be a static string; returns 1 if the record was dropped */
+int rtlog(enum rtlogevnt_t evnt, const char *str, int64_t arg0, int64_t arg1, int64_t arg2);
+
+/* print all records in the ring, only called by the log thread (or after it stopped) */
+int drnrtlog(struct rtlog_t *log);
+
+#endif /* _RTLOG_H_ */
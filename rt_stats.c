@@ -0,0 +1,248 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "rt_stats.h"
+#include "time_calc.h"
+
+/* only one thread writes, so a relaxed load and store is enough instead of a locked read-modify-write */
+static inline void rlxdinc(uint64_t *val, uint64_t inc)
+{
+        __atomic_store_n(val, __atomic_load_n(val, __ATOMIC_RELAXED) + inc, __ATOMIC_RELAXED);
+}
+
+void inithst(struct ltncyhst_t *hst, int64_t lmt)
+{
+        memset(hst,0,sizeof(struct ltncyhst_t));
+        hst->min = INT64_MAX;
+        hst->lmt = lmt;
+}
+
+int hstbckt(int64_t val)
+{
+        int msb;
+        if (val < HSTSUBBCKTS)
+                return (val < 0) ? 0 : (int) val;
+        msb = 63 - __builtin_clzll((uint64_t) val);
+        //bucket of the power of two and the next HSTSUBBITS bits below the msb
+        return (msb - HSTSUBBITS + 1)*HSTSUBBCKTS + (int) ((val >> (msb - HSTSUBBITS)) & (HSTSUBBCKTS - 1));
+}
+
+int64_t hstbcktmax(int bckt)
+{
+        int msb;
+        if (bckt < HSTSUBBCKTS)
+                return bckt;
+        msb = bckt/HSTSUBBCKTS + HSTSUBBITS - 1;
+        if (msb >= 63)
+                return INT64_MAX;
+        return (int64_t) ((((uint64_t) (HSTSUBBCKTS + bckt%HSTSUBBCKTS + 1)) << (msb - HSTSUBBITS)) - 1);
+}
+
+void updthst(struct ltncyhst_t *hst, int64_t val)
+{
+        if (val < 0)
+                val = 0;
+        rlxdinc(&(hst->bckts[hstbckt(val)]),1);
+        rlxdinc(&(hst->sum),(uint64_t) val);
+        if (val < __atomic_load_n(&(hst->min), __ATOMIC_RELAXED))
+                __atomic_store_n(&(hst->min), val, __ATOMIC_RELAXED);
+        if (val > __atomic_load_n(&(hst->max), __ATOMIC_RELAXED))
+                __atomic_store_n(&(hst->max), val, __ATOMIC_RELAXED);
+        if ((hst->lmt > 0) && (val > hst->lmt))
+                rlxdinc(&(hst->ovrlmt),1);
+        //count is written last, a reader can see a value in a bucket before it is counted but never the other way
+        __atomic_store_n(&(hst->cnt), __atomic_load_n(&(hst->cnt), __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+}
+
+void updtwkuphst(struct ltncyhst_t *hst, const struct timespec *wkuptm)
+{
+        struct timespec curtm;
+        //clock_gettime is served by the vDSO, no system call is made
+        clock_gettime(CLOCK_TAI,&curtm);
+        updthst(hst, (int64_t) (cnvrt_tmspc2int64(&curtm) - cnvrt_tmspc2int64((struct timespec *) wkuptm)));
+}
+
+void snpsthst(const struct ltncyhst_t *hst, struct ltncyhst_t *snpst)
+{
+        uint64_t bcktsum = 0;
+        snpst->cnt = __atomic_load_n(&(hst->cnt), __ATOMIC_ACQUIRE);
+        snpst->sum = __atomic_load_n(&(hst->sum), __ATOMIC_RELAXED);
+        snpst->min = __atomic_load_n(&(hst->min), __ATOMIC_RELAXED);
+        snpst->max = __atomic_load_n(&(hst->max), __ATOMIC_RELAXED);
+        snpst->lmt = hst->lmt;
+        snpst->ovrlmt = __atomic_load_n(&(hst->ovrlmt), __ATOMIC_RELAXED);
+        for (int i = 0; i < HSTBCKTS; i++) {
+                snpst->bckts[i] = __atomic_load_n(&(hst->bckts[i]), __ATOMIC_RELAXED);
+                bcktsum += snpst->bckts[i];
+        }
+        //values added while copying are in the buckets, use them for the count too
+        if (bcktsum > snpst->cnt)
+                snpst->cnt = bcktsum;
+}
+
+int64_t hstprcntl(const struct ltncyhst_t *snpst, double prcnt)
+{
+        uint64_t trgt;
+        uint64_t sum = 0;
+        int64_t bcktmax;
+        if (snpst->cnt == 0)
+                return 0;
+        trgt = (uint64_t) (prcnt/100.0*snpst->cnt + 0.5);
+        if (trgt == 0)
+                trgt = 1;
+        for (int i = 0; i < HSTBCKTS; i++) {
+                sum += snpst->bckts[i];
+                if (sum >= trgt) {
+                        bcktmax = hstbcktmax(i);
+                        return (bcktmax < snpst->max) ? bcktmax : snpst->max;
+                }
+        }
+        return snpst->max;
+}
+
+void prthst(const char *name, const struct ltncyhst_t *snpst)
+{
+        if (snpst->cnt == 0) {
+                printf("%s: no values\n", name);
+                return;
+        }
+        printf("%s: %llu values, min %lld ns, avg %lld ns, max %lld ns\n", name,
+               (unsigned long long) snpst->cnt, (long long) snpst->min,
+               (long long) (snpst->sum/snpst->cnt), (long long) snpst->max);
+        printf("  p50 %lld ns, p90 %lld ns, p99 %lld ns, p99.9 %lld ns, p99.99 %lld ns\n",
+               (long long) hstprcntl(snpst,50.0), (long long) hstprcntl(snpst,90.0),
+               (long long) hstprcntl(snpst,99.0), (long long) hstprcntl(snpst,99.9),
+               (long long) hstprcntl(snpst,99.99));
+        if (snpst->lmt > 0)
+                printf("  %llu values above limit of %lld ns\n",
+                       (unsigned long long) snpst->ovrlmt, (long long) snpst->lmt);
+}
+
+int initstgprf(struct stgprf_t *prf, const char *nms[], const int64_t bdgts[], int cnt)
+{
+        memset(prf,0,sizeof(struct stgprf_t));
+        if ((cnt < 1) || (cnt > MAXSTGS)) {
+                printf("Number of profiled stages must be between 1 and %d.\n", MAXSTGS);
+                return 1;       //fail
+        }
+        for (int i = 0; i < cnt; i++) {
+                prf->nms[i] = nms[i];
+                inithst(&(prf->hsts[i]),bdgts[i]);
+        }
+        prf->cnt = cnt;
+        return 0;       //succeded
+}
+
+uint64_t prftm(void)
+{
+        struct timespec curtm;
+        //not adjusted by NTP/PTP, read through the vDSO without a system call
+        clock_gettime(CLOCK_MONOTONIC_RAW,&curtm);
+        return cnvrt_tmspc2int64(&curtm);
+}
+
+void strtstg(struct stgprf_t *prf)
+{
+        if (prf->cnt == 0)
+                return;
+        prf->strt = prftm();
+}
+
+void endstg(struct stgprf_t *prf, int stg)
+{
+        uint64_t now;
+        if ((stg < 0) || (stg >= prf->cnt))
+                return;
+        now = prftm();
+        updthst(&(prf->hsts[stg]), (int64_t) (now - prf->strt));
+        prf->strt = now;
+}
+
+void prtstgprf(const char *name, const struct stgprf_t *prf)
+{
+        struct ltncyhst_t snpst;
+        if (prf->cnt == 0)
+                return;
+        printf("%s (ns):\n", name);
+        printf("  %-12s %10s %10s %10s %10s %10s %10s %10s\n",
+               "stage", "count", "min", "mean", "p99", "max", "budget", "over");
+        for (int i = 0; i < prf->cnt; i++) {
+                snpsthst(&(prf->hsts[i]),&snpst);
+                if (snpst.cnt == 0) {
+                        printf("  %-12s %10d\n", prf->nms[i], 0);
+                        continue;
+                }
+                printf("  %-12s %10llu %10lld %10lld %10lld %10lld %10lld %10llu\n", prf->nms[i],
+                       (unsigned long long) snpst.cnt, (long long) snpst.min, (long long) (snpst.sum/snpst.cnt),
+                       (long long) hstprcntl(&snpst,99.0), (long long) snpst.max, (long long) snpst.lmt,
+                       (unsigned long long) snpst.ovrlmt);
+        }
+}
+
+void initovrn(struct ovrntrck_t *ovrn, enum ovrnplcy_t plcy)
+{
+        memset(ovrn,0,sizeof(struct ovrntrck_t));
+        ovrn->plcy = plcy;
+}
+
+const char *ovrnplcystr(enum ovrnplcy_t plcy)
+{
+        switch(plcy){
+        case OVRN_SKIP:
+                return "skip";
+        case OVRN_CATCHUP:
+                return "catch up";
+        case OVRN_SAFE:
+                return "safe state";
+        default:
+                return "unknown";
+        }
+}
+
+uint64_t chckovrn(struct ovrntrck_t *ovrn, const struct cycltmln_t *tmln, uint64_t *cycl, int64_t dlnoffs)
+{
+        struct timespec tm;
+        int64_t now;
+        uint64_t nxt;
+        uint64_t mssd;
+
+        clock_gettime(CLOCK_TAI,&tm);
+        now = cnvrt_tmspc2int64(&tm);
+        ovrn->lt = (now >= tmln_tm(tmln,*cycl,dlnoffs));
+        if (!ovrn->lt)
+                return 0;       //in time
+        //first cycle whose deadline is still ahead
+        nxt = tmln_nxtcycl(tmln,now + 1,dlnoffs);
+        if (nxt <= ovrn->nxt)
+                return 0;       //still catching up the cycles of the last overrun
+        if (*cycl >= ovrn->nxt) {
+                //new overrun, otherwise the last overrun got longer while catching up
+                rlxdinc(&(ovrn->ovrns),1);
+                mssd = nxt - *cycl;
+        } else {
+                mssd = nxt - ovrn->nxt;
+        }
+        rlxdinc(&(ovrn->mssd),mssd);
+        if (nxt - *cycl > ovrn->maxmssd)
+                __atomic_store_n(&(ovrn->maxmssd),nxt - *cycl,__ATOMIC_RELAXED);
+        ovrn->nxt = nxt;
+        if (ovrn->plcy == OVRN_SAFE)
+                __atomic_store_n(&(ovrn->safe),true,__ATOMIC_RELAXED);
+        if (ovrn->plcy != OVRN_CATCHUP)
+                *cycl = nxt;
+        return mssd;
+}
+
+void prtovrn(const char *name, const struct ovrntrck_t *ovrn)
+{
+        printf("%s: %llu overruns, %llu missed cycles (at most %llu at once), policy %s%s\n", name,
+               (unsigned long long) __atomic_load_n(&(ovrn->ovrns),__ATOMIC_RELAXED),
+               (unsigned long long) __atomic_load_n(&(ovrn->mssd),__ATOMIC_RELAXED),
+               (unsigned long long) __atomic_load_n(&(ovrn->maxmssd),__ATOMIC_RELAXED),
+               ovrnplcystr(ovrn->plcy), __atomic_load_n(&(ovrn->safe),__ATOMIC_RELAXED) ? ", safe state entered" : "");
+}
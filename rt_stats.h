@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Statistics of the real-time threads which are collected during operation.
+ * A histogram with logarithmic buckets records latencies in nanoseconds, e.g.
+ * how late a thread wakes up after clock_nanosleep. The histogram is written
+ * by exactly one real-time thread without locks, system calls or allocation
+ * and can be read at any time by another (non real-time) thread, which takes
+ * a snapshot of it to calculate percentiles and print it. The overrun
+ * detection checks at the start of each cycle if its deadline already passed
+ * and handles the missed cycles by a policy.
+ */
+
+#ifndef _RTSTATS_H_
+#define _RTSTATS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "time_calc.h"
+
+#define HSTSUBBITS 3                                    //each power of two is split into 2^HSTSUBBITS buckets
+#define HSTSUBBCKTS (1 << HSTSUBBITS)
+#define HSTBCKTS ((63 - HSTSUBBITS + 1)*HSTSUBBCKTS)     //buckets to cover all positive int64 values
+#define MAXSTGS 8                                       //maximum number of profiled stages of a thread
+
+/* latency histogram, written by one thread only */
+struct ltncyhst_t {
+        uint64_t bckts[HSTBCKTS];
+        uint64_t cnt;
+        uint64_t sum;
+        int64_t min;
+        int64_t max;
+        int64_t lmt;            //values above the limit are counted, 0 if no limit is checked
+        uint64_t ovrlmt;
+};
+
+/* profile of the stages of a real-time loop, written by one thread only */
+struct stgprf_t {
+        int cnt;                //number of stages, 0 if profiling is disabled
+        const char *nms[MAXSTGS];
+        struct ltncyhst_t hsts[MAXSTGS];        //duration of each stage, limit is the budget of the stage
+        uint64_t strt;          //start of the current stage
+};
+
+/* policy for the cycles missed by an overrun */
+enum ovrnplcy_t {
+        OVRN_SKIP = 0,          //skip the missed cycles and continue with the next cycle whose deadline is ahead
+        OVRN_CATCHUP,           //run the missed cycles back to back, their frames are not sent
+        OVRN_SAFE,              //go to the safe state and skip the missed cycles
+};
+
+/* overrun detection of a real-time loop, written by one thread only */
+struct ovrntrck_t {
+        enum ovrnplcy_t plcy;
+        uint64_t ovrns;         //overruns, each may miss several cycles
+        uint64_t mssd;          //missed cycles
+        uint64_t maxmssd;       //most cycles missed by one overrun
+        uint64_t nxt;           //first cycle after the missed cycles of the last overrun
+        bool lt;                //deadline of the current cycle already passed
+        bool safe;              //safe state entered, kept till exit
+};
+
+/* initialize histogram with a limit which should not be exceeded (0 for none) */
+void inithst(struct ltncyhst_t *hst, int64_t lmt);
+
+/* add a value in ns to the histogram, negative values are added as 0 */
+void updthst(struct ltncyhst_t *hst, int64_t val);
+
+/* add the latency between a planned wakeup time (CLOCK_TAI) and now */
+void updtwkuphst(struct ltncyhst_t *hst, const struct timespec *wkuptm);
+
+/* copy the histogram while it may be written by another thread */
+void snpsthst(const struct ltncyhst_t *hst, struct ltncyhst_t *snpst);
+
+/* get the index of the bucket of a value */
+int hstbckt(int64_t val);
+
+/* get the largest value which is counted in a bucket */
+int64_t hstbcktmax(int bckt);
+
+/* get the value below which the given percentage of values lie (upper bound of bucket) */
+int64_t hstprcntl(const struct ltncyhst_t *snpst, double prcnt);
+
+/* print summary and percentiles of a histogram snapshot */
+void prthst(const char *name, const struct ltncyhst_t *snpst);
+
+/* initialize the stage profile with names and budgets (0 for none) of the stages */
+int initstgprf(struct stgprf_t *prf, const char *nms[], const int64_t bdgts[], int cnt);
+
+/* get time for the stage profile (CLOCK_MONOTONIC_RAW) in ns */
+uint64_t prftm(void);
+
+/* start a stage now */
+void strtstg(struct stgprf_t *prf);
+
+/* end a stage now and add its duration, the next stage starts now */
+void endstg(struct stgprf_t *prf, int stg);
+
+/* print min, mean, p99, max and budget violations of all stages */
+void prtstgprf(const char *name, const struct stgprf_t *prf);
+
+/* initialize the overrun detection with a policy */
+void initovrn(struct ovrntrck_t *ovrn, enum ovrnplcy_t plcy);
+
+/* get name of a policy */
+const char *ovrnplcystr(enum ovrnplcy_t plcy);
+
+/* check at the start of a cycle if its deadline (offset on the timeline) passed, returns the newly missed cycles and sets the next cycle to run by the policy */
+uint64_t chckovrn(struct ovrntrck_t *ovrn, const struct cycltmln_t *tmln, uint64_t *cycl, int64_t dlnoffs);
+
+/* print the overruns and missed cycles */
+void prtovrn(const char *name, const struct ovrntrck_t *ovrn);
+
+#endif /* _RTSTATS_H_ */
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "slot_ring.h"
+
+/* sequence number at the start of a slot */
+static uint64_t *sltseq(void *slt)
+{
+        return (uint64_t *) slt;
+}
+
+static void *getslt(struct sltring_t *ring, uint64_t pos)
+{
+        return (char *) ring->slts + (pos & (ring->cnt - 1)) * ring->sltsz;
+}
+
+void initsltring(struct sltring_t *ring, void *slts, size_t sltsz, uint64_t cnt)
+{
+        memset(ring,0,sizeof(struct sltring_t));
+        ring->slts = slts;
+        ring->sltsz = sltsz;
+        ring->cnt = cnt;
+        for (uint64_t i = 0; i < cnt; i++)
+                *sltseq(getslt(ring,i)) = i;
+}
+
+void *clmslt(struct sltring_t *ring, uint64_t *pos)
+{
+        void *slt;
+        int64_t dif;
+
+        *pos = __atomic_load_n(&(ring->head), __ATOMIC_RELAXED);
+        while (true) {
+                slt = getslt(ring,*pos);
+                dif = (int64_t) (__atomic_load_n(sltseq(slt), __ATOMIC_ACQUIRE) - *pos);
+                if (dif == 0) {
+                        //slot is free, claim it
+                        if (__atomic_compare_exchange_n(&(ring->head), pos, *pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                                return slt;
+                } else if (dif < 0) {
+                        //slot not read yet, ring is full
+                        __atomic_fetch_add(&(ring->drpd), 1, __ATOMIC_RELAXED);
+                        return NULL;
+                } else {
+                        *pos = __atomic_load_n(&(ring->head), __ATOMIC_RELAXED);
+                }
+        }
+}
+
+void pblslt(void *slt, uint64_t pos)
+{
+        __atomic_store_n(sltseq(slt), pos + 1, __ATOMIC_RELEASE);
+}
+
+void *nxtslt(struct sltring_t *ring)
+{
+        void *slt = getslt(ring,ring->tail);
+
+        if (__atomic_load_n(sltseq(slt), __ATOMIC_ACQUIRE) != ring->tail + 1)
+                return NULL;    //no further slot
+        return slt;
+}
+
+void rlsslt(struct sltring_t *ring, void *slt)
+{
+        //the slot is free again in the next round
+        __atomic_store_n(sltseq(slt), ring->tail + ring->cnt, __ATOMIC_RELEASE);
+        ring->tail++;
+}
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Lock-free ring of preallocated slots with several writing threads and one
+ * reading thread, used by the real-time logging and the frame capture. A
+ * writing thread claims a slot with an atomic compare-and-swap of the write
+ * position, fills it and hands it to the reading thread with the sequence
+ * number of the slot. The reading thread copies a slot and hands it back for
+ * the next round. If the ring is full, the slot is not claimed and counted as
+ * dropped, a writing thread never waits.
+ */
+
+#ifndef _SLOTRING_H_
+#define _SLOTRING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* ring over the slots of the user, each slot starts with its uint64_t sequence number */
+struct sltring_t {
+        void *slts;
+        size_t sltsz;                   //size of a slot in bytes
+        uint64_t cnt;                   //number of slots, power of 2
+        uint64_t head __attribute__((aligned(64)));     //next slot to write, shared by the writing threads
+        uint64_t tail __attribute__((aligned(64)));     //next slot to read, only used by the reading thread
+        uint64_t drpd;                  //slots not claimed because the ring was full
+};
+
+/* initialize the ring over cnt slots of sltsz bytes */
+void initsltring(struct sltring_t *ring, void *slts, size_t sltsz, uint64_t cnt);
+
+/* claim a slot from any thread and return its position in pos; returns NULL if the ring is full */
+void *clmslt(struct sltring_t *ring, uint64_t *pos);
+
+/* hand a filled slot claimed at pos to the reading thread */
+void pblslt(void *slt, uint64_t pos);
+
+/* next filled slot, only called by the reading thread; returns NULL if there is none */
+void *nxtslt(struct sltring_t *ring);
+
+/* hand the slot returned by nxtslt back to the writing threads, only called by the reading thread */
+void rlsslt(struct sltring_t *ring, void *slt);
+
+#endif /* _SLOTRING_H_ */
@@ -0,0 +1,191 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Test of the capture tap. A sending and a receiving thread capture frames at
+ * the same time while the writer thread writes them, the frames are pushed in
+ * bursts, so some of them may be dropped. The pcapng file is read back: each
+ * frame must be written once with its direction, length and timestamp, the
+ * frames of each thread in their order, and written and dropped frames must
+ * add up. Sent frames must get the Ethernet header built from the address and
+ * a frame longer than the snap length must be truncated. A frame captured
+ * while the tap is not active must not be written.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <net/ethernet.h>
+#include "../pcap_tap.h"
+
+#define FRMS 20000
+#define BRST 200
+#define PYLDLEN 100
+#define ETHTYP 0xB62C
+#define LNGLEN 400
+
+static struct captap_t tap;
+static struct sockaddr_ll addr;
+
+static void *sndr(void *arg)
+{
+        uint8_t pyld[PYLDLEN];
+        (void) arg;
+        memset(pyld,0xAA,sizeof(pyld));
+        for (uint32_t i = 0; i < FRMS; i++) {
+                memcpy(pyld,&i,sizeof(i));
+                captx(&addr,pyld,sizeof(pyld),1000000000ULL + i);
+                if ((i % BRST) == 0)
+                        usleep(1000);
+        }
+        return NULL;
+}
+
+static void *rcvr(void *arg)
+{
+        uint8_t frm[ETH_HLEN + PYLDLEN];
+        (void) arg;
+        memset(frm,0x55,sizeof(frm));
+        for (uint32_t i = 0; i < FRMS; i++) {
+                memcpy(&(frm[ETH_HLEN]),&i,sizeof(i));
+                caprx(frm,sizeof(frm),2000000000ULL + i,(i & 1) != 0);
+                if ((i % BRST) == 0)
+                        usleep(1000);
+        }
+        return NULL;
+}
+
+/* reads the blocks of the file and checks the frames, returns the number of frames or -1 */
+static int rdcap(const char *flnm, uint64_t *drpd)
+{
+        FILE *fl;
+        uint8_t blk[1024];
+        uint32_t hdr[2];
+        uint32_t epb[5];
+        uint32_t cnt[2] = {0, 0};
+        int64_t lst[2] = {-1, -1};
+        uint32_t idx;
+        uint64_t ts;
+        uint16_t flgs;
+        int tx;
+        int frms = 0;
+        bool lng = false;
+        struct ether_header *ethhdr;
+
+        fl = fopen(flnm,"rb");
+        if (NULL == fl)
+                return -1;
+        *drpd = UINT64_MAX;
+        while (fread(hdr,sizeof(hdr),1,fl) == 1) {
+                if ((hdr[1] < 12) || (hdr[1] > sizeof(blk)) || (hdr[1] & 3) ||
+                    (fread(blk,hdr[1] - 8,1,fl) != 1)) {
+                        printf("Block length %u wrong.\n", hdr[1]);
+                        fclose(fl);
+                        return -1;
+                }
+                if (hdr[0] == 5) {
+                        //statistics with the dropped frames as option 7 after the comment
+                        for (uint32_t pos = 12; pos + 4 <= hdr[1] - 12; ) {
+                                uint16_t code = blk[pos] | (blk[pos+1] << 8);
+                                uint16_t len = blk[pos+2] | (blk[pos+3] << 8);
+                                if (code == 7)
+                                        memcpy(drpd,&(blk[pos+4]),sizeof(*drpd));
+                                pos += 4 + ((len + 3) & ~3);
+                        }
+                        continue;
+                }
+                if (hdr[0] != 6)
+                        continue;
+                memcpy(epb,blk,sizeof(epb));
+                memcpy(&flgs,&(blk[20 + ((epb[3] + 3) & ~3) + 4]),sizeof(flgs));
+                tx = (flgs == 2);
+                if (epb[4] == LNGLEN) {
+                        //the long frame is truncated and not counted
+                        lng = (epb[3] == CAPTAP_SNPLEN) && tx;
+                        continue;
+                }
+                if ((epb[3] != ETH_HLEN + PYLDLEN) || (epb[4] != ETH_HLEN + PYLDLEN) || (!tx && (flgs != 1))) {
+                        printf("Frame %d has wrong length or direction.\n", frms);
+                        fclose(fl);
+                        return -1;
+                }
+                memcpy(&idx,&(blk[20 + ETH_HLEN]),sizeof(idx));
+                ethhdr = (struct ether_header *) &(blk[20]);
+                ts = ((uint64_t) epb[1] << 32) | epb[2];
+                //sent frames at the TxTime, received frames when captured
+                if (((int64_t) idx <= lst[tx]) || (tx && (ts != 1000000000ULL + idx)) || (!tx && (ts < 2000000000ULL)) ||
+                    (tx && ((ethhdr->ether_type != htons(ETHTYP)) || (memcmp(ethhdr->ether_dhost,addr.sll_addr,ETH_ALEN) != 0)))) {
+                        printf("Frame %d of %s thread wrong.\n", idx, tx ? "sending" : "receiving");
+                        fclose(fl);
+                        return -1;
+                }
+                lst[tx] = idx;
+                cnt[tx]++;
+                frms++;
+        }
+        fclose(fl);
+        if (!lng) {
+                printf("Long frame not truncated.\n");
+                return -1;
+        }
+        printf("%u sent and %u received frames read.\n", cnt[1], cnt[0]);
+        return frms;
+}
+
+int main(void)
+{
+        pthread_t thrds[2];
+        uint8_t lngfrm[LNGLEN];
+        uint8_t mac[ETH_ALEN] = {0x01, 0xAC, 0xCE, 0x55, 0x00, 0x01};
+        char flnm[64];
+        uint64_t drpd;
+        int frms;
+
+        //disabled tap accepts all calls
+        initcaptap(&tap,NULL,"lo");
+        if (strtcaptap(&tap) != 0)
+                return 1;
+        stpcaptap(&tap);
+
+        snprintf(flnm,sizeof(flnm),"/tmp/cap_test_%d.pcapng",(int) getpid());
+        if (initcaptap(&tap,flnm,"lo") != 0)
+                return 1;
+        memset(&addr,0,sizeof(addr));
+        addr.sll_family = AF_PACKET;
+        addr.sll_protocol = htons(ETHTYP);
+        addr.sll_halen = ETH_ALEN;
+        memcpy(addr.sll_addr,mac,ETH_ALEN);
+        memset(lngfrm,0,sizeof(lngfrm));
+        //not active yet, must not be written
+        caprx(lngfrm,ETH_HLEN + PYLDLEN,0,false);
+        if (strtcaptap(&tap) != 0)
+                return 1;
+        captx(&addr,lngfrm,LNGLEN - ETH_HLEN,0);
+        pthread_create(&(thrds[0]),NULL,sndr,NULL);
+        pthread_create(&(thrds[1]),NULL,rcvr,NULL);
+        pthread_join(thrds[0],NULL);
+        pthread_join(thrds[1],NULL);
+        stpcaptap(&tap);
+        //stopped, must not be written
+        caprx(lngfrm,ETH_HLEN + PYLDLEN,0,false);
+
+        frms = rdcap(flnm,&drpd);
+        unlink(flnm);
+        if (frms < 0)
+                return 1;
+        if ((drpd != tap.ring.drpd) || ((uint64_t) frms + drpd != 2*FRMS) || (tap.wrttn != (uint64_t) frms + 1)) {
+                printf("%d frames written, %llu dropped, %llu in statistics, expected %d.\n", frms,
+                       (unsigned long long) tap.ring.drpd, (unsigned long long) drpd, 2*FRMS);
+                return 1;
+        }
+
+        printf("Capture tap test passed.\n");
+        return 0;
+}
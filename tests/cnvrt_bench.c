@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Test and microbenchmark of the batch conversion of doubles to big endian
+ * nano-unit int64 values and back (dbls2nbe64, nbe642dbls). For each
+ * instruction set supported by the cpu the results are first compared bit by
+ * bit with the scalar functions (dbl2nint64/htobe64 and be64toh/nint642dbl),
+ * including values out of range and values which need the scalar fallback.
+ * Then the time per value is measured for different numbers of values.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include "../packet_handler.h"
+
+#define ITERATIONS 1000000
+#define MAXVALS 1024
+
+/* Print usage message */
+static void usage(char *appname)
+{
+        fprintf(stderr,
+                "\n"
+                "Usage: %s [options]\n"
+                " -n [value]           Number of iterations for 4 values (scaled for other counts). Default 1000000.\n"
+                " -h                   Prints this help message and exits\n"
+                "\n",
+                appname);
+}
+
+static uint64_t gettm_ns(void)
+{
+        struct timespec tm;
+        clock_gettime(CLOCK_MONOTONIC_RAW,&tm);
+        return cnvrt_tmspc2int64(&tm);
+}
+
+static const char *isanms[3] = {"scalar", "SSE4.1", "AVX2"};
+
+/* reference: one value at a time as in the codec before */
+static int ref_dbls2nbe64(const double vals[], int64_t res[], int cnt)
+{
+        int64_t tmp;
+        int ok = 0;
+        for (int i = 0; i < cnt; i++) {
+                tmp = 0;
+                ok |= dbl2nint64(vals[i],&tmp);
+                res[i] = htobe64(tmp);
+        }
+        return ok;
+}
+
+static void ref_nbe642dbls(const int64_t vals[], double res[], int cnt)
+{
+        for (int i = 0; i < cnt; i++)
+                res[i] = nint642dbl(be64toh(vals[i]));
+}
+
+/* compares the batch conversion with the reference for all counts up to cnt */
+static int chckcnvrt(double vals[], int cnt)
+{
+        int64_t refn[MAXVALS + 1], n[MAXVALS + 1];
+        double refd[MAXVALS + 1], d[MAXVALS + 1];
+        for (int c = 0; c <= cnt; c++) {
+                //offset by one value to test unaligned access
+                if (ref_dbls2nbe64(vals,refn,c) != dbls2nbe64(vals,&(n[1]),c))
+                        return 1;       //fail
+                if (memcmp(refn,&(n[1]),c*sizeof(int64_t)) != 0)
+                        return 1;       //fail
+                ref_nbe642dbls(refn,refd,c);
+                memcpy(&(n[1]),refn,c*sizeof(int64_t));
+                nbe642dbls(&(n[1]),d,c);
+                if (memcmp(refd,d,c*sizeof(double)) != 0)
+                        return 1;       //fail
+        }
+        return 0;
+}
+
+int main(int argc, char* argv[])
+{
+        int c;
+        uint32_t iters = ITERATIONS;
+        uint32_t cntiters;
+        static double vals[MAXVALS];
+        static int64_t nvals[MAXVALS + 1];
+        static double dvals[MAXVALS];
+        const int cnts[4] = {1, 4, 64, MAXVALS};
+        const double edgvals[10] = {0.0, -0.0, 1e-10, -1.5e-9, 2251799.813685247, -2251799.813685248,
+                                    2251799.9, -9.2e9, 1e300, NAN};
+        volatile int sink = 0;
+        uint64_t strt;
+        uint64_t rf_ns, enc_ns, dec_ns;
+
+        while (EOF != (c = getopt(argc,argv,"hn:"))) {
+                switch(c) {
+                case 'n':
+                        iters = atoi(optarg);
+                        break;
+                case 'h':
+                default:
+                        usage(argv[0]);
+                        exit(0);
+                        break;
+                }
+        }
+        if (iters == 0)
+                iters = ITERATIONS;
+
+        //random positions and velocities, some values in between which need the scalar fallback or are out of range
+        srand(1);
+        for (int i = 0; i < MAXVALS; i++)
+                vals[i] = ((double) rand()/RAND_MAX - 0.5)*2000.0;
+        for (int i = 0; i < 10; i++)
+                vals[37*i + 3] = edgvals[i];
+
+        for (int isa = CNVRT_SCALAR; isa <= CNVRT_AVX2; isa++) {
+                if (setcnvrtisa(isa) != 0) {
+                        printf("%s not supported by the cpu.\n",isanms[isa]);
+                        continue;
+                }
+                if (chckcnvrt(vals,MAXVALS) != 0) {
+                        printf("%s: results differ from the scalar conversion.\n",isanms[isa]);
+                        return 1;
+                }
+        }
+
+        //measure with values in range only
+        for (int i = 0; i < 10; i++)
+                vals[37*i + 3] = i;
+        printf("Conversion of values, time per value (reference: one value at a time):\n");
+        for (int k = 0; k < 4; k++) {
+                cntiters = (uint64_t) iters*4/cnts[k];
+                if (cntiters == 0)
+                        cntiters = 1;
+                strt = gettm_ns();
+                for (uint32_t i = 0; i < cntiters; i++) {
+                        sink += ref_dbls2nbe64(vals,nvals,cnts[k]);
+                        ref_nbe642dbls(nvals,dvals,cnts[k]);
+                }
+                rf_ns = gettm_ns() - strt;
+                printf("  %4d values: reference %6.2f ns",cnts[k],(double) rf_ns/cntiters/cnts[k]);
+                for (int isa = CNVRT_SCALAR; isa <= CNVRT_AVX2; isa++) {
+                        if (setcnvrtisa(isa) != 0)
+                                continue;
+                        strt = gettm_ns();
+                        for (uint32_t i = 0; i < cntiters; i++)
+                                sink += dbls2nbe64(vals,nvals,cnts[k]);
+                        enc_ns = gettm_ns() - strt;
+                        strt = gettm_ns();
+                        for (uint32_t i = 0; i < cntiters; i++)
+                                nbe642dbls(nvals,dvals,cnts[k]);
+                        dec_ns = gettm_ns() - strt;
+                        printf(", %s %6.2f ns",isanms[isa],(double) (enc_ns + dec_ns)/cntiters/cnts[k]);
+                }
+                printf("\n");
+        }
+        return sink;
+}
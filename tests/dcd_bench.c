@@ -0,0 +1,280 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Microbenchmark for the decoding of received frames. Compares the chain of
+ * chckethhdr, prspkt, chckpkthdrs, prsdtstmsg and prscntrlmsg/prsaxsmsg
+ * (as used by the applications before) with the fused decoders dcdcntrlfrm
+ * and dcdaxsfrm for a control frame, an axis frame and a frame with four
+ * combined axes. Before measuring, the results of both paths are compared and
+ * some corrupted frames are checked to be rejected by the fused decoders.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include "../packet_handler.h"
+
+#define ITERATIONS 10000000
+
+/* Print usage message */
+static void usage(char *appname)
+{
+        fprintf(stderr,
+                "\n"
+                "Usage: %s [options]\n"
+                " -n [value]           Number of iterations. Default 10000000.\n"
+                " -h                   Prints this help message and exits\n"
+                "\n",
+                appname);
+}
+
+static uint64_t gettm_ns(void)
+{
+        struct timespec tm;
+        clock_gettime(CLOCK_MONOTONIC_RAW,&tm);
+        return cnvrt_tmspc2int64(&tm);
+}
+
+static char macs[5][ETH_ALEN] = {
+        {0x01,0xAC,0xCE,0x55,0x00,0x00},
+        {0x01,0xAC,0xCE,0x55,0x00,0x01},
+        {0x01,0xAC,0xCE,0x55,0x00,0x02},
+        {0x01,0xAC,0xCE,0x55,0x00,0x03},
+        {0x01,0xAC,0xCE,0x55,0x00,0x04}};
+static char *cntrlmacs[1] = {macs[0]};
+static char *axsmacs[4] = {macs[1],macs[2],macs[3],macs[4]};
+
+/* builds a received frame (with Ethernet header) from a filled packet, unpadded like on lo, veth or AF_XDP */
+static void bldfrm(struct rt_pkt_t *rcvd, struct rt_pkt_t *snd, char *dstmac)
+{
+        struct eth_hdr_t *ethhdr = (struct eth_hdr_t *) rcvd->sktbf;
+        memset(rcvd->sktbf,0,MAXPKTSZ);
+        memcpy(ethhdr->dstmac,dstmac,ETH_ALEN);
+        memset(ethhdr->srcmac,0x02,ETH_ALEN);
+        ethhdr->ethtyp = htons(ETHERTYPE);
+        memcpy(rcvd->sktbf + sizeof(struct eth_hdr_t),snd->sktbf,snd->len);
+        rcvd->len = sizeof(struct eth_hdr_t) + snd->len;
+}
+
+/* chain of the single parse functions for a control frame */
+static int chain_cntrl(struct rt_pkt_t *pkt, struct cntrlnfo_t *cntrlnfo)
+{
+        enum msgtyp_t msgtyp;
+        union dtstmsg_t *dtstmsgs[MAXDTSTMSGS];
+        int dtstmsgcnt;
+        if (chckethhdr(pkt,cntrlmacs,1) == -1)
+                return 1;       //fail
+        if ((prspkt(pkt,&msgtyp) == -1) || (msgtyp != CNTRL))
+                return 1;       //fail
+        if (chckpkthdrs(pkt) != 0)
+                return 1;       //fail
+        if (prsdtstmsg(pkt,msgtyp,dtstmsgs,&dtstmsgcnt) != 0)
+                return 1;       //fail
+        return prscntrlmsg(dtstmsgs[0],cntrlnfo);
+}
+
+/* chain of the single parse functions for an axis frame */
+static int chain_axs(struct rt_pkt_t *pkt, struct axsnfo_t axsnfos[], int *axscnt)
+{
+        enum msgtyp_t msgtyp;
+        union dtstmsg_t *dtstmsgs[MAXDTSTMSGS];
+        int dtstmsgcnt;
+        int rcvmac;
+        int axs;
+        *axscnt = 0;
+        rcvmac = chckethhdr(pkt,axsmacs,4);
+        if (rcvmac == -1)
+                return 1;       //fail
+        if ((prspkt(pkt,&msgtyp) == -1) || (msgtyp != AXS))
+                return 1;       //fail
+        if (chckpkthdrs(pkt) != 0)
+                return 1;       //fail
+        if (prsdtstmsg(pkt,msgtyp,dtstmsgs,&dtstmsgcnt) != 0)
+                return 1;       //fail
+        for (int i = 0; i < dtstmsgcnt; i++) {
+                if (prsaxsmsg(dtstmsgs[i],&(axsnfos[i])) != 0)
+                        return 1;       //fail
+                axs = prswrtrid(pkt,i);
+                if ((axs == -1) && (dtstmsgcnt == 1))
+                        axs = rcvmac;
+                axsnfos[i].axsID = axs;
+        }
+        *axscnt = dtstmsgcnt;
+        return 0;
+}
+
+/* compares the results of both paths and checks the rejection of corrupted frames */
+static int chckdcd(struct rt_pkt_t *cntrlfrm, struct rt_pkt_t *axsfrm, struct rt_pkt_t *cmbfrm)
+{
+        struct cntrlnfo_t chncntrl, dcdcntrl;
+        struct axsnfo_t chnaxs[MAXDTSTMSGS], dcdaxs[MAXDTSTMSGS];
+        int chncnt, dcdcnt;
+        struct rt_pkt_t *axsfrms[2] = {axsfrm, cmbfrm};
+        unsigned char sav;
+        uint32_t len = axsfrm->len;
+        /* length of the axis frame, expected error: unpadded (lo, veth, AF_XDP), padded, partly padded */
+        const uint32_t axslens[3] = {len, ETH_ZLEN, len + 1};
+        const enum dcderr_t axserr[3] = {DCD_OK, DCD_OK, DCD_LEN};
+        /* byte offset, expected error: ethertype, flags, writer group, group version, message count, writer id, fieldcount, destination */
+        const int crrptoffs[8] = {13, 14, 20, 24, 27, 29, 40, 5};
+        const enum dcderr_t crrpterr[8] = {DCD_HDR, DCD_HDR, DCD_HDR, DCD_HDR, DCD_MSGCNT, DCD_WRTRID, DCD_DTSTMSG, DCD_MAC};
+
+        memset(&chncntrl,0,sizeof(struct cntrlnfo_t));
+        memset(&dcdcntrl,0,sizeof(struct cntrlnfo_t));
+        if ((chain_cntrl(cntrlfrm,&chncntrl) != 0) || (dcdcntrlfrm(cntrlfrm,cntrlmacs,1,&dcdcntrl) != DCD_OK) || (memcmp(&chncntrl,&dcdcntrl,sizeof(struct cntrlnfo_t)) != 0)) {
+                printf("Decoding of control frame differs.\n");
+                return 1;       //fail
+        }
+        for (int f = 0; f < 2; f++) {
+                memset(chnaxs,0,sizeof(chnaxs));
+                memset(dcdaxs,0,sizeof(dcdaxs));
+                if ((chain_axs(axsfrms[f],chnaxs,&chncnt) != 0) || (dcdaxsfrm(axsfrms[f],axsmacs,4,dcdaxs,&dcdcnt) != DCD_OK) ||
+                    (chncnt != dcdcnt) || (memcmp(chnaxs,dcdaxs,sizeof(chnaxs)) != 0)) {
+                        printf("Decoding of axis frame %d differs.\n",f);
+                        return 1;       //fail
+                }
+        }
+        for (int i = 0; i < 3; i++) {
+                axsfrm->len = axslens[i];
+                memset(chnaxs,0,sizeof(chnaxs));
+                memset(dcdaxs,0,sizeof(dcdaxs));
+                if ((dcdaxsfrm(axsfrm,axsmacs,4,dcdaxs,&dcdcnt) != axserr[i]) ||
+                    ((axserr[i] == DCD_OK) && ((chain_axs(axsfrm,chnaxs,&chncnt) != 0) || (chncnt != dcdcnt) || (memcmp(chnaxs,dcdaxs,sizeof(chnaxs)) != 0)))) {
+                        printf("Decoding of axis frame with %u bytes wrong.\n",axslens[i]);
+                        return 1;       //fail
+                }
+        }
+        axsfrm->len = len;
+        for (int i = 0; i < 8; i++) {
+                sav = cntrlfrm->sktbf[crrptoffs[i]];
+                cntrlfrm->sktbf[crrptoffs[i]] ^= 0x40;
+                if (dcdcntrlfrm(cntrlfrm,cntrlmacs,1,&dcdcntrl) != crrpterr[i]) {
+                        printf("Corrupted byte %d of control frame not detected.\n",crrptoffs[i]);
+                        return 1;       //fail
+                }
+                cntrlfrm->sktbf[crrptoffs[i]] = sav;
+        }
+        cntrlfrm->len--;
+        if (dcdcntrlfrm(cntrlfrm,cntrlmacs,1,&dcdcntrl) != DCD_LEN) {
+                printf("Wrong length of control frame not detected.\n");
+                return 1;       //fail
+        }
+        cntrlfrm->len++;
+        cmbfrm->len--;
+        if (dcdaxsfrm(cmbfrm,axsmacs,4,dcdaxs,&dcdcnt) != DCD_LEN) {
+                printf("Wrong length of combined axis frame not detected.\n");
+                return 1;       //fail
+        }
+        cmbfrm->len++;
+        return 0;
+}
+
+static void prntrslt(char *name, uint64_t chn_ns, uint64_t dcd_ns, uint32_t iters)
+{
+        printf("  %-22s chain %6.1f ns/frame, fused %6.1f ns/frame\n",name,(double) chn_ns/iters,(double) dcd_ns/iters);
+}
+
+int main(int argc, char* argv[])
+{
+        int c;
+        uint32_t iters = ITERATIONS;
+        struct rt_pkt_t *snd;
+        struct rt_pkt_t *cntrlfrm;
+        struct rt_pkt_t *axsfrm;
+        struct rt_pkt_t *cmbfrm;
+        struct cntrlnfo_t cntrlnfo;
+        struct axsnfo_t axsnfos[MAXDTSTMSGS];
+        int axscnt;
+        volatile int sink = 0;
+        uint64_t strt;
+        uint64_t chn_ns;
+        uint64_t dcd_ns;
+
+        while (EOF != (c = getopt(argc,argv,"hn:"))) {
+                switch(c) {
+                case 'n':
+                        iters = atoi(optarg);
+                        break;
+                case 'h':
+                default:
+                        usage(argv[0]);
+                        exit(0);
+                        break;
+                }
+        }
+        if (iters == 0)
+                iters = ITERATIONS;
+
+        if ((createpkt(&snd) != 0) || (createpkt(&cntrlfrm) != 0) || (createpkt(&axsfrm) != 0) || (createpkt(&cmbfrm) != 0)) {
+                printf("Allocation of packets failed.\n");
+                return 1;
+        }
+        memset(&cntrlnfo,0,sizeof(struct cntrlnfo_t));
+        cntrlnfo.x_set.cntrlvl = 1.5;
+        cntrlnfo.x_set.cntrlsw = 1;
+        cntrlnfo.s_set.cntrlvl = -200.25;
+        cntrlnfo.machinestatus = true;
+        setpkt(snd,1,CNTRL,0xAC00);
+        fillcntrlpkt(snd,&cntrlnfo,7);
+        bldfrm(cntrlfrm,snd,macs[0]);
+        for (int i = 0; i < MAXDTSTMSGS; i++) {
+                memset(&(axsnfos[i]),0,sizeof(struct axsnfo_t));
+                axsnfos[i].axsID = i;
+                axsnfos[i].cntrlvl = 10.125*(i+1);
+                axsnfos[i].cntrlsw = i & 1;
+        }
+        setpkt(snd,1,AXS,0xAC0A);
+        fillaxspkt(snd,&(axsnfos[1]),7);
+        bldfrm(axsfrm,snd,macs[2]);
+        setpkt(snd,MAXDTSTMSGS,AXS,0xAC0A);
+        fillaxspkts(snd,axsnfos,MAXDTSTMSGS,7);
+        bldfrm(cmbfrm,snd,macs[1]);
+
+        if (chckdcd(cntrlfrm,axsfrm,cmbfrm) != 0)
+                return 1;
+
+        printf("Decoding of received frames, %u iterations:\n",iters);
+        strt = gettm_ns();
+        for (uint32_t i = 0; i < iters; i++)
+                sink += chain_cntrl(cntrlfrm,&cntrlnfo);
+        chn_ns = gettm_ns() - strt;
+        strt = gettm_ns();
+        for (uint32_t i = 0; i < iters; i++)
+                sink += dcdcntrlfrm(cntrlfrm,cntrlmacs,1,&cntrlnfo);
+        dcd_ns = gettm_ns() - strt;
+        prntrslt("control frame:",chn_ns,dcd_ns,iters);
+
+        strt = gettm_ns();
+        for (uint32_t i = 0; i < iters; i++)
+                sink += chain_axs(axsfrm,axsnfos,&axscnt);
+        chn_ns = gettm_ns() - strt;
+        strt = gettm_ns();
+        for (uint32_t i = 0; i < iters; i++)
+                sink += dcdaxsfrm(axsfrm,axsmacs,4,axsnfos,&axscnt);
+        dcd_ns = gettm_ns() - strt;
+        prntrslt("axis frame:",chn_ns,dcd_ns,iters);
+
+        strt = gettm_ns();
+        for (uint32_t i = 0; i < iters; i++)
+                sink += chain_axs(cmbfrm,axsnfos,&axscnt);
+        chn_ns = gettm_ns() - strt;
+        strt = gettm_ns();
+        for (uint32_t i = 0; i < iters; i++)
+                sink += dcdaxsfrm(cmbfrm,axsmacs,4,axsnfos,&axscnt);
+        dcd_ns = gettm_ns() - strt;
+        prntrslt("combined axes frame:",chn_ns,dcd_ns,iters);
+
+        destroypkt(snd);
+        destroypkt(cntrlfrm);
+        destroypkt(axsfrm);
+        destroypkt(cmbfrm);
+        return sink;
+}
@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Test of the flight recorder. Cycles are recorded without sleeping, a
+ * sequence gap is triggered after the buffer wrapped and a late wake up is
+ * simulated after the first dump was written. Both dump files are read back
+ * and must contain the cycles till FLTRCRD_PSTCYCLS cycles after the trigger
+ * in their order. A disabled recorder must accept all calls.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "../flt_recorder.h"
+
+#define TRGCYCL1 1500
+#define TRGCYCL2 1800
+#define CYCLS (TRGCYCL2 + FLTRCRD_PSTCYCLS + 1)
+
+static struct fltrcrdr_t rcrdr;
+static struct fltrcrd_t rcrds[FLTRCRD_CYCLS];
+
+/* reads a dump and checks the order of the cycles, returns the number of records or -1 */
+static int rddmp(const char *flnm, struct fltdmphdr_t *hdr)
+{
+        FILE *fl;
+        int cnt;
+
+        fl = fopen(flnm,"rb");
+        if (NULL == fl) {
+                printf("Dump %s missing.\n", flnm);
+                return -1;
+        }
+        if ((fread(hdr,sizeof(struct fltdmphdr_t),1,fl) != 1) || (hdr->magic != FLTRCRD_MAGIC) ||
+            (hdr->vrsn != FLTRCRD_VRSN) || (hdr->rcrdsz != sizeof(struct fltrcrd_t)) || (hdr->cnt > FLTRCRD_CYCLS)) {
+                printf("Header of dump %s wrong.\n", flnm);
+                fclose(fl);
+                return -1;
+        }
+        cnt = fread(rcrds,sizeof(struct fltrcrd_t),hdr->cnt,fl);
+        fclose(fl);
+        if (cnt != (int) hdr->cnt)
+                return -1;
+        for (int i = 0; i < cnt; i++) {
+                if (((i > 0) && (rcrds[i].cycl != rcrds[i-1].cycl + 1)) || (rcrds[i].vals[0] != (int64_t) rcrds[i].cycl*10)) {
+                        printf("Records of dump %s wrong at %d.\n", flnm, i);
+                        return -1;
+                }
+        }
+        return cnt;
+}
+
+int main(void)
+{
+        struct fltrcrd_t *rcrd;
+        struct fltdmphdr_t hdr;
+        struct timespec plnd;
+        char path[64];
+        char flnm[128];
+        int cnt;
+
+        //disabled recorder, the records go to the scratch record
+        initfltrcrdr(&rcrdr,"test",NULL,1000);
+        if (strtfltrcrdr(&rcrdr) != 0)
+                return 1;
+        rcrd = strtfltcycl(&rcrdr,0,&plnd);
+        rcrd->vals[0] = 1;
+        trgfltrcrdr(&rcrdr,FLTTRG_SEQGAP);
+        clsfltrcrdr(&rcrdr);
+
+        snprintf(path,sizeof(path),"/tmp/flt_test_%d",(int) getpid());
+        //only the simulated late wake up exceeds the limit
+        if (initfltrcrdr(&rcrdr,"test",path,1000000000) != 0)
+                return 1;
+        if (strtfltrcrdr(&rcrdr) != 0)
+                return 1;
+        for (uint64_t cycl = 0; cycl < CYCLS; cycl++) {
+                clock_gettime(CLOCK_TAI,&plnd);
+                if (cycl == TRGCYCL2) {
+                        //wait till the first dump is written
+                        while (__atomic_load_n(&(rcrdr.dmps), __ATOMIC_RELAXED) == 0)
+                                usleep(1000);
+                        plnd.tv_sec -= 2;
+                }
+                rcrd = strtfltcycl(&rcrdr,cycl,&plnd);
+                rcrd->vals[0] = cycl*10;
+                if (cycl == TRGCYCL1)
+                        trgfltrcrdr(&rcrdr,FLTTRG_SEQGAP);
+        }
+        //next cycle hands the buffer over
+        strtfltcycl(&rcrdr,CYCLS,&plnd);
+        clsfltrcrdr(&rcrdr);
+
+        //first dump: the whole buffer till the cycles after the sequence gap
+        snprintf(flnm,sizeof(flnm),"%s_test_0.bin",path);
+        cnt = rddmp(flnm,&hdr);
+        unlink(flnm);
+        if ((cnt != FLTRCRD_CYCLS) || (hdr.trgs != FLTTRG_SEQGAP) || (hdr.trgcycl != TRGCYCL1) ||
+            (rcrds[cnt-1].cycl != TRGCYCL1 + FLTRCRD_PSTCYCLS) ||
+            (rcrds[cnt-1-FLTRCRD_PSTCYCLS].trgs != FLTTRG_SEQGAP)) {
+                printf("First dump wrong.\n");
+                return 1;
+        }
+        //second dump: the cycles since the first dump till the cycles after the late wake up
+        snprintf(flnm,sizeof(flnm),"%s_test_1.bin",path);
+        cnt = rddmp(flnm,&hdr);
+        unlink(flnm);
+        if ((cnt != TRGCYCL2 - TRGCYCL1) || (hdr.trgs != FLTTRG_LATEWKUP) || (hdr.trgcycl != TRGCYCL2) ||
+            (rcrds[0].cycl != TRGCYCL1 + FLTRCRD_PSTCYCLS + 1) || (rcrds[cnt-1].cycl != TRGCYCL2 + FLTRCRD_PSTCYCLS) ||
+            (rcrds[cnt-1-FLTRCRD_PSTCYCLS].wkup - rcrds[cnt-1-FLTRCRD_PSTCYCLS].plndwkup < 2000000000)) {
+                printf("Second dump wrong.\n");
+                return 1;
+        }
+        if (rcrdr.mssd != 0) {
+                printf("Triggers not dumped.\n");
+                return 1;
+        }
+
+        printf("Flight recorder test passed.\n");
+        return 0;
+}
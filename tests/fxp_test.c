@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Test of the fixed-point mode of the axis simulation and the codec. An axis
+ * is simulated with the same set velocity profile in floating point and in
+ * fixed-point; the positions must not differ by more than the tolerance. The
+ * fixed-point run is repeated and must give the same trajectory bit by bit,
+ * its checksum is printed to compare the results of different machines.
+ * Finally the set values of a control frame and the positions of an axis
+ * frame are checked to pass the fixed-point codec functions unchanged.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <arpa/inet.h>
+#include "../packet_handler.h"
+#include "../axis_sim.h"
+
+#define CYCLES 20000
+#define INTRVL_NS 1000000
+#define TOLERANCE_NM 10         //maximum difference of the positions of both modes
+
+/* Print usage message */
+static void usage(char *appname)
+{
+        fprintf(stderr,
+                "\n"
+                "Usage: %s [options]\n"
+                " -n [value]           Number of simulated cycles of 1 ms. Default 20000.\n"
+                " -h                   Prints this help message and exits\n"
+                "\n",
+                appname);
+}
+
+/* set velocity of a cycle in mm/s: ramps, reversal, limit and standstill */
+static double setvel(uint32_t cycl, uint32_t cycls)
+{
+        switch ((cycl*8)/cycls) {
+        case 0:
+                return 12.5;
+        case 1:
+                return 45.125;
+        case 2:
+                return -30.0;
+        case 3:
+                return 80.0;    //above the limit of the axis
+        case 4:
+                return -7.000001;
+        case 5:
+                return 0.0;
+        case 6:
+                return -60.0;
+        default:
+                return 3.3;
+        }
+}
+
+/* simulates an axis, fxp selects the mode; positions in nano units are written to pos */
+static void simaxs(int64_t pos[], uint32_t cycls, bool fxp)
+{
+        struct axis_t axs;
+        struct axis_t *axes[1] = {&axs};
+        int64_t nsetvel;
+
+        memset(&axs,0,sizeof(struct axis_t));
+        axs_init(&axs,x,X_MAX,-X_VEL,X_VEL,0);
+        if (fxp)
+                axes_setfxp(axes,1);
+        axs_enbl(&axs);
+        for (uint32_t i = 0; i < cycls; i++) {
+                if (fxp) {
+                        dbl2nint64(setvel(i,cycls),&nsetvel);
+                        axs.nano.set_vel = nsetvel;
+                        axs_fxpfineclcpstn(&axs,INTRVL_NS,FINEITERATIONS);
+                        pos[i] = axs_fxpgetpstn(&axs);
+                } else {
+                        axs.set_vel = setvel(i,cycls);
+                        axs_fineclcpstn(&axs,(double) INTRVL_NS/1000000000,FINEITERATIONS);
+                        dbl2nint64(axs.cur_pos,&(pos[i]));
+                }
+        }
+}
+
+/* checks that the fixed-point codec functions pass the wire values unchanged */
+static int chckcodec(struct rt_pkt_t *snd, struct rt_pkt_t *rcvd)
+{
+        char mac[ETH_ALEN] = {0x01,0xAC,0xCE,0x55,0x00,0x00};
+        char *macs[1] = {mac};
+        struct eth_hdr_t *ethhdr = (struct eth_hdr_t *) rcvd->sktbf;
+        struct cntrlnfo_t cntrlnfo;
+        struct axsnfo_t axsnfos[MAXDTSTMSGS];
+        struct axsnfo_t dcdaxs[MAXDTSTMSGS];
+        const struct axsnfo_t *sets[4];
+        int64_t nval;
+        int axscnt;
+
+        memset(&cntrlnfo,0,sizeof(struct cntrlnfo_t));
+        cntrlnfo.x_set.cntrlvl = 12.345678901;
+        cntrlnfo.y_set.cntrlvl = -0.000000001;
+        cntrlnfo.z_set.cntrlvl = 59.999999999;
+        cntrlnfo.s_set.cntrlvl = -1000.5;
+        cntrlnfo.x_set.cntrlsw = 1;
+        setpkt(snd,1,CNTRL,0xAC00);
+        fillcntrlpkt(snd,&cntrlnfo,1);
+        memset(rcvd->sktbf,0,MAXPKTSZ);
+        memcpy(ethhdr->dstmac,mac,ETH_ALEN);
+        ethhdr->ethtyp = htons(ETHERTYPE);
+        memcpy(rcvd->sktbf + sizeof(struct eth_hdr_t),snd->sktbf,snd->len);
+        rcvd->len = sizeof(struct eth_hdr_t) + snd->len;
+        if (dcdcntrlfrmfxp(rcvd,macs,1,&cntrlnfo) != DCD_OK)
+                return 1;       //fail
+        sets[0] = &(cntrlnfo.x_set);
+        sets[1] = &(cntrlnfo.y_set);
+        sets[2] = &(cntrlnfo.z_set);
+        sets[3] = &(cntrlnfo.s_set);
+        for (int i = 0; i < 4; i++) {
+                dbl2nint64(sets[i]->cntrlvl,&nval);
+                if (sets[i]->ncntrlvl != nval)
+                        return 1;       //fail
+        }
+        if (cntrlnfo.x_set.cntrlsw != 1)
+                return 1;       //fail
+
+        for (int i = 0; i < MAXDTSTMSGS; i++) {
+                memset(&(axsnfos[i]),0,sizeof(struct axsnfo_t));
+                axsnfos[i].axsID = i;
+                axsnfos[i].ncntrlvl = (i & 1) ? -INT64_MAX + i : 299999999999LL - i;
+        }
+        setpkt(snd,MAXDTSTMSGS,AXS,0xAC0A);
+        if (fillaxspktsfxp(snd,axsnfos,MAXDTSTMSGS,1) != 0)
+                return 1;       //fail
+        mac[5] = 0x01;
+        memcpy(ethhdr->dstmac,mac,ETH_ALEN);
+        memcpy(rcvd->sktbf + sizeof(struct eth_hdr_t),snd->sktbf,snd->len);
+        rcvd->len = sizeof(struct eth_hdr_t) + snd->len;
+        if ((dcdaxsfrm(rcvd,macs,1,dcdaxs,&axscnt) != DCD_OK) || (axscnt != MAXDTSTMSGS))
+                return 1;       //fail
+        for (int i = 0; i < MAXDTSTMSGS; i++) {
+                if ((dcdaxs[i].axsID != (enum axsID_t) i) || (dcdaxs[i].cntrlvl != nint642dbl(axsnfos[i].ncntrlvl)))
+                        return 1;       //fail
+        }
+        return 0;       //succeded
+}
+
+int main(int argc, char* argv[])
+{
+        int c;
+        uint32_t cycls = CYCLES;
+        int64_t *dblpos;
+        int64_t *fxppos;
+        int64_t *fxppos2;
+        int64_t maxdiff = 0;
+        uint64_t chcksm = 0xcbf29ce484222325ULL;
+        struct rt_pkt_t *snd;
+        struct rt_pkt_t *rcvd;
+
+        while (EOF != (c = getopt(argc,argv,"hn:"))) {
+                switch(c) {
+                case 'n':
+                        cycls = atoi(optarg);
+                        break;
+                case 'h':
+                default:
+                        usage(argv[0]);
+                        exit(0);
+                        break;
+                }
+        }
+        if (cycls == 0)
+                cycls = CYCLES;
+
+        dblpos = calloc(cycls,sizeof(int64_t));
+        fxppos = calloc(cycls,sizeof(int64_t));
+        fxppos2 = calloc(cycls,sizeof(int64_t));
+        if ((dblpos == NULL) || (fxppos == NULL) || (fxppos2 == NULL)) {
+                printf("Allocation of trajectories failed.\n");
+                return 1;
+        }
+        simaxs(dblpos,cycls,false);
+        simaxs(fxppos,cycls,true);
+        simaxs(fxppos2,cycls,true);
+
+        for (uint32_t i = 0; i < cycls; i++) {
+                if (llabs(fxppos[i] - dblpos[i]) > maxdiff)
+                        maxdiff = llabs(fxppos[i] - dblpos[i]);
+                //FNV-1a over the little endian bytes of the positions
+                for (int b = 0; b < 8; b++) {
+                        chcksm ^= (uint64_t) (fxppos[i] >> (8*b)) & 0xff;
+                        chcksm *= 0x100000001b3ULL;
+                }
+        }
+        printf("%u cycles, end position %.9f mm, maximum difference to floating point %lld nm\n",
+               cycls,nint642dbl(fxppos[cycls - 1]),(long long) maxdiff);
+        printf("Checksum of fixed-point trajectory: %016llx\n",(unsigned long long) chcksm);
+        if (memcmp(fxppos,fxppos2,cycls*sizeof(int64_t)) != 0) {
+                printf("Fixed-point trajectory is not reproducible.\n");
+                return 1;
+        }
+        if (maxdiff > TOLERANCE_NM) {
+                printf("Fixed-point trajectory differs by more than %d nm.\n",TOLERANCE_NM);
+                return 1;
+        }
+
+        if ((createpkt(&snd) != 0) || (createpkt(&rcvd) != 0)) {
+                printf("Allocation of packets failed.\n");
+                return 1;
+        }
+        if (chckcodec(snd,rcvd) != 0) {
+                printf("Fixed-point codec changes the wire values.\n");
+                return 1;
+        }
+        printf("Fixed-point test passed.\n");
+        destroypkt(snd);
+        destroypkt(rcvd);
+        free(dblpos);
+        free(fxppos);
+        free(fxppos2);
+        return 0;
+}
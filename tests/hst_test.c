@@ -0,0 +1,229 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Test of the latency histogram. The bucket borders are checked to be
+ * continuous, the percentiles of a known distribution are compared with the
+ * exact ones and a snapshot is taken repeatedly while another thread writes
+ * the histogram. The stage profile is checked to add the durations of
+ * consecutive stages to their histograms and to do nothing if disabled. With
+ * -m the wakeup latency of clock_nanosleep is measured like in the real-time
+ * threads of the applications and printed, with -S also the one of the hybrid
+ * wakeup, which sleeps till a guard before the wakeup time and spins the rest.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../rt_stats.h"
+#include "../time_calc.h"
+
+#define WRTCNT 2000000
+#define MAXERR 0.125            //maximum relative error of a percentile given by the bucket width
+
+/* Print usage message */
+static void usage(char *appname)
+{
+        fprintf(stderr,
+                "\n"
+                "Usage: %s [options]\n"
+                " -m [value]           Measure the wakeup latency of [value] cycles of 1 ms. Default 0.\n"
+                " -S                   Measure also the wakeup latency of the hybrid wakeup.\n"
+                " -h                   Prints this help message and exits\n"
+                "\n",
+                appname);
+}
+
+/* checks that each value is in the bucket whose borders enclose it */
+static int chckbckts(void)
+{
+        for (int b = 0; b < HSTBCKTS - 1; b++) {
+                if (hstbckt(hstbcktmax(b)) != b)
+                        return 1;       //fail
+                if (hstbckt(hstbcktmax(b) + 1) != b + 1)
+                        return 1;       //fail
+        }
+        if ((hstbckt(INT64_MAX) != HSTBCKTS - 1) || (hstbcktmax(HSTBCKTS - 1) != INT64_MAX))
+                return 1;       //fail
+        if (hstbckt(-5) != 0)
+                return 1;       //fail
+        return 0;       //succeded
+}
+
+/* compares the percentiles of 1..100000 ns with the exact values */
+static int chckprcntls(void)
+{
+        struct ltncyhst_t hst;
+        struct ltncyhst_t snpst;
+        const double prcnts[5] = {1.0, 50.0, 90.0, 99.0, 99.99};
+        int64_t val;
+
+        inithst(&hst,50000);
+        for (int64_t i = 100000; i > 0; i--)
+                updthst(&hst,i);
+        snpsthst(&hst,&snpst);
+        if ((snpst.cnt != 100000) || (snpst.min != 1) || (snpst.max != 100000) || (snpst.ovrlmt != 50000))
+                return 1;       //fail
+        for (int i = 0; i < 5; i++) {
+                val = hstprcntl(&snpst,prcnts[i]);
+                if ((val < prcnts[i]*1000) || (val > prcnts[i]*1000*(1.0 + MAXERR)))
+                        return 1;       //fail
+        }
+        if (hstprcntl(&snpst,100.0) != 100000)
+                return 1;       //fail
+        return 0;       //succeded
+}
+
+static void *wrtr(void *arg)
+{
+        struct ltncyhst_t *hst = (struct ltncyhst_t *) arg;
+        for (int64_t i = 0; i < WRTCNT; i++)
+                updthst(hst,i & 0xFFFF);
+        return NULL;
+}
+
+/* snapshots taken while writing must be consistent with the written values */
+static int chckcncrnt(void)
+{
+        static struct ltncyhst_t hst;
+        static struct ltncyhst_t snpst;
+        pthread_t thrd;
+        uint64_t lstcnt = 0;
+        int snpsts = 0;
+        int ok = 0;
+
+        inithst(&hst,0);
+        if (pthread_create(&thrd,NULL,wrtr,&hst) != 0)
+                return 1;       //fail
+        do {
+                snpsthst(&hst,&snpst);
+                snpsts++;
+                if ((snpst.cnt < lstcnt) || (snpst.cnt > WRTCNT) || ((snpst.cnt > 0) && (snpst.max > 0xFFFF)))
+                        ok = 1;
+                lstcnt = snpst.cnt;
+        } while (lstcnt < WRTCNT);
+        pthread_join(thrd,NULL);
+        snpsthst(&hst,&snpst);
+        if ((snpst.cnt != WRTCNT) || (snpst.min != 0) || (snpst.max != 0xFFFF))
+                ok = 1;
+        printf("%d snapshots taken while writing.\n",snpsts);
+        return ok;
+}
+
+/* busy waits for a duration in ns */
+static void spin(uint64_t dur)
+{
+        uint64_t strt = prftm();
+        while (prftm() - strt < dur);
+}
+
+/* the durations of consecutive stages are added to the histograms of the stages */
+static int chckstgprf(void)
+{
+        static struct stgprf_t prf;
+        const char *nms[3] = {"first", "second", "third"};
+        const int64_t bdgts[3] = {1000000, 1000, 0};
+        uint64_t strt, end;
+
+        if (initstgprf(&prf,nms,bdgts,MAXSTGS + 1) == 0)
+                return 1;       //fail
+        //disabled profile ignores all stages
+        strtstg(&prf);
+        endstg(&prf,0);
+        if (prf.hsts[0].cnt != 0)
+                return 1;       //fail
+        if (initstgprf(&prf,nms,bdgts,3) != 0)
+                return 1;       //fail
+        for (int i = 0; i < 10; i++) {
+                strt = prftm();
+                strtstg(&prf);
+                spin(20000);
+                endstg(&prf,0);
+                spin(50000);
+                endstg(&prf,1);
+                end = prftm();
+                endstg(&prf,3);         //not profiled
+        }
+        if ((prf.hsts[0].cnt != 10) || (prf.hsts[1].cnt != 10) || (prf.hsts[2].cnt != 0))
+                return 1;       //fail
+        if ((prf.hsts[0].min < 20000) || (prf.hsts[1].min < 50000) || (prf.hsts[1].ovrlmt != 10))
+                return 1;       //fail
+        //both stages together take not longer than measured around them
+        if (prf.hsts[0].min + prf.hsts[1].min > (int64_t) (end - strt))
+                return 1;       //fail
+        prtstgprf("Stage profile",&prf);
+        return 0;       //succeded
+}
+
+/* measures the wakeup latency of cycles of 1 ms, a guard of 0 only sleeps */
+static void msrwkup(uint32_t cycls, int64_t grd)
+{
+        struct ltncyhst_t hst;
+        struct ltncyhst_t snpst;
+        struct timespec wkuptm;
+        struct hybwkup_t hyb;
+
+        inithst(&hst,50000);
+        inithybwkup(&hyb,grd,2*grd);
+        clock_gettime(CLOCK_TAI,&wkuptm);
+        for (uint32_t i = 0; i < cycls; i++) {
+                inc_tm(&wkuptm,1000000);
+                if (hybwkup(&hyb,&wkuptm) == 0)
+                        updtwkuphst(&hst,&wkuptm);
+        }
+        snpsthst(&hst,&snpst);
+        prthst(grd > 0 ? "Wakeup latency (hybrid)" : "Wakeup latency",&snpst);
+        prthybwkup("Hybrid wakeup",&hyb);
+}
+
+int main(int argc, char* argv[])
+{
+        int c;
+        uint32_t msrcycls = 0;
+        bool hyb = false;
+
+        while (EOF != (c = getopt(argc,argv,"hm:S"))) {
+                switch(c) {
+                case 'm':
+                        msrcycls = atoi(optarg);
+                        break;
+                case 'S':
+                        hyb = true;
+                        break;
+                case 'h':
+                default:
+                        usage(argv[0]);
+                        exit(0);
+                        break;
+                }
+        }
+
+        if (chckbckts() != 0) {
+                printf("Bucket borders are not continuous.\n");
+                return 1;
+        }
+        if (chckprcntls() != 0) {
+                printf("Percentiles differ from the exact values.\n");
+                return 1;
+        }
+        if (chckcncrnt() != 0) {
+                printf("Snapshot taken while writing is inconsistent.\n");
+                return 1;
+        }
+        if (chckstgprf() != 0) {
+                printf("Stage profile is wrong.\n");
+                return 1;
+        }
+        printf("Histogram test passed.\n");
+        if (msrcycls > 0)
+                msrwkup(msrcycls,0);
+        if ((msrcycls > 0) && hyb)
+                msrwkup(msrcycls,50000);
+        return 0;
+}
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Test of the real-time log. First several threads push records without rate
+ * limit at the same time while the log thread prints them; a record dropped
+ * because of a full ring is pushed again, so each record must be printed
+ * exactly once and the records of each thread in their order. Then one thread
+ * pushes the same event many times with the rate limit; only the first record
+ * may be printed, the others must be reported as suppressed.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "../rt_log.h"
+
+#define THRDS 4
+#define RCRDS 5000
+#define RPTS 1000
+
+static struct rtlog_t log;
+
+static void *wrtr(void *arg)
+{
+        int64_t thrd = (int64_t) (intptr_t) arg;
+        //push again while the ring is full, each record must be printed once
+        for (int64_t i = 0; i < RCRDS; i++) {
+                while (rtlog(LOG_SNDMFAIL,NULL,thrd,i,0) != 0)
+                        sched_yield();
+        }
+        return NULL;
+}
+
+int main(void)
+{
+        pthread_t thrds[THRDS];
+        int64_t lst[THRDS];
+        long long thrd, i;
+        char line[256];
+        uint64_t prtd = 0;
+        FILE *out;
+
+        //records are printed directly without active log
+        if (rtlog(LOG_RCVERR,NULL,0,0,0) != 0)
+                return 1;
+
+        //several writing threads without rate limit
+        out = tmpfile();
+        if (out == NULL)
+                return 1;
+        initrtlog(&log,out);
+        log.rtintrvl = 0;
+        if (strtrtlog(&log))
+                return 1;
+        for (int t = 0; t < THRDS; t++) {
+                if (pthread_create(&(thrds[t]),NULL,wrtr,(void *) (intptr_t) t) != 0)
+                        return 1;
+        }
+        for (int t = 0; t < THRDS; t++)
+                pthread_join(thrds[t],NULL);
+        stprtlog(&log);
+
+        rewind(out);
+        for (int t = 0; t < THRDS; t++)
+                lst[t] = -1;
+        while (fgets(line,sizeof(line),out) != NULL) {
+                if (sscanf(line,"error in sndmmsg, frame: %lld, errono: %lld",&thrd,&i) != 2)
+                        continue;
+                if ((thrd < 0) || (thrd >= THRDS) || (i != lst[thrd] + 1)) {
+                        printf("Record out of order: %s",line);
+                        return 1;
+                }
+                lst[thrd] = i;
+                prtd++;
+        }
+        fclose(out);
+        printf("%llu records printed, %llu dropped\n", (unsigned long long) prtd, (unsigned long long) log.ring.drpd);
+        if (prtd != (uint64_t) THRDS*RCRDS) {
+                printf("Records lost.\n");
+                return 1;
+        }
+
+        //rate limit of repeated events
+        out = tmpfile();
+        if (out == NULL)
+                return 1;
+        initrtlog(&log,out);
+        if (strtrtlog(&log))
+                return 1;
+        for (int64_t r = 0; r < RPTS; r++)
+                rtlog(LOG_RCVFAIL,NULL,r,0,0);
+        stprtlog(&log);
+
+        rewind(out);
+        prtd = 0;
+        i = 0;
+        while (fgets(line,sizeof(line),out) != NULL) {
+                if (strncmp(line,"recv failed",11) == 0)
+                        prtd++;
+                else if (sscanf(line,"%lld similar messages suppressed",&thrd) == 1)
+                        i += thrd;
+        }
+        fclose(out);
+        if ((prtd != 1) || (i != RPTS - 1)) {
+                printf("Rate limit wrong: %llu printed, %lld suppressed.\n", (unsigned long long) prtd, i);
+                return 1;
+        }
+
+        printf("Log test passed.\n");
+        return 0;
+}
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Test of the performance counters of a thread. A worker thread registers
+ * itself, sleeps for 1 ms in each cycle and touches a new memory page, the
+ * main thread opens the counters of the worker like the pmc-thread of the
+ * applications. Each cycle must count one context switch (the sleep) and at
+ * least one page fault. The hardware counters are printed if available. If
+ * no counter can be opened (e.g. perf_event_paranoid is 3), the test is
+ * skipped.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "../pmc_handler.h"
+
+#define CYCLES 200
+#define PGSZ 4096
+
+static struct pmcthrd_t pmc;
+static char *mem;
+
+static void *wrkr(void *arg)
+{
+        struct timespec slp = {0, 1000000};
+
+        rgstpmcthrd(&pmc);
+        //wait till the counters are opened
+        while (!__atomic_load_n(&(pmc.rdy), __ATOMIC_ACQUIRE)) {
+                if (__atomic_load_n((int *) arg, __ATOMIC_ACQUIRE))
+                        return NULL;    //counters not available
+                nanosleep(&slp,NULL);
+        }
+        smplpmc(&pmc);
+        for (int i = 0; i < CYCLES; i++) {
+                nanosleep(&slp,NULL);
+                mem[(size_t) i*PGSZ] = 1;
+                smplpmc(&pmc);
+        }
+        return NULL;
+}
+
+int main(void)
+{
+        pthread_t thrd;
+        struct ltncyhst_t snpst;
+        int ok;
+        int fld = 0;
+
+        mem = malloc((size_t) CYCLES*PGSZ);
+        if (mem == NULL)
+                return 1;
+        initpmcthrd(&pmc,"worker");
+        if (pthread_create(&thrd,NULL,wrkr,&fld) != 0)
+                return 1;
+        while ((ok = opnpmcthrd(&pmc)) == -1)
+                usleep(100);
+        if (ok != 0) {
+                __atomic_store_n(&fld, 1, __ATOMIC_RELEASE);
+                pthread_join(thrd,NULL);
+                printf("No performance counter available, test skipped.\n");
+                return 0;
+        }
+        pthread_join(thrd,NULL);
+        prtpmc(&pmc);
+
+        if (pmc.rderrs != 0) {
+                printf("Reading the counters failed.\n");
+                return 1;
+        }
+        if (pmc.idx[PMC_CTXSW] >= 0) {
+                snpsthst(&(pmc.hsts[PMC_CTXSW]),&snpst);
+                if ((snpst.cnt != CYCLES) || (hstprcntl(&snpst,50.0) != 1)) {
+                        printf("Context switches per cycle are wrong.\n");
+                        return 1;
+                }
+        }
+        if ((pmc.idx[PMC_PGFLT] >= 0) && !pmc.usronly) {
+                snpsthst(&(pmc.hsts[PMC_PGFLT]),&snpst);
+                if ((snpst.cnt != CYCLES) || (hstprcntl(&snpst,50.0) < 1)) {
+                        printf("Page faults per cycle are wrong.\n");
+                        return 1;
+                }
+        }
+        clspmcthrd(&pmc);
+        free(mem);
+        printf("Performance counter test passed.\n");
+        return 0;
+}
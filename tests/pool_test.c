@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Test of the packet storage. Several threads get and return packets of one
+ * storage at the same time, each as its own owner. A packet must never be
+ * handed out twice and the count of each owner must match the packets it
+ * holds. A packet returned twice must be rejected, the packets an owner leaked
+ * must be reclaimed and afterwards each packet must be available exactly once.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "../packet_handler.h"
+
+#define THRDS 3                 //owners 0 to THRDS-1
+#define PKTS 32                 //packets in the storage
+#define BRST 8                  //packets held by a thread at once at most
+#define ROUNDS 200000
+#define LKD 3                   //packets leaked by each thread
+
+static struct pktstore_t strg;
+static _Atomic int hldr[PKTS];  //owner + 1 of each handed out packet, 0 if free
+static _Atomic int errs;
+static pthread_barrier_t brr;
+
+/* marks the packet as held by the owner, fails if it is held already */
+static int take(struct rt_pkt_t *pkt, int ownr)
+{
+        int exp = 0;
+        if ((pkt->stridx >= PKTS) || !atomic_compare_exchange_strong(&(hldr[pkt->stridx]), &exp, ownr + 1)) {
+                printf("Packet %u handed to owner %d while held by owner %d.\n",pkt->stridx,ownr,exp - 1);
+                return 1;       //fail
+        }
+        return 0;       //succeded
+}
+
+static void *usr(void *arg)
+{
+        int ownr = (int) (intptr_t) arg;
+        struct rt_pkt_t *pkts[BRST];
+        int cnt;
+        unsigned int sd = ownr + 1;
+
+        pthread_barrier_wait(&brr);
+        for (int r = 0; r < ROUNDS; r++) {
+                //a burst of packets, the storage may run empty
+                cnt = 0;
+                while ((cnt < 1 + (int) (rand_r(&sd) % BRST)) && (getfreepkt(&strg,&(pkts[cnt]),ownr) == 0)) {
+                        if (take(pkts[cnt],ownr) != 0)
+                                atomic_fetch_add(&errs,1);
+                        cnt++;
+                }
+                if (cntownpkts(&strg,ownr) != cnt) {
+                        printf("Owner %d holds %d packets, counted %d.\n",ownr,cnt,cntownpkts(&strg,ownr));
+                        atomic_fetch_add(&errs,1);
+                }
+                for (int i = 0; i < cnt; i++) {
+                        atomic_store(&(hldr[pkts[i]->stridx]),0);
+                        if (retusedpkt(&strg,&(pkts[i])) != 0) {
+                                printf("Return of a packet of owner %d failed.\n",ownr);
+                                atomic_fetch_add(&errs,1);
+                        }
+                }
+        }
+        //leak some packets, they are reclaimed after the thread ended
+        for (int i = 0; i < LKD; i++) {
+                if (getfreepkt(&strg,&(pkts[i]),ownr) != 0) {
+                        printf("Owner %d got no packet to leak.\n",ownr);
+                        atomic_fetch_add(&errs,1);
+                }
+        }
+        return NULL;
+}
+
+int main(void)
+{
+        pthread_t thrds[THRDS];
+        struct rt_pkt_t *pkts[PKTS];
+        struct rt_pkt_t *pkt;
+        struct rt_pkt_t *dbl;
+        int rclmd;
+
+        if (initpktstrg(&strg,PKTS) != 0)
+                return 1;
+
+        //owner out of range
+        if ((getfreepkt(&strg,&pkt,-1) == 0) || (getfreepkt(&strg,&pkt,PKTSTRG_MAXOWNRS) == 0) || (cntownpkts(&strg,PKTSTRG_MAXOWNRS) != -1)) {
+                printf("Owner out of range accepted.\n");
+                return 1;
+        }
+
+        //a packet returned twice is only put back once
+        if (getfreepkt(&strg,&pkt,0) != 0)
+                return 1;
+        dbl = pkt;
+        if ((retusedpkt(&strg,&pkt) != 0) || (pkt != NULL) || (retusedpkt(&strg,&dbl) == 0) || (cntownpkts(&strg,0) != 0)) {
+                printf("Packet returned twice not rejected.\n");
+                return 1;
+        }
+
+        //several owners at the same time
+        pthread_barrier_init(&brr,NULL,THRDS);
+        for (int t = 0; t < THRDS; t++) {
+                if (pthread_create(&(thrds[t]),NULL,usr,(void *) (intptr_t) t) != 0)
+                        return 1;
+        }
+        for (int t = 0; t < THRDS; t++)
+                pthread_join(thrds[t],NULL);
+        pthread_barrier_destroy(&brr);
+        if (atomic_load(&errs) != 0) {
+                printf("%d errors while getting and returning packets.\n",atomic_load(&errs));
+                return 1;
+        }
+
+        //leaked packets are counted and reclaimed
+        for (int t = 0; t < THRDS; t++) {
+                if (cntownpkts(&strg,t) != LKD) {
+                        printf("Owner %d leaked %d packets, counted %d.\n",t,LKD,cntownpkts(&strg,t));
+                        return 1;
+                }
+                rclmd = rclmownpkts(&strg,t);
+                if ((rclmd != LKD) || (cntownpkts(&strg,t) != 0)) {
+                        printf("Reclaimed %d of %d leaked packets of owner %d.\n",rclmd,LKD,t);
+                        return 1;
+                }
+        }
+
+        //each packet is in the free-list exactly once
+        memset(hldr,0,sizeof(hldr));
+        for (int i = 0; i < PKTS; i++) {
+                if ((getfreepkt(&strg,&(pkts[i]),1) != 0) || (take(pkts[i],1) != 0)) {
+                        printf("Packet %d of %d not available.\n",i,PKTS);
+                        return 1;
+                }
+        }
+        if ((getfreepkt(&strg,&pkt,1) == 0) || (cntownpkts(&strg,1) != PKTS)) {
+                printf("More packets than in the storage handed out.\n");
+                return 1;
+        }
+        for (int i = 0; i < PKTS; i++)
+                retusedpkt(&strg,&(pkts[i]));
+        destroypktstrg(&strg);
+        printf("%d owners, %d rounds each: packet storage test passed.\n",THRDS,ROUNDS);
+        return 0;
+}
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Benchmark of the strategies to wait for a received frame (ppoll, busy
+ * polling, hybrid). A thread sends a UDP datagram over the loopback interface
+ * in every second cycle of 1 ms at an offset into the receive window, which
+ * holds its send time. The main thread waits for it with each strategy till the
+ * end of the window. For the received datagrams the latency from sending till
+ * the end of the wait is measured, for the cycles without a datagram how late
+ * the wait ended after the deadline. The time waited and the CPU time burned
+ * while waiting are printed for each strategy.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../packet_handler.h"
+#include "../rt_stats.h"
+#include "../time_calc.h"
+
+#define CYCLS 2000
+#define INTRVL 1000000          //length of a cycle in ns
+#define RCVWNDW 250000          //receive window in ns
+#define RCVSPIN 50000           //time spun before the end of the window by the hybrid wait
+
+struct sndr_t {
+        int fd;
+        struct sockaddr_in addr;
+        int64_t strt;           //start of the first cycle
+        uint32_t cycls;
+        uint32_t arrvl;         //offset of the datagram into the receive window
+};
+
+/* Print usage message */
+static void usage(char *appname)
+{
+        fprintf(stderr,
+                "\n"
+                "Usage: %s [options]\n"
+                " -n [value]           Number of cycles of 1 ms per strategy. Default 2000.\n"
+                " -w [nanosec]         Receive window. Default 250000.\n"
+                " -a [nanosec]         Offset of the datagram into the receive window. Default half of the window.\n"
+                " -h                   Prints this help message and exits\n"
+                "\n",
+                appname);
+}
+
+static int64_t taitm(void)
+{
+        struct timespec tm;
+        clock_gettime(CLOCK_TAI,&tm);
+        return cnvrt_tmspc2int64(&tm);
+}
+
+/* sends a datagram with its send time in every second cycle */
+static void *sndthrd(void *arg)
+{
+        struct sndr_t *sndr = (struct sndr_t *) arg;
+        struct timespec tm;
+        int64_t sndtm;
+
+        for (uint32_t i = 0; i < sndr->cycls; i += 2) {
+                cnvrt_int642tmspc(sndr->strt + (int64_t) i*INTRVL + sndr->arrvl,&tm);
+                clock_nanosleep(CLOCK_TAI, TIMER_ABSTIME, &tm, NULL);
+                sndtm = taitm();
+                sendto(sndr->fd, &sndtm, sizeof(sndtm), 0, (struct sockaddr *) &(sndr->addr), sizeof(sndr->addr));
+        }
+        return NULL;
+}
+
+/* waits for the datagrams with one strategy */
+static int bnchmd(enum rcvwtmd_t md, int rxfd, struct sndr_t *sndr, uint32_t rcvwndw)
+{
+        struct rcvwt_t wt;
+        struct ltncyhst_t frmhst, dlnhst, snpst;
+        struct timespec tm;
+        struct timespec dln;
+        pthread_t thrd;
+        int64_t sndtm;
+        int64_t now;
+        int ok;
+
+        if (initrcvwt(&wt,md,rxfd,RCVSPIN) != 0) {
+                printf("Strategy %s not available.\n",rcvwtmdstr(md));
+                return 1;       //fail
+        }
+        inithst(&frmhst,0);
+        inithst(&dlnhst,0);
+        sndr->strt = taitm() + 10*INTRVL;
+        if (pthread_create(&thrd,NULL,sndthrd,sndr) != 0)
+                return 1;       //fail
+        for (uint32_t i = 0; i < sndr->cycls; i++) {
+                cnvrt_int642tmspc(sndr->strt + (int64_t) i*INTRVL,&tm);
+                clock_nanosleep(CLOCK_TAI, TIMER_ABSTIME, &tm, NULL);
+                cnvrt_int642tmspc(sndr->strt + (int64_t) i*INTRVL + rcvwndw,&dln);
+                ok = rcvwt(&wt,&dln);
+                if (ok > 0) {
+                        now = taitm();
+                        while (recv(rxfd, &sndtm, sizeof(sndtm), MSG_DONTWAIT) == sizeof(sndtm))
+                                updthst(&frmhst,now - sndtm);
+                } else if (ok == 0) {
+                        updthst(&dlnhst,taitm() - cnvrt_tmspc2int64(&dln));
+                }
+        }
+        pthread_join(thrd,NULL);
+
+        printf("\n");
+        prtrcvwt("Receive wait",&wt);
+        snpsthst(&frmhst,&snpst);
+        prthst("Latency from sending the datagram",&snpst);
+        snpsthst(&dlnhst,&snpst);
+        prthst("Wait ended after the deadline",&snpst);
+        return 0;       //succeded
+}
+
+int main(int argc, char* argv[])
+{
+        int c;
+        uint32_t cycls = CYCLS;
+        uint32_t rcvwndw = RCVWNDW;
+        int64_t arrvl = -1;
+        int rxfd;
+        socklen_t addrlen;
+        struct sndr_t sndr;
+
+        while (EOF != (c = getopt(argc,argv,"hn:w:a:"))) {
+                switch(c) {
+                case 'n':
+                        cycls = atoi(optarg);
+                        break;
+                case 'w':
+                        rcvwndw = atoi(optarg);
+                        break;
+                case 'a':
+                        arrvl = atoi(optarg);
+                        break;
+                case 'h':
+                default:
+                        usage(argv[0]);
+                        exit(0);
+                        break;
+                }
+        }
+        if ((cycls == 0) || (rcvwndw == 0) || (rcvwndw >= INTRVL)) {
+                printf("Number of cycles must be positive and the window shorter than a cycle.\n");
+                return 1;
+        }
+        sndr.cycls = cycls;
+        sndr.arrvl = (arrvl < 0) ? rcvwndw/2 : (uint32_t) arrvl;
+
+        //receive and send socket on the loopback interface
+        memset(&(sndr.addr),0,sizeof(sndr.addr));
+        sndr.addr.sin_family = AF_INET;
+        sndr.addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        rxfd = socket(AF_INET, SOCK_DGRAM, 0);
+        sndr.fd = socket(AF_INET, SOCK_DGRAM, 0);
+        addrlen = sizeof(sndr.addr);
+        if ((rxfd < 0) || (sndr.fd < 0) || (bind(rxfd,(struct sockaddr *) &(sndr.addr),sizeof(sndr.addr)) < 0) ||
+            (getsockname(rxfd,(struct sockaddr *) &(sndr.addr),&addrlen) < 0)) {
+                printf("Opening the sockets failed.\n");
+                return 1;
+        }
+
+        printf("%u cycles of 1 ms, receive window %u ns, datagram in every second cycle after %u ns.\n",cycls,rcvwndw,sndr.arrvl);
+        for (enum rcvwtmd_t md = RCVWT_PPOLL; md <= RCVWT_HYBRID; md++)
+                bnchmd(md,rxfd,&sndr,rcvwndw);
+
+        close(sndr.fd);
+        close(rxfd);
+        return 0;
+}
@@ -0,0 +1,585 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Offline benchmark of the receive path. The control and axis frames of a
+ * capture (pcap or pcapng, e.g. written by tcpdump or the capture of the
+ * applications) are loaded into memory and replayed through the chain of
+ * chckethhdr, prspkt, chckpkthdrs, prsdtstmsg and prscntrlmsg/prsaxsmsg and
+ * through the fused decoders used by the applications. Without a capture, the
+ * frames of one cycle of the demo are built. Malformed variants of each frame
+ * (truncated, corrupted headers, wrong destination) are mixed into a second
+ * replay. Before measuring, both paths must decode the same values from each
+ * frame and the fused decoders must reject each malformed variant. The
+ * throughput, the time and the cpu cycles per frame are printed.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <byteswap.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "../packet_handler.h"
+#include "../pmc_handler.h"
+
+#define FRAMES 10000000
+#define MAXFRMS 65536           //frames loaded from a capture at most
+#define MLFRMDPCT 10            //percentage of malformed frames in the second replay
+
+/* kind of a frame, by its destination address */
+enum frmknd_t {
+        KND_CNTRL,
+        KND_AXS,
+};
+
+/* frame of the replay */
+struct rplfrm_t {
+        struct rt_pkt_t *pkt;
+        enum frmknd_t knd;
+};
+
+/* malformed variant of a frame: byte flipped at an offset or length changed */
+struct mlfrmd_t {
+        const char *name;
+        int off;                //byte flipped, -1 if only the length is changed
+        int lendiv;             //frame is cut to len/lendiv, 1 to keep the length
+};
+
+static const struct mlfrmd_t mlfrmds[] = {
+        {"truncated",           -1, 2},
+        {"destination",         5,  1},
+        {"ethertype",           13, 1},
+        {"flags",               14, 1},
+        {"writer group",        20, 1},
+        {"group version",       24, 1},
+        {"message count",       27, 1},
+        {"writer id",           29, 1},
+};
+#define MLFRMDCNT (sizeof(mlfrmds)/sizeof(mlfrmds[0]))
+
+static char macs[5][ETH_ALEN] = {
+        {0x01,0xAC,0xCE,0x55,0x00,0x00},
+        {0x01,0xAC,0xCE,0x55,0x00,0x01},
+        {0x01,0xAC,0xCE,0x55,0x00,0x02},
+        {0x01,0xAC,0xCE,0x55,0x00,0x03},
+        {0x01,0xAC,0xCE,0x55,0x00,0x04}};
+static char *cntrlmacs[1] = {macs[0]};
+static char *axsmacs[4] = {macs[1],macs[2],macs[3],macs[4]};
+static struct pmcthrd_t pmc;
+
+/* Print usage message */
+static void usage(char *appname)
+{
+        fprintf(stderr,
+                "\n"
+                "Usage: %s [options]\n"
+                " -f [file]            Capture (pcap or pcapng) with the frames to replay. Default: frames of one cycle of the demo.\n"
+                " -n [value]           Number of replayed frames. Default 10000000.\n"
+                " -e [percent]         Percentage of malformed frames in the second replay. Default 10.\n"
+                " -h                   Prints this help message and exits\n"
+                "\n",
+                appname);
+}
+
+static uint64_t gettm_ns(void)
+{
+        struct timespec tm;
+        clock_gettime(CLOCK_MONOTONIC_RAW,&tm);
+        return cnvrt_tmspc2int64(&tm);
+}
+
+/* cpu cycles of the performance counters if available, otherwise of the time stamp counter */
+static uint64_t getcycls(void)
+{
+        if (pmc.idx[PMC_CYCLES] >= 0) {
+                smplpmc(&pmc);
+                return pmc.prv[PMC_CYCLES];
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+}
+
+/* chain of the single parse functions for a control frame */
+static int chain_cntrl(struct rt_pkt_t *pkt, struct cntrlnfo_t *cntrlnfo)
+{
+        enum msgtyp_t msgtyp;
+        union dtstmsg_t *dtstmsgs[MAXDTSTMSGS];
+        int dtstmsgcnt;
+        if (chckethhdr(pkt,cntrlmacs,1) == -1)
+                return 1;       //fail
+        if ((prspkt(pkt,&msgtyp) == -1) || (msgtyp != CNTRL))
+                return 1;       //fail
+        if (chckpkthdrs(pkt) != 0)
+                return 1;       //fail
+        if (ntohs(pkt->pyld_hdr->wrtrId) != WRITERID_CNTRL)
+                return 1;       //fail, the fused decoder checks the writer id as well
+        if (prsdtstmsg(pkt,msgtyp,dtstmsgs,&dtstmsgcnt) != 0)
+                return 1;       //fail
+        return prscntrlmsg(dtstmsgs[0],cntrlnfo);
+}
+
+/* chain of the single parse functions for an axis frame */
+static int chain_axs(struct rt_pkt_t *pkt, struct axsnfo_t axsnfos[], int *axscnt)
+{
+        enum msgtyp_t msgtyp;
+        union dtstmsg_t *dtstmsgs[MAXDTSTMSGS];
+        int dtstmsgcnt;
+        int rcvmac;
+        int axs;
+        *axscnt = 0;
+        rcvmac = chckethhdr(pkt,axsmacs,4);
+        if (rcvmac == -1)
+                return 1;       //fail
+        if ((prspkt(pkt,&msgtyp) == -1) || (msgtyp != AXS))
+                return 1;       //fail
+        if (chckpkthdrs(pkt) != 0)
+                return 1;       //fail
+        if (prsdtstmsg(pkt,msgtyp,dtstmsgs,&dtstmsgcnt) != 0)
+                return 1;       //fail
+        for (int i = 0; i < dtstmsgcnt; i++) {
+                if (prsaxsmsg(dtstmsgs[i],&(axsnfos[i])) != 0)
+                        return 1;       //fail
+                axs = prswrtrid(pkt,i);
+                if ((axs == -1) && (dtstmsgcnt == 1))
+                        axs = rcvmac;
+                if (axs == -1)
+                        return 1;       //fail, unknown writer id of combined axes
+                axsnfos[i].axsID = axs;
+        }
+        *axscnt = dtstmsgcnt;
+        return 0;
+}
+
+/* replays a frame through the chain, returns 0 if the frame is accepted */
+static int rpl_chain(struct rplfrm_t *frm)
+{
+        struct cntrlnfo_t cntrlnfo;
+        struct axsnfo_t axsnfos[MAXDTSTMSGS];
+        int axscnt;
+        if (frm->knd == KND_CNTRL)
+                return chain_cntrl(frm->pkt,&cntrlnfo);
+        return chain_axs(frm->pkt,axsnfos,&axscnt);
+}
+
+/* replays a frame through the fused decoder, returns 0 if the frame is accepted */
+static int rpl_fused(struct rplfrm_t *frm)
+{
+        struct cntrlnfo_t cntrlnfo;
+        struct axsnfo_t axsnfos[MAXDTSTMSGS];
+        int axscnt;
+        if (frm->knd == KND_CNTRL)
+                return dcdcntrlfrm(frm->pkt,cntrlmacs,1,&cntrlnfo);
+        return dcdaxsfrm(frm->pkt,axsmacs,4,axsnfos,&axscnt);
+}
+
+/* adds a frame with Ethernet header to the replay if it is a control or axis frame, returns 1 if skipped */
+static int addfrm(struct rplfrm_t frms[], uint32_t *cnt, const uint8_t *data, uint32_t len)
+{
+        const struct eth_hdr_t *ethhdr = (const struct eth_hdr_t *) data;
+        struct rt_pkt_t *pkt;
+        enum frmknd_t knd;
+        int i;
+
+        if ((*cnt >= MAXFRMS) || (len < sizeof(struct eth_hdr_t)) || (len > MAXPKTSZ) || (ethhdr->ethtyp != htons(ETHERTYPE)))
+                return 1;
+        for (i = 0; i < 5; i++) {
+                if (memcmp(ethhdr->dstmac,macs[i],ETH_ALEN) == 0)
+                        break;
+        }
+        if (i == 5)
+                return 1;       //other destination
+        knd = (i == 0) ? KND_CNTRL : KND_AXS;
+        if (createpkt(&pkt) != 0)
+                return 1;
+        //replayed at the captured length, short frames are only padded by a NIC, not on lo, veth or AF_XDP
+        memcpy(pkt->sktbf,data,len);
+        pkt->len = len;
+        frms[*cnt].pkt = pkt;
+        frms[*cnt].knd = knd;
+        (*cnt)++;
+        return 0;
+}
+
+static uint32_t rdu32(const uint8_t *p, bool swp)
+{
+        uint32_t val;
+        memcpy(&val,p,sizeof(val));
+        return swp ? bswap_32(val) : val;
+}
+
+static uint16_t rdu16(const uint8_t *p, bool swp)
+{
+        uint16_t val;
+        memcpy(&val,p,sizeof(val));
+        return swp ? bswap_16(val) : val;
+}
+
+/* loads the Ethernet frames of a pcap or pcapng file, returns the number of frames or -1 */
+static int ldcap(const char *flnm, struct rplfrm_t frms[], uint32_t *skppd)
+{
+        FILE *fl;
+        uint8_t *buf;
+        long sz;
+        size_t pos;
+        uint32_t magic;
+        uint32_t cnt = 0;
+        uint32_t blktyp, blklen, caplen, ifid;
+        uint16_t lnktyps[16];
+        uint32_t ifcnt = 0;
+        bool swp;
+
+        *skppd = 0;
+        fl = fopen(flnm,"rb");
+        if (NULL == fl) {
+                printf("Opening %s failed.\n",flnm);
+                return -1;
+        }
+        fseek(fl,0,SEEK_END);
+        sz = ftell(fl);
+        fseek(fl,0,SEEK_SET);
+        buf = malloc(sz > 0 ? sz : 1);
+        if ((NULL == buf) || (sz < 24) || (fread(buf,sz,1,fl) != 1)) {
+                printf("Reading %s failed.\n",flnm);
+                fclose(fl);
+                free(buf);
+                return -1;
+        }
+        fclose(fl);
+
+        memcpy(&magic,buf,sizeof(magic));
+        if ((magic == 0xA1B2C3D4) || (magic == 0xA1B23C4D) || (magic == 0xD4C3B2A1) || (magic == 0x4D3CB2A1)) {
+                //pcap: global header, then records with a header of 16 bytes
+                swp = (magic == 0xD4C3B2A1) || (magic == 0x4D3CB2A1);
+                if (rdu32(&(buf[20]),swp) != 1) {
+                        printf("%s has no Ethernet frames.\n",flnm);
+                        free(buf);
+                        return -1;
+                }
+                for (pos = 24; pos + 16 <= (size_t) sz; pos += 16 + caplen) {
+                        caplen = rdu32(&(buf[pos+8]),swp);
+                        if (pos + 16 + caplen > (size_t) sz)
+                                break;
+                        //frames cut by the snap length are skipped
+                        if ((caplen != rdu32(&(buf[pos+12]),swp)) || addfrm(frms,&cnt,&(buf[pos+16]),caplen))
+                                (*skppd)++;
+                }
+        } else if (magic == 0x0A0D0D0A) {
+                //pcapng: blocks, the byte order is set by each section header
+                swp = false;
+                for (pos = 0; pos + 12 <= (size_t) sz; pos += blklen) {
+                        blktyp = rdu32(&(buf[pos]),swp);
+                        if (blktyp == 0x0A0D0D0A) {
+                                swp = (rdu32(&(buf[pos+8]),false) != 0x1A2B3C4D);
+                                ifcnt = 0;
+                        }
+                        blklen = rdu32(&(buf[pos+4]),swp);
+                        if ((blklen < 12) || (pos + blklen > (size_t) sz))
+                                break;
+                        if ((blktyp == 1) && (ifcnt < 16)) {
+                                lnktyps[ifcnt++] = rdu16(&(buf[pos+8]),swp);
+                        } else if ((blktyp == 6) && (blklen >= 32)) {
+                                ifid = rdu32(&(buf[pos+8]),swp);
+                                caplen = rdu32(&(buf[pos+20]),swp);
+                                if ((ifid >= ifcnt) || (lnktyps[ifid] != 1) || (caplen > blklen - 32) ||
+                                    (caplen != rdu32(&(buf[pos+24]),swp)) || addfrm(frms,&cnt,&(buf[pos+28]),caplen))
+                                        (*skppd)++;
+                        } else if ((blktyp == 3) && (blklen >= 16)) {
+                                caplen = rdu32(&(buf[pos+8]),swp);
+                                if ((ifcnt == 0) || (lnktyps[0] != 1) || (caplen > blklen - 16) ||
+                                    addfrm(frms,&cnt,&(buf[pos+12]),caplen))
+                                        (*skppd)++;
+                        }
+                }
+        } else {
+                printf("%s is neither pcap nor pcapng.\n",flnm);
+                free(buf);
+                return -1;
+        }
+        free(buf);
+        return cnt;
+}
+
+/* builds a received frame (with Ethernet header) from a filled packet, pad to the minimal frame length like a NIC */
+static int bldfrm(struct rplfrm_t frms[], uint32_t *cnt, struct rt_pkt_t *snd, char *dstmac, bool pad)
+{
+        uint8_t frm[MAXPKTSZ];
+        struct eth_hdr_t *ethhdr = (struct eth_hdr_t *) frm;
+        uint32_t len;
+        memset(frm,0,sizeof(frm));
+        memcpy(ethhdr->dstmac,dstmac,ETH_ALEN);
+        memset(ethhdr->srcmac,0x02,ETH_ALEN);
+        ethhdr->ethtyp = htons(ETHERTYPE);
+        memcpy(frm + sizeof(struct eth_hdr_t),snd->sktbf,snd->len);
+        len = sizeof(struct eth_hdr_t) + snd->len;
+        if ((pad) && (len < ETH_ZLEN))
+                len = ETH_ZLEN;
+        return addfrm(frms,cnt,frm,len);
+}
+
+/* builds the frames of one cycle of the demo: a control frame, a frame of each axis and a frame with combined axes */
+static int bldcycl(struct rplfrm_t frms[])
+{
+        struct rt_pkt_t *snd;
+        struct cntrlnfo_t cntrlnfo;
+        struct axsnfo_t axsnfos[MAXDTSTMSGS];
+        uint32_t cnt = 0;
+
+        if (createpkt(&snd) != 0)
+                return -1;
+        memset(&cntrlnfo,0,sizeof(struct cntrlnfo_t));
+        cntrlnfo.x_set.cntrlvl = 1.5;
+        cntrlnfo.x_set.cntrlsw = 1;
+        cntrlnfo.s_set.cntrlvl = -200.25;
+        cntrlnfo.machinestatus = true;
+        setpkt(snd,1,CNTRL,0xAC00);
+        fillcntrlpkt(snd,&cntrlnfo,7);
+        bldfrm(frms,&cnt,snd,macs[0],false);
+        for (int i = 0; i < MAXDTSTMSGS; i++) {
+                memset(&(axsnfos[i]),0,sizeof(struct axsnfo_t));
+                axsnfos[i].axsID = i;
+                axsnfos[i].cntrlvl = 10.125*(i+1);
+                axsnfos[i].cntrlsw = i & 1;
+        }
+        for (int i = 0; i < MAXDTSTMSGS; i++) {
+                setpkt(snd,1,AXS,0xAC0A);
+                fillaxspkt(snd,&(axsnfos[i]),7);
+                //a single axis is shorter than the minimal frame length, received unpadded and padded
+                bldfrm(frms,&cnt,snd,macs[1+i],false);
+                bldfrm(frms,&cnt,snd,macs[1+i],true);
+        }
+        setpkt(snd,MAXDTSTMSGS,AXS,0xAC0A);
+        fillaxspkts(snd,axsnfos,MAXDTSTMSGS,7);
+        bldfrm(frms,&cnt,snd,macs[1],false);
+        destroypkt(snd);
+        return cnt;
+}
+
+/* checks that both paths decode the same values from each frame */
+static int chckfrms(struct rplfrm_t frms[], uint32_t cnt)
+{
+        struct cntrlnfo_t chncntrl, dcdcntrl;
+        struct axsnfo_t chnaxs[MAXDTSTMSGS], dcdaxs[MAXDTSTMSGS];
+        int chncnt, dcdcnt;
+        enum dcderr_t err;
+
+        for (uint32_t i = 0; i < cnt; i++) {
+                if (frms[i].knd == KND_CNTRL) {
+                        memset(&chncntrl,0,sizeof(struct cntrlnfo_t));
+                        memset(&dcdcntrl,0,sizeof(struct cntrlnfo_t));
+                        if (chain_cntrl(frms[i].pkt,&chncntrl) != 0) {
+                                printf("Frame %u rejected by the chain.\n",i);
+                                return 1;       //fail
+                        }
+                        err = dcdcntrlfrm(frms[i].pkt,cntrlmacs,1,&dcdcntrl);
+                        if ((err != DCD_OK) || (memcmp(&chncntrl,&dcdcntrl,sizeof(struct cntrlnfo_t)) != 0)) {
+                                printf("Decoding of control frame %u differs: %s.\n",i,dcderrstr(err));
+                                return 1;       //fail
+                        }
+                } else {
+                        memset(chnaxs,0,sizeof(chnaxs));
+                        memset(dcdaxs,0,sizeof(dcdaxs));
+                        if (chain_axs(frms[i].pkt,chnaxs,&chncnt) != 0) {
+                                printf("Frame %u rejected by the chain.\n",i);
+                                return 1;       //fail
+                        }
+                        err = dcdaxsfrm(frms[i].pkt,axsmacs,4,dcdaxs,&dcdcnt);
+                        if ((err != DCD_OK) || (chncnt != dcdcnt) || (memcmp(chnaxs,dcdaxs,sizeof(chnaxs)) != 0)) {
+                                printf("Decoding of axis frame %u differs: %s.\n",i,dcderrstr(err));
+                                return 1;       //fail
+                        }
+                }
+        }
+        return 0;       //succeded
+}
+
+/* builds the malformed variants of the frames, a variant which is still valid must be decoded the same by both paths and is dropped */
+static int bldmlfrmd(struct rplfrm_t frms[], uint32_t cnt, struct rplfrm_t mlfrms[])
+{
+        uint32_t mlfrmd[MLFRMDCNT];
+        uint32_t rjctd[MLFRMDCNT];
+        uint32_t n = 0;
+        struct rt_pkt_t *pkt;
+
+        memset(mlfrmd,0,sizeof(mlfrmd));
+        memset(rjctd,0,sizeof(rjctd));
+        for (uint32_t i = 0; i < cnt; i++) {
+                for (uint32_t v = 0; v < MLFRMDCNT; v++) {
+                        if (createpkt(&pkt) != 0)
+                                return -1;
+                        memcpy(pkt->sktbf,frms[i].pkt->sktbf,frms[i].pkt->len);
+                        pkt->len = frms[i].pkt->len / mlfrmds[v].lendiv;
+                        if (mlfrmds[v].off >= 0)
+                                pkt->sktbf[mlfrmds[v].off] ^= 0x40;
+                        mlfrms[n].pkt = pkt;
+                        mlfrms[n].knd = frms[i].knd;
+                        if (rpl_fused(&(mlfrms[n])) == DCD_OK) {
+                                //e.g. unknown writer id of a single axis, the axis is taken from the destination
+                                if (chckfrms(&(mlfrms[n]),1) != 0) {
+                                        printf("Variant (%s) of frame %u decoded differently.\n",mlfrmds[v].name,i);
+                                        return -1;
+                                }
+                                destroypkt(pkt);
+                                continue;
+                        }
+                        mlfrmd[v]++;
+                        if (rpl_chain(&(mlfrms[n])) != 0)
+                                rjctd[v]++;
+                        else
+                                printf("Variant (%s) of frame %u accepted by the chain only.\n",mlfrmds[v].name,i);
+                        n++;
+                }
+        }
+        printf("Malformed variants (rejected by the fused decoders) rejected by the chain:\n");
+        for (uint32_t v = 0; v < MLFRMDCNT; v++)
+                printf("  %-16s %u of %u (%u variants still valid)\n",mlfrmds[v].name,rjctd[v],mlfrmd[v],cnt - mlfrmd[v]);
+        return n;
+}
+
+/* replays the frames n times through a path and prints the results */
+static int rpl(const char *name, int (*dcd)(struct rplfrm_t *), struct rplfrm_t *frms[], uint32_t cnt, uint32_t n)
+{
+        uint64_t strt, strtcycls, ns, cycls;
+        uint32_t idx = 0;
+        int acptd = 0;
+
+        strtcycls = getcycls();
+        strt = gettm_ns();
+        for (uint32_t i = 0; i < n; i++) {
+                if (dcd(frms[idx]) == 0)
+                        acptd++;
+                if (++idx == cnt)
+                        idx = 0;
+        }
+        ns = gettm_ns() - strt;
+        cycls = getcycls() - strtcycls;
+        printf("  %-8s %10.0f frames/s %8.1f ns/frame %8.1f cycles/frame, %d accepted\n", name,
+               (double) n*1000000000.0/ns, (double) ns/n, (double) cycls/n, acptd);
+        return acptd;
+}
+
+int main(int argc, char* argv[])
+{
+        int c;
+        uint32_t n = FRAMES;
+        int mlfrmdpct = MLFRMDPCT;
+        char *flnm = NULL;
+        struct rplfrm_t *frms;
+        struct rplfrm_t *mlfrms;
+        struct rplfrm_t **rplfrms;
+        uint32_t cnt;
+        uint32_t mlcnt;
+        uint32_t rplcnt;
+        uint32_t skppd = 0;
+        uint32_t ml = 0;
+        uint32_t vld;
+        int acptd;
+        int dffrd = 0;
+        int ret;
+
+        while (EOF != (c = getopt(argc,argv,"hf:n:e:"))) {
+                switch(c) {
+                case 'f':
+                        flnm = optarg;
+                        break;
+                case 'n':
+                        n = atoi(optarg);
+                        break;
+                case 'e':
+                        mlfrmdpct = atoi(optarg);
+                        break;
+                case 'h':
+                default:
+                        usage(argv[0]);
+                        exit(0);
+                        break;
+                }
+        }
+        if (n == 0)
+                n = FRAMES;
+        if ((mlfrmdpct < 0) || (mlfrmdpct > 100))
+                mlfrmdpct = MLFRMDPCT;
+
+        frms = calloc(MAXFRMS,sizeof(struct rplfrm_t));
+        mlfrms = calloc((size_t) MAXFRMS*MLFRMDCNT,sizeof(struct rplfrm_t));
+        rplfrms = calloc((size_t) MAXFRMS*(MLFRMDCNT + 1),sizeof(struct rplfrm_t *));
+        if ((NULL == frms) || (NULL == mlfrms) || (NULL == rplfrms)) {
+                printf("Allocation of frames failed.\n");
+                return 1;
+        }
+        if (NULL != flnm)
+                ret = ldcap(flnm,frms,&skppd);
+        else
+                ret = bldcycl(frms);
+        if (ret <= 0) {
+                printf("No control or axis frame to replay.\n");
+                return 1;
+        }
+        cnt = ret;
+        printf("%u frames loaded from %s, %u frames skipped (other frames or cut by the snap length).\n",
+               cnt, (NULL != flnm) ? flnm : "one cycle of the demo", skppd);
+        if (chckfrms(frms,cnt) != 0)
+                return 1;
+        ret = bldmlfrmd(frms,cnt,mlfrms);
+        if (ret < 0)
+                return 1;
+        mlcnt = ret;
+
+        //cycles of the thread if the performance counters are available
+        initpmcthrd(&pmc,"replay");
+        rgstpmcthrd(&pmc);
+        if (opnpmcthrd(&pmc) == 0)
+                smplpmc(&pmc);
+        printf("Cycles per frame counted by %s.\n", (pmc.idx[PMC_CYCLES] >= 0) ? "the performance counters" : "the time stamp counter");
+
+        for (uint32_t i = 0; i < cnt; i++)
+                rplfrms[i] = &(frms[i]);
+        printf("Replay of %u valid frames:\n",n);
+        acptd = rpl("chain",rpl_chain,rplfrms,cnt,n);
+        if (rpl("fused",rpl_fused,rplfrms,cnt,n) != acptd)
+                dffrd++;
+
+        //malformed variants spread evenly over the valid frames, the trace is long enough to hold each variant once
+        rplcnt = cnt;
+        if ((mlfrmdpct > 0) && (mlcnt > 0) && ((uint64_t) mlcnt*100/mlfrmdpct > rplcnt))
+                rplcnt = (uint64_t) mlcnt*100/mlfrmdpct;
+        if (rplcnt > MAXFRMS*(MLFRMDCNT + 1))
+                rplcnt = MAXFRMS*(MLFRMDCNT + 1);
+        vld = 0;
+        for (uint32_t i = 0; i < rplcnt; i++) {
+                if ((mlcnt > 0) && (((uint64_t) (i + 1)*mlfrmdpct/100) > ((uint64_t) i*mlfrmdpct/100)))
+                        rplfrms[i] = &(mlfrms[ml++ % mlcnt]);
+                else
+                        rplfrms[i] = &(frms[vld++ % cnt]);
+        }
+        printf("Replay of %u frames, %u of %u frames in the trace malformed:\n",n,ml,rplcnt);
+        acptd = rpl("chain",rpl_chain,rplfrms,rplcnt,n);
+        if (rpl("fused",rpl_fused,rplfrms,rplcnt,n) != acptd)
+                dffrd++;
+
+        clspmcthrd(&pmc);
+        for (uint32_t i = 0; i < cnt; i++)
+                destroypkt(frms[i].pkt);
+        for (uint32_t i = 0; i < mlcnt; i++)
+                destroypkt(mlfrms[i].pkt);
+        free(frms);
+        free(mlfrms);
+        free(rplfrms);
+        if (dffrd > 0) {
+                //the times of both paths are only comparable if they accept the same frames
+                printf("Chain and fused decoders accepted a different number of frames.\n");
+                return 1;
+        }
+        return 0;
+}
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Test of the sequence tracking. Sequences of sequence numbers with gaps,
+ * late frames, duplicates, wrap around, stale frames and a restarted publisher
+ * are tracked and the results and counters are compared with the expected ones.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "../packet_handler.h"
+
+struct seqstep_t {
+        uint16_t seqno;
+        enum seqrslt_t rslt;
+};
+
+/* tracks the steps for one writer, returns the number of the first wrong step or 0 */
+static int chcksteps(struct seqtrck_t *trck, uint16_t wrtrid, const struct seqstep_t steps[], int cnt)
+{
+        enum seqrslt_t rslt;
+        for (int i = 0; i < cnt; i++) {
+                rslt = trckseq(trck,0xAC0A,wrtrid,steps[i].seqno);
+                if (rslt != steps[i].rslt) {
+                        printf("Step %d, sequence number %u: result %d, expected %d\n",i,steps[i].seqno,rslt,steps[i].rslt);
+                        return i + 1;   //fail
+                }
+        }
+        return 0;       //succeded
+}
+
+static int chckcntrs(struct seqtrck_t *trck, uint16_t wrtrid, const struct seqcntrs_t *exp)
+{
+        struct seqcntrs_t cntrs;
+        if (getseqcntrs(trck,0xAC0A,wrtrid,&cntrs) != 0)
+                return 1;       //fail
+        if (memcmp(&cntrs,exp,sizeof(struct seqcntrs_t)) != 0) {
+                printf("Counters of writer 0x%04X differ from the expected ones.\n",wrtrid);
+                prtseqcntrs(trck);
+                return 1;       //fail
+        }
+        return 0;       //succeded
+}
+
+int main(void)
+{
+        struct seqtrck_t trck;
+        //gap of two, both arrive late, duplicates of a new and a late frame, wrap around with a gap
+        const struct seqstep_t steps[] = {
+                {65530, SEQ_NEW}, {65531, SEQ_OK}, {65534, SEQ_GAP}, {65532, SEQ_REORD}, {65533, SEQ_REORD},
+                {65534, SEQ_DUP}, {65532, SEQ_DUP}, {65529, SEQ_STALE}, {65535, SEQ_OK}, {1, SEQ_GAP},
+                {2, SEQ_OK}, {0, SEQ_REORD}, {2, SEQ_DUP}};
+        const struct seqcntrs_t expcntrs = {13, 0, 2, 3, 3, 1, 0};
+        //frames older than the window are stale, a restarted publisher is resynchronized
+        const struct seqstep_t rsyncsteps[] = {
+                {5000, SEQ_NEW}, {5100, SEQ_GAP}, {5030, SEQ_STALE}, {5099, SEQ_REORD}, {0, SEQ_STALE},
+                {1, SEQ_STALE}, {2, SEQ_STALE}, {3, SEQ_NEW}, {4, SEQ_OK}};
+        const struct seqcntrs_t exprsync = {9, 98, 1, 0, 1, 4, 1};
+
+        initseqtrck(&trck);
+        if ((chcksteps(&trck,WRITERID_AXX,steps,sizeof(steps)/sizeof(steps[0])) != 0) ||
+            (chckcntrs(&trck,WRITERID_AXX,&expcntrs) != 0))
+                return 1;
+        if ((chcksteps(&trck,WRITERID_AXY,rsyncsteps,sizeof(rsyncsteps)/sizeof(rsyncsteps[0])) != 0) ||
+            (chckcntrs(&trck,WRITERID_AXY,&exprsync) != 0))
+                return 1;
+        //writers are independent, the counters of the first one are unchanged
+        if (chckcntrs(&trck,WRITERID_AXX,&expcntrs) != 0)
+                return 1;
+        if (!seqisold(SEQ_DUP) || !seqisold(SEQ_REORD) || !seqisold(SEQ_STALE) || seqisold(SEQ_GAP) || seqisold(SEQ_NEW))
+                return 1;
+
+        //no entries left for further writers
+        for (int i = 2; i < MAXSEQWRTRS; i++)
+                trckseq(&trck,0xAC0A,i,0);
+        if ((trckseq(&trck,0xAC0B,WRITERID_AXX,0) != SEQ_FULL) || (trck.untrckd != 1))
+                return 1;
+        prtseqcntrs(&trck);
+        printf("Sequence tracking test passed.\n");
+        return 0;
+}
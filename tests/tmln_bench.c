@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Test and microbenchmark of the cycle timeline. The times of each cycle
+ * (TxTime, wakeup time and timeout of the send thread, wakeup time of the
+ * receive thread) are calculated as before with timespec values, which are
+ * increased by the interval each cycle (clc_est, inc_tm, clc_txtm,
+ * clc_sndwkuptm, clc_rcvwkuptm), and from the index of the cycle on the
+ * timeline (inittmln, tmln_tm). First both must give the same times for many
+ * cycles with different intervals and base times, and the catch up of the
+ * receive thread after missed cycles must give the same wakeup time. Then the
+ * time per cycle of both ways is measured.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "../time_calc.h"
+
+#define ITERATIONS 10000000
+#define CHCKCYCLS 3000000
+
+//timing values of the sender
+#define SNDOFFST 500000
+#define RCVOFFST 700000
+#define STCKDURATION 200000
+#define APPWAKEUP 200000
+#define MAXWAKEUPJITTER 50000
+
+/* Print usage message */
+static void usage(char *appname)
+{
+        fprintf(stderr,
+                "\n"
+                "Usage: %s [options]\n"
+                " -n [value]           Number of cycles. Default 10000000.\n"
+                " -h                   Prints this help message and exits\n"
+                "\n",
+                appname);
+}
+
+static uint64_t gettm_ns(void)
+{
+        struct timespec tm;
+        clock_gettime(CLOCK_MONOTONIC_RAW,&tm);
+        return cnvrt_tmspc2int64(&tm);
+}
+
+/* times of a cycle of the send thread */
+struct sndtms_t {
+        uint64_t txtime;
+        struct timespec wkup;
+        struct timespec tmout;
+};
+
+/* times of the next cycle of the send thread as before: epoch start time increased by the interval */
+static void snd_tmspc(struct timespec *est, uint32_t intrvl, struct sndtms_t *tms)
+{
+        struct timespec txtime;
+        inc_tm(est,intrvl);
+        txtime = clc_txtm(est,SNDOFFST,STCKDURATION);
+        tms->wkup = clc_sndwkuptm(&txtime,APPWAKEUP,MAXWAKEUPJITTER);
+        tmspc_cp(&(tms->tmout),&(tms->wkup));
+        inc_tm(&(tms->tmout),APPWAKEUP/2);
+        tms->txtime = cnvrt_tmspc2int64(&txtime);
+}
+
+/* times of a cycle of the send thread from the index of the cycle */
+static void snd_tmln(const struct cycltmln_t *tmln, uint64_t cycl, int64_t txoffs, int64_t wkupoffs, struct sndtms_t *tms)
+{
+        tms->txtime = tmln_tm(tmln,cycl,txoffs);
+        cnvrt_int642tmspc(tmln_tm(tmln,cycl,wkupoffs),&(tms->wkup));
+        cnvrt_int642tmspc(tmln_tm(tmln,cycl,wkupoffs + APPWAKEUP/2),&(tms->tmout));
+}
+
+static bool eqltmspc(const struct timespec *A, const struct timespec *B)
+{
+        return (A->tv_sec == B->tv_sec) && (A->tv_nsec == B->tv_nsec);
+}
+
+/* compares the times of both ways for an interval and a base time */
+static int chcktmln(uint32_t intrvl, struct timespec *basetm, struct timespec *curtm)
+{
+        struct timespec est;
+        struct timespec rcvwkup;
+        struct timespec tm;
+        struct cycltmln_t tmln;
+        struct sndtms_t old, new;
+        int64_t txoffs, sndwkupoffs, rcvwkupoffs;
+        uint64_t cycl;
+
+        clc_est(curtm,basetm,intrvl,&est);
+        inittmln(&tmln,cnvrt_tmspc2int64(basetm),intrvl,cnvrt_tmspc2int64(curtm));
+        txoffs = clc_txoffs(SNDOFFST,STCKDURATION);
+        sndwkupoffs = clc_sndwkupoffs(txoffs,APPWAKEUP,MAXWAKEUPJITTER);
+        rcvwkupoffs = clc_rcvwkupoffs(RCVOFFST,STCKDURATION,APPWAKEUP,MAXWAKEUPJITTER);
+        cnvrt_int642tmspc(tmln_tm(&tmln,0,0),&tm);
+        if (!eqltmspc(&est,&tm)) {
+                printf("Epoch start time differs for interval %u.\n",intrvl);
+                return 1;       //fail
+        }
+        rcvwkup = clc_rcvwkuptm(&est,RCVOFFST,STCKDURATION,APPWAKEUP,MAXWAKEUPJITTER);
+        dec_tm(&est,intrvl);
+        for (cycl = 0; cycl < CHCKCYCLS; cycl++) {
+                snd_tmspc(&est,intrvl,&old);
+                snd_tmln(&tmln,cycl,txoffs,sndwkupoffs,&new);
+                if ((old.txtime != new.txtime) || !eqltmspc(&(old.wkup),&(new.wkup)) || !eqltmspc(&(old.tmout),&(new.tmout))) {
+                        printf("Times of the send thread differ in cycle %llu for interval %u.\n",(unsigned long long) cycl,intrvl);
+                        return 1;       //fail
+                }
+        }
+        //catch up of the receive thread after some missed cycles
+        for (cycl = 0; cycl < 1000; cycl += 7) {
+                cnvrt_int642tmspc(cnvrt_tmspc2int64(&rcvwkup) + cycl*intrvl + intrvl/3,&tm);
+                while (cmptmspc_Ab4rB(&rcvwkup,&tm))
+                        inc_tm(&rcvwkup,intrvl);
+                cnvrt_int642tmspc(tmln_tm(&tmln,tmln_nxtcycl(&tmln,cnvrt_tmspc2int64(&tm),rcvwkupoffs),rcvwkupoffs),&tm);
+                if (!eqltmspc(&rcvwkup,&tm)) {
+                        printf("Catch up of the receive thread differs after %llu cycles for interval %u.\n",(unsigned long long) cycl,intrvl);
+                        return 1;       //fail
+                }
+        }
+        return 0;       //succeded
+}
+
+int main(int argc, char* argv[])
+{
+        int c;
+        uint32_t iters = ITERATIONS;
+        const uint32_t intrvls[4] = {1000000, 333333, 31250, 999999999};
+        struct timespec curtm;
+        struct timespec basetm;
+        struct timespec est;
+        struct cycltmln_t tmln;
+        struct sndtms_t tms;
+        int64_t txoffs, sndwkupoffs, rcvwkupoffs;
+        struct timespec rcvwkup;
+        struct timespec tm;
+        volatile uint64_t sink = 0;
+        uint64_t strt;
+        uint64_t old_ns;
+        uint64_t new_ns;
+
+        while (EOF != (c = getopt(argc,argv,"hn:"))) {
+                switch(c) {
+                case 'n':
+                        iters = atoi(optarg);
+                        break;
+                case 'h':
+                default:
+                        usage(argv[0]);
+                        exit(0);
+                        break;
+                }
+        }
+        if (iters == 0)
+                iters = ITERATIONS;
+
+        clock_gettime(CLOCK_TAI,&curtm);
+        for (int i = 0; i < 4; i++) {
+                //base time in the past, base time with nanoseconds and base time in the future
+                cnvrt_dbl2tmspc(0,&basetm);
+                if (chcktmln(intrvls[i],&basetm,&curtm) != 0)
+                        return 1;
+                basetm.tv_sec = curtm.tv_sec - 100;
+                basetm.tv_nsec = 123456789;
+                if (chcktmln(intrvls[i],&basetm,&curtm) != 0)
+                        return 1;
+                basetm.tv_sec = curtm.tv_sec + 2;
+                if (chcktmln(intrvls[i],&basetm,&curtm) != 0)
+                        return 1;
+        }
+        printf("Times of timespec and timeline equal for %d cycles.\n",CHCKCYCLS);
+
+        cnvrt_dbl2tmspc(0,&basetm);
+        clc_est(&curtm,&basetm,intrvls[0],&est);
+        inittmln(&tmln,0,intrvls[0],cnvrt_tmspc2int64(&curtm));
+        txoffs = clc_txoffs(SNDOFFST,STCKDURATION);
+        sndwkupoffs = clc_sndwkupoffs(txoffs,APPWAKEUP,MAXWAKEUPJITTER);
+        rcvwkupoffs = clc_rcvwkupoffs(RCVOFFST,STCKDURATION,APPWAKEUP,MAXWAKEUPJITTER);
+
+        printf("Times per cycle (%u cycles):\n",iters);
+        strt = gettm_ns();
+        for (uint32_t i = 0; i < iters; i++) {
+                snd_tmspc(&est,intrvls[0],&tms);
+                sink += tms.txtime + tms.wkup.tv_nsec + tms.tmout.tv_nsec;
+        }
+        old_ns = gettm_ns() - strt;
+        strt = gettm_ns();
+        for (uint32_t i = 0; i < iters; i++) {
+                snd_tmln(&tmln,i,txoffs,sndwkupoffs,&tms);
+                sink += tms.txtime + tms.wkup.tv_nsec + tms.tmout.tv_nsec;
+        }
+        new_ns = gettm_ns() - strt;
+        printf("  %-22s timespec %6.1f ns/cycle, timeline %6.1f ns/cycle\n","send thread",(double) old_ns/iters,(double) new_ns/iters);
+
+        //receive thread woken up 3 cycles late
+        rcvwkup = clc_rcvwkuptm(&est,RCVOFFST,STCKDURATION,APPWAKEUP,MAXWAKEUPJITTER);
+        strt = gettm_ns();
+        for (uint32_t i = 0; i < iters/10; i++) {
+                tm = rcvwkup;
+                inc_tm(&tm,3*intrvls[0]);
+                while (cmptmspc_Ab4rB(&rcvwkup,&tm))
+                        inc_tm(&rcvwkup,intrvls[0]);
+                sink += rcvwkup.tv_nsec;
+        }
+        old_ns = gettm_ns() - strt;
+        strt = gettm_ns();
+        for (uint32_t i = 0; i < iters/10; i++) {
+                cnvrt_int642tmspc(tmln_tm(&tmln,tmln_nxtcycl(&tmln,tmln_tm(&tmln,3*i,rcvwkupoffs),rcvwkupoffs),rcvwkupoffs),&rcvwkup);
+                sink += rcvwkup.tv_nsec;
+        }
+        new_ns = gettm_ns() - strt;
+        printf("  %-22s timespec %6.1f ns/cycle, timeline %6.1f ns/cycle\n","receive catch up (3)",(double) old_ns/(iters/10),(double) new_ns/(iters/10));
+
+        return (int) (sink & 0);
+}
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Microbenchmark for the preparation of a control frame in every cycle.
+ * Compares the rebuild of the packet (setpkt, fillcntrlpkt, sendpkt) with the
+ * prepared frame templates (fillcntrlpkt, sendtmplt). Without an interface only
+ * the CPU work until the frame is ready to be sent is measured. With an
+ * interface the frames are also sent (requires the privileges of the
+ * applications, e.g. use the loopback interface "lo").
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <linux/net_tstamp.h>
+#include "../packet_handler.h"
+
+#define ITERATIONS 1000000
+
+/* Print usage message */
+static void usage(char *appname)
+{
+        fprintf(stderr,
+                "\n"
+                "Usage: %s [options]\n"
+                " -n [value]           Number of iterations. Default 1000000.\n"
+                " -i [name]            Name of the Networkinterface to send on. Default: no sending.\n"
+                " -h                   Prints this help message and exits\n"
+                "\n",
+                appname);
+}
+
+static uint64_t gettm_ns(void)
+{
+        struct timespec tm;
+        clock_gettime(CLOCK_MONOTONIC_RAW,&tm);
+        return cnvrt_tmspc2int64(&tm);
+}
+
+/* rebuild the packet in every cycle (as before frame templates) */
+static uint64_t bench_rebuild(struct rt_pkt_t *pkt, struct cntrlnfo_t *cntrlnfo, int fd, struct sockaddr_ll *addr, uint32_t iters)
+{
+        uint64_t strt;
+        strt = gettm_ns();
+        for (uint32_t i = 0; i < iters; i++) {
+                cntrlnfo->x_set.cntrlvl = i*1e-3;
+                setpkt(pkt,1,CNTRL,0xAC00);
+                fillcntrlpkt(pkt,cntrlnfo,(uint16_t) i);
+                if (fd >= 0)
+                        sendpkt(fd,pkt->sktbf,pkt->len,addr,i,CLOCK_TAI);
+        }
+        return gettm_ns() - strt;
+}
+
+/* patch the prepared frame template in every cycle */
+static uint64_t bench_tmplt(struct frmtmplt_t *tmplt, struct cntrlnfo_t *cntrlnfo, int fd, uint32_t iters)
+{
+        uint64_t strt;
+        strt = gettm_ns();
+        for (uint32_t i = 0; i < iters; i++) {
+                cntrlnfo->x_set.cntrlvl = i*1e-3;
+                fillcntrlpkt(tmplt->pkt,cntrlnfo,(uint16_t) i);
+                if (fd >= 0)
+                        sendtmplt(fd,tmplt,i);
+        }
+        return gettm_ns() - strt;
+}
+
+int main(int argc, char* argv[])
+{
+        int c;
+        int fd = -1;
+        uint32_t iters = ITERATIONS;
+        char *ifname = NULL;
+        struct rt_pkt_t *pkt;
+        struct frmtmplt_t tmplt;
+        struct sockaddr_ll addr;
+        struct cntrlnfo_t cntrlnfo;
+        uint8_t dstaddr[ETH_ALEN] = {0x01,0xAC,0xCE,0x55,0x00,0x00};
+        uint64_t rbld_ns;
+        uint64_t tmplt_ns;
+        struct sock_txtime soctxtm;
+
+        while (EOF != (c = getopt(argc,argv,"hn:i:"))) {
+                switch(c) {
+                case 'n':
+                        iters = atoi(optarg);
+                        break;
+                case 'i':
+                        ifname = optarg;
+                        break;
+                case 'h':
+                default:
+                        usage(argv[0]);
+                        exit(0);
+                        break;
+                }
+        }
+        if (iters == 0)
+                iters = ITERATIONS;
+
+        memset(&cntrlnfo,0,sizeof(struct cntrlnfo_t));
+        memset(&addr,0,sizeof(struct sockaddr_ll));
+        if (NULL != ifname) {
+                fd = socket(AF_PACKET,SOCK_DGRAM,ETHERTYPE);
+                if (fd < 0) {
+                        printf("TX Socket open failed. Error: %d\n",errno);
+                        return 1;
+                }
+                soctxtm.clockid = CLOCK_TAI;
+                soctxtm.flags = 0;
+                if (setsockopt(fd,SOL_SOCKET,SO_TXTIME,&soctxtm,sizeof(soctxtm)) != 0)
+                        printf("Warning: Setting of Socketoption TXTIME failed (TX). Error: %d \n",errno);
+                if (fillethaddr(&addr,dstaddr,ETHERTYPE,fd,ifname) != 0) {
+                        printf("Interface %s not found.\n",ifname);
+                        close(fd);
+                        return 1;
+                }
+        }
+
+        if ((createpkt(&pkt) != 0) || (inittmplt(&tmplt,1,CNTRL,0xAC00,&addr) != 0)) {
+                printf("Allocation of packets failed.\n");
+                return 1;
+        }
+
+        //warm up caches
+        bench_rebuild(pkt,&cntrlnfo,-1,&addr,iters/10);
+        bench_tmplt(&tmplt,&cntrlnfo,-1,iters/10);
+
+        rbld_ns = bench_rebuild(pkt,&cntrlnfo,fd,&addr,iters);
+        tmplt_ns = bench_tmplt(&tmplt,&cntrlnfo,fd,iters);
+
+        printf("Control frame preparation%s, %u iterations:\n",(fd >= 0) ? " including sending" : "",iters);
+        printf("  rebuild (setpkt/fillcntrlpkt/sendpkt): %8.1f ns/frame\n",(double) rbld_ns/iters);
+        printf("  template (fillcntrlpkt/sendtmplt):     %8.1f ns/frame\n",(double) tmplt_ns/iters);
+
+        destroytmplt(&tmplt);
+        destroypkt(pkt);
+        if (fd >= 0)
+                close(fd);
+        return 0;
+}
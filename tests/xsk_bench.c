@@ -0,0 +1,231 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * Latency benchmark of the AF_PACKET and the AF_XDP transport. A control
+ * frame is sent on one interface and received (busy polling) on a second
+ * interface, e.g. the two ends of a veth pair:
+ *   ip link add vtsn0 type veth peer name vtsn1
+ *   ip link set vtsn0 up; ip link set vtsn1 up
+ *   ./xsk_bench -t vtsn0 -r vtsn1
+ * The time from handing the frame to the kernel until it is parsed on the
+ * receiving side is measured for both transports. For the veth pair the
+ * generic XDP mode (default) must be used.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <linux/net_tstamp.h>
+#include "../packet_handler.h"
+#include "../xsk_handler.h"
+
+#define ITERATIONS 10000
+#define RCVTMOUT 100000000      //100ms
+
+/* Print usage message */
+static void usage(char *appname)
+{
+        fprintf(stderr,
+                "\n"
+                "Usage: %s [options]\n"
+                " -n [value]           Number of iterations. Default 10000.\n"
+                " -t [name]            Name of the Networkinterface to send on.\n"
+                " -r [name]            Name of the Networkinterface to receive on.\n"
+                " -m [value]           XDP mode: 0 generic (skb), 1 native, 2 native zero-copy. Default 0.\n"
+                " -h                   Prints this help message and exits\n"
+                "\n",
+                appname);
+}
+
+static uint64_t gettm_ns(void)
+{
+        struct timespec tm;
+        clock_gettime(CLOCK_MONOTONIC_RAW,&tm);
+        return cnvrt_tmspc2int64(&tm);
+}
+
+/* checks that the received frame is the sent control frame */
+static int chckfrm(struct rt_pkt_t *pkt, uint16_t seqno)
+{
+        enum msgtyp_t msgtyp;
+        if ((prspkt(pkt,&msgtyp) != 1) || (msgtyp != CNTRL) || (chckpkthdrs(pkt) != 0))
+                return 1;       //fail
+        if (ntohs(pkt->grp_hdr->seqNo) != seqno)
+                return 1;       //fail
+        return 0;
+}
+
+static void prntrslt(char *name, uint64_t *lat, uint32_t iters)
+{
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        uint64_t min = UINT64_MAX;
+        for (uint32_t i = 0; i < iters; i++) {
+                sum += lat[i];
+                if (lat[i] > max)
+                        max = lat[i];
+                if (lat[i] < min)
+                        min = lat[i];
+        }
+        printf("  %-10s min %8lu ns, avg %8.1f ns, max %8lu ns\n",name,min,(double) sum/iters,max);
+}
+
+/* AF_PACKET: sendmsg on the TX socket, recvmsg on the RX socket */
+static int bench_pkt(struct frmtmplt_t *tmplt, int txfd, int rxfd, uint64_t *lat, uint32_t iters)
+{
+        struct cntrlnfo_t cntrlnfo;
+        struct rt_pkt_t *pkt;
+        struct msghdr msghdr;
+        uint64_t strt;
+        memset(&cntrlnfo,0,sizeof(struct cntrlnfo_t));
+        if (createpkt(&pkt) != 0)
+                return 1;       //fail
+        for (uint32_t i = 0; i < iters; i++) {
+                fillcntrlpkt(tmplt->pkt,&cntrlnfo,(uint16_t) i);
+                strt = gettm_ns();
+                if (sendtmplt(txfd,tmplt,0) != 0)
+                        return 1;       //fail
+                while (rcvpkt(rxfd,pkt,&msghdr) != 0) {
+                        if (gettm_ns() - strt > RCVTMOUT) {
+                                printf("AF_PACKET: frame %u not received.\n",i);
+                                return 1;       //fail
+                        }
+                }
+                if (chckfrm(pkt,(uint16_t) i) != 0) {
+                        printf("AF_PACKET: received wrong frame.\n");
+                        return 1;       //fail
+                }
+                lat[i] = gettm_ns() - strt;
+        }
+        destroypkt(pkt);
+        return 0;
+}
+
+/* AF_XDP: tx ring of the TX socket, rx ring of the RX socket */
+static int bench_xsk(struct frmtmplt_t *tmplt, struct xsksckt_t *txxsk, struct xsksckt_t *rxxsk, uint64_t *lat, uint32_t iters)
+{
+        struct cntrlnfo_t cntrlnfo;
+        struct frmtmplt_t *tmplts[1] = {tmplt};
+        struct rt_pkt_t pkt;
+        uint64_t txtime = 0;
+        uint64_t strt;
+        int err;
+        memset(&cntrlnfo,0,sizeof(struct cntrlnfo_t));
+        for (uint32_t i = 0; i < iters; i++) {
+                fillcntrlpkt(tmplt->pkt,&cntrlnfo,(uint16_t) i);
+                strt = gettm_ns();
+                if (sndxsktmplts(txxsk,tmplts,&txtime,1,&err) != 1)
+                        return 1;       //fail
+                while (rcvxskpkt(rxxsk,&pkt) != 0) {
+                        if (gettm_ns() - strt > RCVTMOUT) {
+                                printf("AF_XDP: frame %u not received.\n",i);
+                                return 1;       //fail
+                        }
+                }
+                if (chckfrm(&pkt,(uint16_t) i) != 0) {
+                        printf("AF_XDP: received wrong frame.\n");
+                        return 1;       //fail
+                }
+                lat[i] = gettm_ns() - strt;
+                rlsxskpkts(rxxsk);
+        }
+        return 0;
+}
+
+int main(int argc, char* argv[])
+{
+        int c;
+        int ok = 0;
+        uint32_t iters = ITERATIONS;
+        char *txif = NULL;
+        char *rxif = NULL;
+        enum xskmode_t mode = XSK_SKB;
+        int txfd;
+        int rxfd;
+        struct xsksckt_t txxsk;
+        struct xsksckt_t rxxsk;
+        struct frmtmplt_t tmplt;
+        struct sockaddr_ll addr;
+        uint8_t dstaddr[ETH_ALEN] = {0x01,0xAC,0xCE,0x55,0x00,0x00};
+        char *rcvmacs[1] = {(char *) dstaddr};
+        uint64_t *lat;
+        struct sock_txtime soctxtm;
+
+        while (EOF != (c = getopt(argc,argv,"hn:t:r:m:"))) {
+                switch(c) {
+                case 'n':
+                        iters = atoi(optarg);
+                        break;
+                case 't':
+                        txif = optarg;
+                        break;
+                case 'r':
+                        rxif = optarg;
+                        break;
+                case 'm':
+                        mode = atoi(optarg);
+                        break;
+                case 'h':
+                default:
+                        usage(argv[0]);
+                        exit(0);
+                        break;
+                }
+        }
+        if ((NULL == txif) || (NULL == rxif)) {
+                usage(argv[0]);
+                return 1;
+        }
+        if (iters == 0)
+                iters = ITERATIONS;
+        lat = calloc(iters,sizeof(uint64_t));
+
+        //AF_PACKET
+        txfd = socket(AF_PACKET,SOCK_DGRAM,ETHERTYPE);
+        rxfd = opnrxsckt(rxif,rcvmacs,1);
+        if ((txfd < 0) || (rxfd < 0)) {
+                printf("Socket open failed. Error: %d\n",errno);
+                return 1;
+        }
+        soctxtm.clockid = CLOCK_TAI;
+        soctxtm.flags = 0;
+        if (setsockopt(txfd,SOL_SOCKET,SO_TXTIME,&soctxtm,sizeof(soctxtm)) != 0)
+                printf("Warning: Setting of Socketoption TXTIME failed (TX). Error: %d \n",errno);
+        memset(&addr,0,sizeof(struct sockaddr_ll));
+        if ((fillethaddr(&addr,dstaddr,ETHERTYPE,txfd,txif) != 0) || (inittmplt(&tmplt,1,CNTRL,0xAC00,&addr) != 0)) {
+                printf("Preparing of frame template failed.\n");
+                return 1;
+        }
+        printf("One-way latency %s -> %s, %u frames:\n",txif,rxif,iters);
+        if (bench_pkt(&tmplt,txfd,rxfd,lat,iters) == 0)
+                prntrslt("AF_PACKET",lat,iters);
+        else
+                ok = 1;
+        close(rxfd);
+        close(txfd);
+
+        //AF_XDP
+        if ((opnxsk(&txxsk,txif,0,mode) != 0) || (opnxsk(&rxxsk,rxif,0,mode) != 0)) {
+                printf("AF_XDP socket setup failed.\n");
+                return 1;
+        }
+        if (bench_xsk(&tmplt,&txxsk,&rxxsk,lat,iters) == 0)
+                prntrslt("AF_XDP",lat,iters);
+        else
+                ok = 1;
+        clsxsk(&rxxsk);
+        clsxsk(&txxsk);
+
+        destroytmplt(&tmplt);
+        free(lat);
+        return ok;
+}
@@ -4,6 +4,9 @@
  * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
  */
 
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
 #include "time_calc.h"
 
 uint64_t cnvrt_tmspc2uatm(struct timespec orgtm)
@@ -166,4 +169,143 @@ struct timespec clc_rcvwkuptm(const struct timespec * est, uint32_t rcvoffst, ui
         inc_tm(&rcvwkuptm,rcvoffst+rcvstckclc+maxwkupjttr);
         dec_tm(&rcvwkuptm,rcvappclc);
         return(rcvwkuptm);
-}
\ No newline at end of file
+}
+
+/* initialize the timeline with the first cycle starting at least one period after the current time */
+void inittmln(struct cycltmln_t *tmln, int64_t basetm, uint32_t intrvl, int64_t curtm)
+{
+        tmln->basetm = basetm;
+        tmln->intrvl = intrvl;
+        //same as the epoch start time of clc_est: basetime if still in the future, else the cycle after the current one
+        if (curtm + tmln->intrvl < basetm)
+                tmln->frstcycl = 0;
+        else
+                tmln->frstcycl = (curtm - basetm)/tmln->intrvl + 1;
+}
+
+/* calc offset of the txtime from the start of a cycle */
+int64_t clc_txoffs(uint32_t sndoffst, uint32_t sndstckclc)
+{
+        return (int64_t) sndoffst - sndstckclc;
+}
+
+/* calc offset of the wakeup time of the sending thread from the start of a cycle */
+int64_t clc_sndwkupoffs(int64_t txoffs, uint32_t sndappclc, uint32_t maxwkupjttr)
+{
+        return txoffs - sndappclc - maxwkupjttr;
+}
+
+/* calc offset of the wakeup time of the receiving thread from the start of a cycle */
+int64_t clc_rcvwkupoffs(uint32_t rcvoffst, uint32_t rcvstckclc, uint32_t rcvappclc, uint32_t maxwkupjttr)
+{
+        return (int64_t) rcvoffst + rcvstckclc + maxwkupjttr - rcvappclc;
+}
+
+/* get point in time of a cycle (counted from the first cycle) at an offset from its start */
+int64_t tmln_tm(const struct cycltmln_t *tmln, uint64_t cycl, int64_t offs)
+{
+        return tmln->basetm + (tmln->frstcycl + (int64_t) cycl)*tmln->intrvl + offs;
+}
+
+/* get the first cycle (counted from the first cycle) whose point at the offset is not before a time */
+uint64_t tmln_nxtcycl(const struct cycltmln_t *tmln, int64_t tm, int64_t offs)
+{
+        int64_t dlt;
+        dlt = tm - tmln_tm(tmln,0,offs);
+        if (dlt <= 0)
+                return 0;
+        return (dlt + tmln->intrvl - 1)/tmln->intrvl;
+}
+
+/* hint to the cpu that this is a spin loop */
+static inline void spnrlx(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+}
+
+static int64_t taitm(void)
+{
+        struct timespec tm;
+        clock_gettime(CLOCK_TAI,&tm);
+        return cnvrt_tmspc2int64(&tm);
+}
+
+/* sleeps till an absolute time, a sleep interrupted by a signal is continued */
+static int slptl(const struct timespec *tm)
+{
+        int ret;
+        do {
+                ret = clock_nanosleep(CLOCK_TAI, TIMER_ABSTIME, tm, NULL);
+        } while (ret == EINTR);
+        return ret;
+}
+
+void inithybwkup(struct hybwkup_t *hyb, int64_t grd, int64_t maxgrd)
+{
+        memset(hyb,0,sizeof(struct hybwkup_t));
+        hyb->maxgrd = maxgrd;
+        if (grd > maxgrd)
+                grd = maxgrd;
+        if ((grd > 0) && (grd < HYBWKUP_MINGRD))
+                grd = HYBWKUP_MINGRD;
+        hyb->grd = grd;
+}
+
+int hybwkup(struct hybwkup_t *hyb, const struct timespec *wkuptm)
+{
+        struct timespec slptm;
+        int64_t trgt, slp, strt, now, ltncy, grd;
+        int ret;
+
+        if (hyb->grd <= 0)
+                return slptl(wkuptm);
+        trgt = cnvrt_tmspc2int64((struct timespec *) wkuptm);
+        slp = trgt - hyb->grd;
+        strt = taitm();
+        cnvrt_int642tmspc(slp,&slptm);
+        ret = slptl(&slptm);
+        if (ret != 0)
+                return ret;     //fail
+        now = taitm();
+        //latency of the sleep, a wake up time already passed does not count
+        ltncy = now - ((slp > strt) ? slp : strt);
+        if (now > trgt)
+                __atomic_store_n(&(hyb->ovrshts),hyb->ovrshts + 1,__ATOMIC_RELAXED);
+        strt = now;
+        while (now < trgt) {
+                spnrlx();
+                now = taitm();
+        }
+        __atomic_store_n(&(hyb->spn),hyb->spn + (now - strt),__ATOMIC_RELAXED);
+        if ((uint64_t) (now - strt) > hyb->maxspn)
+                __atomic_store_n(&(hyb->maxspn),now - strt,__ATOMIC_RELAXED);
+        __atomic_store_n(&(hyb->wkups),hyb->wkups + 1,__ATOMIC_RELAXED);
+
+        //guard covers the latency with a margin of half of it, grows at once and shrinks slowly
+        grd = ltncy + ltncy/2;
+        if (grd < HYBWKUP_MINGRD)
+                grd = HYBWKUP_MINGRD;
+        if (grd > hyb->maxgrd)
+                grd = hyb->maxgrd;
+        if (grd < hyb->grd)
+                grd = hyb->grd - ((hyb->grd - grd) >> HYBWKUP_DCY);
+        __atomic_store_n(&(hyb->grd),grd,__ATOMIC_RELAXED);
+        return 0;       //succeded
+}
+
+void prthybwkup(const char *name, const struct hybwkup_t *hyb)
+{
+        uint64_t wkups;
+
+        if (hyb->maxgrd <= 0)
+                return;
+        wkups = __atomic_load_n(&(hyb->wkups),__ATOMIC_RELAXED);
+        printf("%s: %llu wake ups, spun %llu ns on average and %llu ns at most, %llu sleeps past the wake up time, guard %lld ns\n",
+               name, (unsigned long long) wkups,
+               (unsigned long long) (wkups > 0 ? __atomic_load_n(&(hyb->spn),__ATOMIC_RELAXED)/wkups : 0),
+               (unsigned long long) __atomic_load_n(&(hyb->maxspn),__ATOMIC_RELAXED),
+               (unsigned long long) __atomic_load_n(&(hyb->ovrshts),__ATOMIC_RELAXED),
+               (long long) __atomic_load_n(&(hyb->grd),__ATOMIC_RELAXED));
+}
@@ -24,6 +24,8 @@
 
 #define OPC_EPOCH_DIFF 11644473600LL
 #define NSEC_IN_SEC 1000000000LL
+#define HYBWKUP_MINGRD 5000             //shortest guard of the hybrid wake up in ns
+#define HYBWKUP_DCY 6                   //guard shrinks by 1/2^HYBWKUP_DCY of its excess per wake up
 
 /* convert timespec to ua-time */
 uint64_t cnvrt_tmspc2uatm(struct timespec orgtm);
@@ -70,4 +72,48 @@ struct timespec clc_sndwkuptm(const struct timespec *txtime, uint32_t sndappclc,
 /* calc the wakeup time for the receiving thread */
 struct timespec clc_rcvwkuptm(const struct timespec * est, uint32_t rcvoffst, uint32_t rcvstckclc, uint32_t rcvappclc, uint32_t maxwkupjttr);
 
+/* timeline of the network cycles, all values in ns (CLOCK_TAI) */
+struct cycltmln_t {
+        int64_t basetm;                 //start of the cycle with index 0
+        int64_t intrvl;                 //length of a cycle
+        int64_t frstcycl;               //index of the first cycle the application is active in
+};
+
+/* initialize the timeline with the first cycle starting at least one period after the current time */
+void inittmln(struct cycltmln_t *tmln, int64_t basetm, uint32_t intrvl, int64_t curtm);
+
+/* calc offset of the txtime from the start of a cycle */
+int64_t clc_txoffs(uint32_t sndoffst, uint32_t sndstckclc);
+
+/* calc offset of the wakeup time of the sending thread from the start of a cycle */
+int64_t clc_sndwkupoffs(int64_t txoffs, uint32_t sndappclc, uint32_t maxwkupjttr);
+
+/* calc offset of the wakeup time of the receiving thread from the start of a cycle */
+int64_t clc_rcvwkupoffs(uint32_t rcvoffst, uint32_t rcvstckclc, uint32_t rcvappclc, uint32_t maxwkupjttr);
+
+/* get point in time of a cycle (counted from the first cycle) at an offset from its start */
+int64_t tmln_tm(const struct cycltmln_t *tmln, uint64_t cycl, int64_t offs);
+
+/* get the first cycle (counted from the first cycle) whose point at the offset is not before a time */
+uint64_t tmln_nxtcycl(const struct cycltmln_t *tmln, int64_t tm, int64_t offs);
+
+/* hybrid wake up: sleep till a guard before the wake up time, then spin on CLOCK_TAI, all values in ns */
+struct hybwkup_t {
+        int64_t grd;                    //current guard, adapted to the latency of the sleeps, 0 if disabled
+        int64_t maxgrd;                 //longest guard, bounds the spinning per wake up
+        uint64_t wkups;
+        uint64_t spn;                   //total time spun
+        uint64_t maxspn;
+        uint64_t ovrshts;               //sleeps which ended after the wake up time, the guard was too short
+};
+
+/* initialize the hybrid wake up with the first and the longest guard, a guard of 0 only sleeps */
+void inithybwkup(struct hybwkup_t *hyb, int64_t grd, int64_t maxgrd);
+
+/* sleep and spin till the wake up time (CLOCK_TAI), returns like clock_nanosleep */
+int hybwkup(struct hybwkup_t *hyb, const struct timespec *wkuptm);
+
+/* print the spinning of the hybrid wake up, nothing if disabled */
+void prthybwkup(const char *name, const struct hybwkup_t *hyb);
+
 #endif /* _TIME_CALC_H_ */
\ No newline at end of file
@@ -0,0 +1,406 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+#define _GNU_SOURCE
+#include "xsk_handler.h"
+#include "rt_log.h"
+#include "pcap_tap.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <linux/net_tstamp.h>
+
+#define XSK_RINGMASK (XSK_RINGSZ - 1)
+#define XSK_TXMDLEN sizeof(struct xsktxmd_t)    //TX frame data starts behind the metadata
+
+static int bpf(int cmd, union bpf_attr *attr)
+{
+        return syscall(__NR_bpf, cmd, attr, sizeof(union bpf_attr));
+}
+
+/* XDP program: redirect frames with the UADP Ethertype to the socket of the
+ * receive queue in the XSKMAP, pass all other frames to the network stack */
+static int ldxdpprg(int mapfd)
+{
+        union bpf_attr attr;
+        struct bpf_insn prg[] = {
+                //r2 = ctx->data, r3 = ctx->data_end
+                {.code = BPF_LDX | BPF_MEM | BPF_W, .dst_reg = BPF_REG_2, .src_reg = BPF_REG_1, .off = 0},
+                {.code = BPF_LDX | BPF_MEM | BPF_W, .dst_reg = BPF_REG_3, .src_reg = BPF_REG_1, .off = 4},
+                //if (data + ETH_HLEN > data_end) goto pass
+                {.code = BPF_ALU64 | BPF_MOV | BPF_X, .dst_reg = BPF_REG_4, .src_reg = BPF_REG_2},
+                {.code = BPF_ALU64 | BPF_ADD | BPF_K, .dst_reg = BPF_REG_4, .imm = ETH_HLEN},
+                {.code = BPF_JMP | BPF_JGT | BPF_X, .dst_reg = BPF_REG_4, .src_reg = BPF_REG_3, .off = 8},
+                //if (ethertype != ETHERTYPE) goto pass
+                {.code = BPF_LDX | BPF_MEM | BPF_H, .dst_reg = BPF_REG_5, .src_reg = BPF_REG_2, .off = 12},
+                {.code = BPF_JMP | BPF_JNE | BPF_K, .dst_reg = BPF_REG_5, .off = 6, .imm = htons(ETHERTYPE)},
+                //return bpf_redirect_map(&xskmap, ctx->rx_queue_index, XDP_PASS)
+                {.code = BPF_LDX | BPF_MEM | BPF_W, .dst_reg = BPF_REG_2, .src_reg = BPF_REG_1, .off = 16},
+                {.code = BPF_LD | BPF_DW | BPF_IMM, .dst_reg = BPF_REG_1, .src_reg = BPF_PSEUDO_MAP_FD, .imm = mapfd},
+                {.code = 0},
+                {.code = BPF_ALU64 | BPF_MOV | BPF_K, .dst_reg = BPF_REG_3, .imm = XDP_PASS},
+                {.code = BPF_JMP | BPF_CALL, .imm = BPF_FUNC_redirect_map},
+                {.code = BPF_JMP | BPF_EXIT},
+                //pass: return XDP_PASS
+                {.code = BPF_ALU64 | BPF_MOV | BPF_K, .dst_reg = BPF_REG_0, .imm = XDP_PASS},
+                {.code = BPF_JMP | BPF_EXIT},
+        };
+        static char lcns[] = "Dual MIT/GPL";
+
+        memset(&attr,0,sizeof(union bpf_attr));
+        attr.prog_type = BPF_PROG_TYPE_XDP;
+        attr.insns = (uint64_t) (uintptr_t) prg;
+        attr.insn_cnt = sizeof(prg)/sizeof(struct bpf_insn);
+        attr.license = (uint64_t) (uintptr_t) lcns;
+        return bpf(BPF_PROG_LOAD, &attr);
+}
+
+/* maps a ring of the socket and sets the pointers to producer, consumer, flags and descriptors */
+static int mapring(int fd, struct xskring_t *ring, struct xdp_ring_offset *off, size_t descsz, off_t pgoff)
+{
+        ring->mapsz = off->desc + XSK_RINGSZ*descsz;
+        ring->map = mmap(NULL, ring->mapsz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, pgoff);
+        if (MAP_FAILED == ring->map) {
+                ring->map = NULL;
+                return 1;       //fail
+        }
+        ring->prod = (uint32_t *) ((uint8_t *) ring->map + off->producer);
+        ring->cons = (uint32_t *) ((uint8_t *) ring->map + off->consumer);
+        ring->flags = (uint32_t *) ((uint8_t *) ring->map + off->flags);
+        ring->ring = (uint8_t *) ring->map + off->desc;
+        ring->cachedprod = *(ring->prod);
+        ring->cachedcons = *(ring->cons);
+        return 0;       //succeded
+}
+
+static void unmapring(struct xskring_t *ring)
+{
+        if (NULL != ring->map)
+                munmap(ring->map, ring->mapsz);
+        ring->map = NULL;
+}
+
+/* registers the UMEM, with TX metadata if supported by the kernel */
+static int regumem(struct xsksckt_t *xsk)
+{
+        struct xskumemreg_t reg;
+        memset(&reg,0,sizeof(struct xskumemreg_t));
+        reg.addr = (uint64_t) (uintptr_t) xsk->umem;
+        reg.len = xsk->umemsz;
+        reg.chunk_size = XSK_FRMSZ;
+        reg.flags = XDP_UMEM_TX_METADATA_LEN;
+        reg.tx_metadata_len = XSK_TXMDLEN;
+        if (setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(struct xskumemreg_t)) == 0) {
+                xsk->txmd = true;
+                return 0;       //succeded
+        }
+        //older kernel, no launch time for AF_XDP
+        printf("Warning: TX metadata not supported (Error: %d), frames are sent without launch time.\n",errno);
+        xsk->txmd = false;
+        reg.flags = 0;
+        reg.tx_metadata_len = 0;
+        if (setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(struct xdp_umem_reg)) == 0)
+                return 0;       //succeded
+        return 1;       //fail
+}
+
+/* sets up rings and bind the socket to the queue */
+static int bindxsk(struct xsksckt_t *xsk, enum xskmode_t mode)
+{
+        int sz = XSK_RINGSZ;
+        struct xdp_mmap_offsets off;
+        socklen_t optlen = sizeof(struct xdp_mmap_offsets);
+        struct sockaddr_xdp addr;
+        uint64_t *fqaddr;
+
+        if ((setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_FILL_RING, &sz, sizeof(sz)) != 0) ||
+            (setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &sz, sizeof(sz)) != 0) ||
+            (setsockopt(xsk->fd, SOL_XDP, XDP_RX_RING, &sz, sizeof(sz)) != 0) ||
+            (setsockopt(xsk->fd, SOL_XDP, XDP_TX_RING, &sz, sizeof(sz)) != 0))
+                return 1;       //fail
+        if (getsockopt(xsk->fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) != 0)
+                return 1;       //fail
+        if ((mapring(xsk->fd, &(xsk->fq), &(off.fr), sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING) != 0) ||
+            (mapring(xsk->fd, &(xsk->cq), &(off.cr), sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING) != 0) ||
+            (mapring(xsk->fd, &(xsk->rx), &(off.rx), sizeof(struct xdp_desc), XDP_PGOFF_RX_RING) != 0) ||
+            (mapring(xsk->fd, &(xsk->tx), &(off.tx), sizeof(struct xdp_desc), XDP_PGOFF_TX_RING) != 0))
+                return 1;       //fail
+
+        //first half of the frames for RX into the fill ring, second half for TX
+        fqaddr = (uint64_t *) xsk->fq.ring;
+        for (uint32_t i = 0; i < XSK_FRMCNT/2; i++)
+                fqaddr[(xsk->fq.cachedprod + i) & XSK_RINGMASK] = (uint64_t) i*XSK_FRMSZ;
+        xsk->fq.cachedprod += XSK_FRMCNT/2;
+        __atomic_store_n(xsk->fq.prod, xsk->fq.cachedprod, __ATOMIC_RELEASE);
+        for (uint32_t i = 0; i < XSK_FRMCNT/2; i++)
+                xsk->txfrms[i] = (uint64_t) (XSK_FRMCNT/2 + i)*XSK_FRMSZ;
+        xsk->txfrcnt = XSK_FRMCNT/2;
+
+        memset(&addr,0,sizeof(struct sockaddr_xdp));
+        addr.sxdp_family = AF_XDP;
+        addr.sxdp_ifindex = xsk->ifindex;
+        addr.sxdp_queue_id = xsk->queue;
+        addr.sxdp_flags = XDP_USE_NEED_WAKEUP | ((XSK_ZC == mode) ? XDP_ZEROCOPY : XDP_COPY);
+        if (bind(xsk->fd, (struct sockaddr *) &addr, sizeof(struct sockaddr_xdp)) != 0)
+                return 1;       //fail
+        return 0;       //succeded
+}
+
+/* creates the XSKMAP with the socket and attaches the XDP program to the interface */
+static int attchxdp(struct xsksckt_t *xsk, enum xskmode_t mode)
+{
+        union bpf_attr attr;
+        int fd = xsk->fd;
+
+        memset(&attr,0,sizeof(union bpf_attr));
+        attr.map_type = BPF_MAP_TYPE_XSKMAP;
+        attr.key_size = sizeof(uint32_t);
+        attr.value_size = sizeof(int);
+        attr.max_entries = xsk->queue + 1;
+        xsk->mapfd = bpf(BPF_MAP_CREATE, &attr);
+        if (xsk->mapfd < 0)
+                return 1;       //fail
+
+        memset(&attr,0,sizeof(union bpf_attr));
+        attr.map_fd = xsk->mapfd;
+        attr.key = (uint64_t) (uintptr_t) &(xsk->queue);
+        attr.value = (uint64_t) (uintptr_t) &fd;
+        if (bpf(BPF_MAP_UPDATE_ELEM, &attr) != 0)
+                return 1;       //fail
+
+        xsk->prgfd = ldxdpprg(xsk->mapfd);
+        if (xsk->prgfd < 0)
+                return 1;       //fail
+
+        //the link detaches the program automatically when it is closed
+        memset(&attr,0,sizeof(union bpf_attr));
+        attr.link_create.prog_fd = xsk->prgfd;
+        attr.link_create.target_ifindex = xsk->ifindex;
+        attr.link_create.attach_type = BPF_XDP;
+        attr.link_create.flags = (XSK_SKB == mode) ? XDP_FLAGS_SKB_MODE : XDP_FLAGS_DRV_MODE;
+        xsk->lnkfd = bpf(BPF_LINK_CREATE, &attr);
+        if (xsk->lnkfd < 0)
+                return 1;       //fail
+        return 0;       //succeded
+}
+
+int opnxsk(struct xsksckt_t *xsk, char *ifnm, uint32_t queue, enum xskmode_t mode)
+{
+        struct ifreq ifopts;
+        struct sock_txtime soctxtm;
+        int iofd;
+        memset(xsk,0,sizeof(struct xsksckt_t));
+        xsk->mapfd = -1;
+        xsk->prgfd = -1;
+        xsk->lnkfd = -1;
+        xsk->queue = queue;
+
+        xsk->fd = socket(AF_XDP, SOCK_RAW, 0);
+        if (xsk->fd < 0) {
+                printf("AF_XDP socket open failed. Error: %d\n",errno);
+                return 1;       //fail
+        }
+        //get interface ID and MAC-address, AF_XDP sockets do not support ioctls
+        memset(&ifopts,0,sizeof(struct ifreq));
+        strncpy(ifopts.ifr_name, ifnm, IFNAMSIZ-1);
+        iofd = socket(AF_PACKET, SOCK_DGRAM, 0);
+        if ((iofd < 0) || (ioctl(iofd, SIOCGIFINDEX, &ifopts) < 0)) {
+                printf("Interface %s not found.\n",ifnm);
+                if (iofd >= 0)
+                        close(iofd);
+                clsxsk(xsk);
+                return 1;       //fail
+        }
+        xsk->ifindex = ifopts.ifr_ifindex;
+        if (ioctl(iofd, SIOCGIFHWADDR, &ifopts) < 0) {
+                close(iofd);
+                clsxsk(xsk);
+                return 1;       //fail
+        }
+        close(iofd);
+        memcpy(xsk->srcmac, ifopts.ifr_hwaddr.sa_data, ETH_ALEN);
+
+        //the launch time is only used by the ETF qdisc if the socket has SO_TXTIME set
+        soctxtm.clockid = CLOCK_TAI;
+        soctxtm.flags = 0;
+        if (setsockopt(xsk->fd, SOL_SOCKET, SO_TXTIME, &soctxtm, sizeof(soctxtm)) != 0)
+                printf("Warning: Setting of Socketoption TXTIME failed (AF_XDP). Error: %d \n",errno);
+
+        xsk->umemsz = (size_t) XSK_FRMCNT*XSK_FRMSZ;
+        xsk->umem = mmap(NULL, xsk->umemsz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (MAP_FAILED == xsk->umem) {
+                xsk->umem = NULL;
+                printf("Allocation of UMEM failed. \n");
+                clsxsk(xsk);
+                return 1;       //fail
+        }
+        if (regumem(xsk) != 0) {
+                printf("Registration of UMEM failed. Error: %d\n",errno);
+                clsxsk(xsk);
+                return 1;       //fail
+        }
+        if (bindxsk(xsk, mode) != 0) {
+                printf("Setup of AF_XDP rings failed. Error: %d\n",errno);
+                clsxsk(xsk);
+                return 1;       //fail
+        }
+        if (attchxdp(xsk, mode) != 0) {
+                printf("Attaching of XDP program failed. Error: %d\n",errno);
+                clsxsk(xsk);
+                return 1;       //fail
+        }
+        return 0;       //succeded
+}
+
+void clsxsk(struct xsksckt_t *xsk)
+{
+        if (xsk->lnkfd >= 0)
+                close(xsk->lnkfd);
+        if (xsk->prgfd >= 0)
+                close(xsk->prgfd);
+        if (xsk->mapfd >= 0)
+                close(xsk->mapfd);
+        xsk->lnkfd = -1;
+        xsk->prgfd = -1;
+        xsk->mapfd = -1;
+        unmapring(&(xsk->fq));
+        unmapring(&(xsk->cq));
+        unmapring(&(xsk->rx));
+        unmapring(&(xsk->tx));
+        if (xsk->fd >= 0)
+                close(xsk->fd);
+        xsk->fd = -1;
+        if (NULL != xsk->umem)
+                munmap(xsk->umem, xsk->umemsz);
+        xsk->umem = NULL;
+}
+
+int rcvxskpkt(struct xsksckt_t *xsk, struct rt_pkt_t *pkt)
+{
+        struct xdp_desc *desc;
+        if (xsk->rx.cachedcons == xsk->rx.cachedprod) {
+                xsk->rx.cachedprod = __atomic_load_n(xsk->rx.prod, __ATOMIC_ACQUIRE);
+                if (xsk->rx.cachedcons == xsk->rx.cachedprod)
+                        return -1;      //no frame ready
+        }
+        desc = &(((struct xdp_desc *) xsk->rx.ring)[xsk->rx.cachedcons & XSK_RINGMASK]);
+        xsk->rx.cachedcons++;
+        xsk->rdcnt++;
+
+        memset(pkt,0,sizeof(struct rt_pkt_t));
+        pkt->sktbf = xsk->umem + desc->addr;
+        pkt->len = desc->len;
+        pkt->stridx = PKTSTRG_NIL;
+        caprx(pkt->sktbf,pkt->len,0,false);
+        return 0;       //succeded
+}
+
+void rlsxskpkts(struct xsksckt_t *xsk)
+{
+        struct xdp_desc *descs = (struct xdp_desc *) xsk->rx.ring;
+        uint64_t *fqaddr = (uint64_t *) xsk->fq.ring;
+        uint32_t idx;
+        if (xsk->rdcnt == 0)
+                return;
+
+        //the fill ring can hold all RX frames, therefore it can never be full
+        idx = xsk->rx.cachedcons - xsk->rdcnt;
+        for (uint32_t i = 0; i < xsk->rdcnt; i++) {
+                //back to the start of the frame
+                fqaddr[(xsk->fq.cachedprod + i) & XSK_RINGMASK] = descs[(idx + i) & XSK_RINGMASK].addr & ~((uint64_t) XSK_FRMSZ - 1);
+        }
+        xsk->fq.cachedprod += xsk->rdcnt;
+        xsk->rdcnt = 0;
+        __atomic_store_n(xsk->rx.cons, xsk->rx.cachedcons, __ATOMIC_RELEASE);
+        __atomic_store_n(xsk->fq.prod, xsk->fq.cachedprod, __ATOMIC_RELEASE);
+        if (__atomic_load_n(xsk->fq.flags, __ATOMIC_RELAXED) & XDP_RING_NEED_WAKEUP)
+                recvfrom(xsk->fd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+}
+
+/* gets the sent TX frames back from the completion ring */
+static void cmpltxsk(struct xsksckt_t *xsk)
+{
+        uint64_t *cqaddr = (uint64_t *) xsk->cq.ring;
+        xsk->cq.cachedprod = __atomic_load_n(xsk->cq.prod, __ATOMIC_ACQUIRE);
+        while (xsk->cq.cachedcons != xsk->cq.cachedprod) {
+                xsk->txfrms[xsk->txfrcnt] = cqaddr[xsk->cq.cachedcons & XSK_RINGMASK] & ~((uint64_t) XSK_FRMSZ - 1);
+                xsk->txfrcnt++;
+                xsk->cq.cachedcons++;
+        }
+        __atomic_store_n(xsk->cq.cons, xsk->cq.cachedcons, __ATOMIC_RELEASE);
+}
+
+int sndxsktmplts(struct xsksckt_t *xsk, struct frmtmplt_t *tmplts[], const uint64_t txtimes[], int cnt, int errs[])
+{
+        struct xdp_desc *descs = (struct xdp_desc *) xsk->tx.ring;
+        struct xdp_desc *desc;
+        struct xsktxmd_t *txmd;
+        struct eth_hdr_t *ethhdr;
+        uint8_t *frm;
+        uint32_t len;
+        int sent = 0;
+        int err = 0;
+
+        cmpltxsk(xsk);
+        xsk->tx.cachedcons = __atomic_load_n(xsk->tx.cons, __ATOMIC_ACQUIRE);
+        for (int i = 0; i < cnt; i++) {
+                if ((xsk->txfrcnt == 0) || ((xsk->tx.cachedprod - xsk->tx.cachedcons) >= XSK_RINGSZ)) {
+                        errs[i] = ENOBUFS;
+                        rtlog(LOG_XSKSNDFAIL,NULL,i,errs[i],0);
+                        continue;
+                }
+                xsk->txfrcnt--;
+                desc = &(descs[xsk->tx.cachedprod & XSK_RINGMASK]);
+                desc->addr = xsk->txfrms[xsk->txfrcnt] + XSK_TXMDLEN;
+                frm = xsk->umem + desc->addr;
+
+                //the socket does not add an Ethernet header
+                ethhdr = (struct eth_hdr_t *) frm;
+                memcpy(ethhdr->dstmac, tmplts[i]->addr.sll_addr, ETH_ALEN);
+                memcpy(ethhdr->srcmac, xsk->srcmac, ETH_ALEN);
+                ethhdr->ethtyp = htons(ETHERTYPE);
+                memcpy(frm + sizeof(struct eth_hdr_t), tmplts[i]->pkt->sktbf, tmplts[i]->pkt->len);
+                len = sizeof(struct eth_hdr_t) + tmplts[i]->pkt->len;
+                if (len < ETH_ZLEN) {
+                        memset(frm + len, 0, ETH_ZLEN - len);
+                        len = ETH_ZLEN;
+                }
+                desc->len = len;
+                desc->options = 0;
+                if (xsk->txmd) {
+                        txmd = (struct xsktxmd_t *) (frm - XSK_TXMDLEN);
+                        memset(txmd,0,sizeof(struct xsktxmd_t));
+                        txmd->flags = XDP_TXMD_FLAGS_LAUNCH_TIME;
+                        txmd->launch_time = txtimes[i];
+                        desc->options = XDP_TX_METADATA;
+                }
+                xsk->tx.cachedprod++;
+                errs[i] = 0;
+                sent++;
+                //the frame already has its Ethernet header
+                captx(NULL,frm,len,txtimes[i]);
+        }
+        __atomic_store_n(xsk->tx.prod, xsk->tx.cachedprod, __ATOMIC_RELEASE);
+
+        //kick the kernel to process the tx ring
+        if (__atomic_load_n(xsk->tx.flags, __ATOMIC_RELAXED) & XDP_RING_NEED_WAKEUP) {
+                if (sendto(xsk->fd, NULL, 0, MSG_DONTWAIT, NULL, 0) < 0)
+                        err = errno;
+                if ((err != 0) && (err != EAGAIN) && (err != EBUSY) && (err != ENOBUFS)) {
+                        rtlog(LOG_XSKWKUPFAIL,NULL,err,0,0);
+                        for (int i = 0; i < cnt; i++) {
+                                if (errs[i] == 0)
+                                        errs[i] = err;
+                        }
+                        return 0;
+                }
+        }
+        return sent;
+}
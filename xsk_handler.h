@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: (MIT)
+/*
+ * Copyright (c) 2020 Institute for Control Engineering of Machine Tools and Manufacturing Units, University of Stuttgart
+ * Author: Philipp Neher <philipp.neher@isw.uni-stuttgart.de>
+ */
+
+/*
+ * AF_XDP transport for the real-time frames. An XDP program redirects all
+ * frames with the OPC UA UADP Ethertype of one interface queue to an AF_XDP
+ * socket, all other traffic is passed to the network stack. The frames are
+ * received into and sent from a shared memory region (UMEM), received
+ * frames are handed to the application as packets which point directly into
+ * the UMEM. The socket only uses system calls, no libbpf/libxdp is required.
+ * The RX path (fill and rx ring) and the TX path (tx and completion ring) may
+ * be used from two different threads.
+ */
+
+#ifndef _XSKHANDLER_H_
+#define _XSKHANDLER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <linux/if_xdp.h>
+#include "packet_handler.h"
+
+#define XSK_FRMSZ 2048          //size of a UMEM frame
+#define XSK_FRMCNT 128          //number of UMEM frames, half for RX and half for TX
+#define XSK_RINGSZ 64           //number of descriptors per ring, power of 2
+
+/* TX metadata (launch time) is only defined in newer kernel headers (>= 6.15) */
+#ifndef XDP_UMEM_TX_METADATA_LEN
+#define XDP_UMEM_TX_METADATA_LEN (1 << 2)
+#endif
+#ifndef XDP_TX_METADATA
+#define XDP_TX_METADATA (1 << 1)
+#endif
+#ifndef XDP_TXMD_FLAGS_LAUNCH_TIME
+#define XDP_TXMD_FLAGS_LAUNCH_TIME (1 << 2)
+#endif
+
+/* UMEM registration including the length of the TX metadata (struct xdp_umem_reg of kernel >= 6.8) */
+struct xskumemreg_t {
+        uint64_t addr;
+        uint64_t len;
+        uint32_t chunk_size;
+        uint32_t headroom;
+        uint32_t flags;
+        uint32_t tx_metadata_len;
+};
+
+/* TX metadata in front of a TX frame (struct xsk_tx_metadata of kernel >= 6.15) */
+struct xsktxmd_t {
+        uint64_t flags;
+        uint16_t csum_start;
+        uint16_t csum_offset;
+        uint64_t launch_time;
+};
+
+/* Mode of the XDP program and the socket */
+enum xskmode_t {
+        XSK_SKB,        //generic XDP, copy mode (works for every interface e.g. veth)
+        XSK_DRV,        //native XDP of the driver, copy mode
+        XSK_ZC,         //native XDP of the driver, zero-copy mode
+};
+
+/* single producer/single consumer ring shared with the kernel */
+struct xskring_t {
+        uint32_t *prod;
+        uint32_t *cons;
+        uint32_t *flags;
+        void *ring;
+        void *map;
+        size_t mapsz;
+        uint32_t cachedprod;
+        uint32_t cachedcons;
+};
+
+struct xsksckt_t {
+        int fd;
+        int ifindex;
+        uint32_t queue;
+        unsigned char srcmac[ETH_ALEN];
+        uint8_t *umem;
+        size_t umemsz;
+        struct xskring_t fq;            //fill ring (RX path)
+        struct xskring_t rx;            //rx ring (RX path)
+        struct xskring_t tx;            //tx ring (TX path)
+        struct xskring_t cq;            //completion ring (TX path)
+        uint32_t rdcnt;                 //number of read RX frames not yet handed back to the kernel
+        uint64_t txfrms[XSK_FRMCNT/2];  //stack of unused TX frames (TX path)
+        uint32_t txfrcnt;
+        bool txmd;                      //launch time is passed as TX metadata
+        int mapfd;
+        int prgfd;
+        int lnkfd;
+};
+
+/* opens an AF_XDP socket on the queue of the interface, sets up the UMEM and
+ * rings and attaches the XDP program which redirects the UADP frames to it */
+int opnxsk(struct xsksckt_t *xsk, char *ifnm, uint32_t queue, enum xskmode_t mode);
+
+/* detaches the XDP program, closes the socket and frees the UMEM */
+void clsxsk(struct xsksckt_t *xsk);
+
+/* gets the next received frame, pkt becomes a view into the UMEM and is only
+ * valid until the frames are released. Returns 0 on success or -1 if no frame is ready */
+int rcvxskpkt(struct xsksckt_t *xsk, struct rt_pkt_t *pkt);
+
+/* hands all frames read since the last release back to the kernel (fill ring) */
+void rlsxskpkts(struct xsksckt_t *xsk);
+
+/* copies the (filled) packets of cnt templates into UMEM frames and sends them
+ * with their txtimes (launch time). The result of each frame is written to errs
+ * (0 or errno). Returns the number of frames handed to the kernel */
+int sndxsktmplts(struct xsksckt_t *xsk, struct frmtmplt_t *tmplts[], const uint64_t txtimes[], int cnt, int errs[]);
+
+#endif /* _XSKHANDLER_H_ */